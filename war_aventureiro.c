@@ -38,6 +38,21 @@ typedef struct
     int tropas;
 } Territorio;
 
+// **** Cenário Pronto ****
+
+/// @brief Territórios do cenário pronto, gravados no próprio programa como constantes.
+/// Escolhido com 0 no número de territórios, dispensa o cadastro.
+const Territorio CENARIO_PRONTO[] = {
+    {"America", "Verde", 5},
+    {"Europa", "Azul", 3},
+    {"Asia", "Vermelho", 2},
+    {"Africa", "Amarelo", 4},
+    {"Oceania", "Branco", 1},
+    {"Antartida", "Verde", 2},
+};
+
+#define NUM_TERRITORIOS_CENARIO (int)(sizeof(CENARIO_PRONTO) / sizeof(CENARIO_PRONTO[0]))
+
 // **** Protótipos das Funções ****
 
 //**** Declarações antecipadas de todas as funções que serão usadas no programa, organizadas por categoria. ****
@@ -215,10 +230,14 @@ int main()
     printf("====================================\n");
 
     int numTerritorios;
-    printf("Digite o número de territórios a cadastrar: ");
+    printf("Digite o número de territórios a cadastrar (0 para o cenário pronto): ");
     scanf("%d", &numTerritorios); // Em caso de letra, corresponderá a um código numérico. Não foi solicitada a validação de todas as entradas do jogador.
     limparBufferEntrada();
 
+    int cenarioPronto = numTerritorios == 0;
+    if (cenarioPronto)
+        numTerritorios = NUM_TERRITORIOS_CENARIO;
+
     // Alocação dinâmica de memória para os territórios
     Territorio *mapa = alocarMapa(numTerritorios);
 
@@ -228,7 +247,10 @@ int main()
         return EXIT_FAILURE;
     }
 
-    cadastrarTerritorios(mapa, numTerritorios);
+    if (cenarioPronto)
+        memcpy(mapa, CENARIO_PRONTO, sizeof(CENARIO_PRONTO));
+    else
+        cadastrarTerritorios(mapa, numTerritorios);
 
     char continuar;
 
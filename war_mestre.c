@@ -1,14 +1,234 @@
+#define _GNU_SOURCE // fopencookie(), usada no modo com threads.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <poll.h>
+#include <ucontext.h>
 
 // **** Constantes Globais ****
 // **** Definem valores fixos para o número de territórios, missões e tamanho máximo de strings, facilitando a manutenção. ****
 
 #define TAM_NOME 30
 #define TAM_COR 10
+#define TERRITORIOS_POR_BLOCO 64
+#define BLOCOS_POR_PAGINA 256
+#define LIMITE_DESFAZER 64
+#define LINHAS_POR_PAGINA 200
+#define TAM_BUFFER_EXIBICAO 16384
+#define TAM_ENTRADA 64
+#define ID_INEXISTENTE SIZE_MAX
+#define MAX_OUVINTES 8
+#define COR_FIXA_VAZIA UINT8_MAX
+#define TERRITORIOS_POR_REGIAO 6
+#define REFORCO_MINIMO 3
+#define CAPACIDADE_HISTORICO_BATALHAS 4096
+
+#define EVENTOS_POR_BLOCO_RASTRO 4096
+#define PREFIXO_MEMORIA_ESPECTADOR "/war_espectador-" // Seguido do PID da partida ou do nome dado com --partida.
+#define TAM_NOME_ESPECTADOR 64
+#define TAM_MISSAO_ESPECTADOR 96
+#define MAGICA_ESPECTADOR 0x31524157u      // "WAR1": gravada por último, quando o cabeçalho está completo.
+#define ESPERAS_PRONTO_ESPECTADOR 50       // Consultas de 200 ms pelo cabeçalho completo (10 s).
+#define TENTATIVAS_RAPIDAS_ESPECTADOR 64   // Releituras do seqlock sem pausa.
+#define TENTATIVAS_LEITURA_ESPECTADOR 5064 // Depois das rápidas, uma pausa de 1 ms por releitura (cerca de 5 s).
+#define CAPACIDADE_FILA_RENDER 8192 // Potência de 2.
+#define CAPACIDADE_FILA_ENTRADA 256 // Potência de 2.
+#define TAM_TEXTO_RENDER 240
+#define TAM_BLOCO_ENTRADA 256
+#define MAX_THREADS_GERADOR 64
+#define BLOCO_ARQUIVO_MAPA 65536 // Territórios por bloco de leitura e escrita dos arquivos de mapa.
+#define VERSAO_ARQUIVO_MAPA 1
+#define MAX_TERRITORIOS_SOLUCIONADOR 64
+#define BALDES_TRANSPOSICAO (1u << 18) // Baldes de 2 entradas da tabela de transposição (12 MiB).
+#define PROBABILIDADE_VITORIA_RODADA (21.0 / 36.0) // Dado do atacante >= dado do defensor.
+#define BALDES_TROPAS 4096 // Baldes de contagem exata do índice de tropas; o último reúne os excedentes.
+#define LIMITE_TABELA_BATALHA 128     // Perdas permitidas e tropas defensoras cobertas pela tabela de batalhas.
+#define LOTE_CONSELHEIRO 1024         // Pares (atacante, defensor) pontuados por lote.
+#define CANDIDATOS_SEM_VIZINHANCA 64  // Atacantes e defensores considerados por lado quando o mapa não tem vizinhança.
+#define PESO_MISSAO_CONSELHEIRO 2.0f  // Peso da contribuição para a missão na nota de um ataque.
+#define PESO_PERDAS_CONSELHEIRO 0.25f // Peso da fração de tropas que o atacante espera perder.
+#define PILHA_TAREFA_IA (1 << 20)     // Pilha de cada jogador do computador; comporta PROFUNDIDADE_MAXIMA_SOLUCIONADOR com folga.
+#define PROFUNDIDADE_MAXIMA_SOLUCIONADOR 64 // Aprofundamento iterativo do solucionador, no menu e no computador.
+#define FATIA_IA_NS 1000000ULL        // Fatia de tempo de cada jogador do computador antes de ceder a vez (1 ms).
+#define ORCAMENTO_IA_PADRAO_MS 50     // Tempo de pensamento de cada jogador do computador por jogada.
+#define LIMITE_TURNO_IA_MS 2000       // Teto do turno inteiro do computador; com muitas cores, cada uma pensa menos.
+#define TAREFAS_IA_SIMULTANEAS 8      // Pilhas reaproveitadas: no máximo estas tarefas pensam ao mesmo tempo.
+#define BALDES_TRANSPOSICAO_IA (1u << 14) // Tabela de transposição menor, uma por jogador do computador.
+#define LINHAS_BLOCO_ESTATISTICAS 65536   // Linhas acumuladas por coluna antes de cada gravação em disco.
+#define VERSAO_MANIFESTO_ESTATISTICAS 2 // Versão 2: cores com ids estáveis de 16 bits, do dicionário do diretório.
+#define COR_ESTATISTICAS_VAZIA UINT16_MAX  // Cor fora do dicionário (cheio ou sem gravação possível).
+#define FAIXAS_PROPORCAO_TROPAS 8
+#define TAM_CAMINHO_ESTATISTICAS 512
+
+// Rastreamento de alocações por categoria. Ligado por padrão; compile com -DRASTREAR_MEMORIA=0 para que
+// ALOCAR/REALOCAR/LIBERAR voltem a ser chamadas diretas a malloc/realloc/free, sem nenhum custo.
+#ifndef RASTREAR_MEMORIA
+#define RASTREAR_MEMORIA 1
+#endif
+
+#if RASTREAR_MEMORIA
+#define ALOCAR(categoria, bytes) alocarRastreado((categoria), (bytes))
+#define ALOCAR_ZERADO(categoria, quantidade, tamanho) alocarZeradoRastreado((categoria), (quantidade), (tamanho))
+#define REALOCAR(categoria, ponteiro, bytes) realocarRastreado((categoria), (ponteiro), (bytes))
+#define LIBERAR(ponteiro) liberarRastreado(ponteiro)
+#else
+#define ALOCAR(categoria, bytes) malloc(bytes)
+#define ALOCAR_ZERADO(categoria, quantidade, tamanho) calloc((quantidade), (tamanho))
+#define REALOCAR(categoria, ponteiro, bytes) realloc((ponteiro), (bytes))
+#define LIBERAR(ponteiro) free(ponteiro)
+#endif
+
+// Capacidades dos mapas fixos gerados em tempo de compilação para partidas casuais.
+// Para acrescentar uma capacidade, basta incluí-la aqui (em ordem crescente, até 254 territórios).
+#define CAPACIDADES_MAPA_FIXO(X) X(8) X(16) X(32) X(64)
+
+// Cenários embutidos no binário, escolhidos com --cenario ou com 0 no número de territórios. As listas abaixo viram
+// tabelas const em tempo de compilação: a partida começa sem cadastro, sem leitura de arquivo e sem alocação por território.
+
+// Continentes do mapa clássico: X(identificador, nome, bônus).
+#define CONTINENTES_CLASSICOS(X)             \
+    X(AMERICA_DO_NORTE, "América do Norte", 5) \
+    X(AMERICA_DO_SUL, "América do Sul", 2)     \
+    X(EUROPA, "Europa", 5)                     \
+    X(AFRICA, "África", 3)                     \
+    X(ASIA, "Ásia", 7)                         \
+    X(OCEANIA, "Oceania", 2)
+
+// Territórios do mapa clássico, agrupados por continente: X(identificador, nome, continente, cor, tropas).
+#define TERRITORIOS_CLASSICOS(X) \
+    X(ALASCA, "Alasca", AMERICA_DO_NORTE, "azul", 4) \
+    X(MACKENZIE, "Mackenzie", AMERICA_DO_NORTE, "verde", 3) \
+    X(GROENLANDIA, "Groenlândia", AMERICA_DO_NORTE, "branco", 2) \
+    X(VANCOUVER, "Vancouver", AMERICA_DO_NORTE, "preto", 3) \
+    X(OTTAWA, "Ottawa", AMERICA_DO_NORTE, "verde", 4) \
+    X(LABRADOR, "Labrador", AMERICA_DO_NORTE, "vermelho", 4) \
+    X(CALIFORNIA, "Califórnia", AMERICA_DO_NORTE, "vermelho", 4) \
+    X(NOVA_YORK, "Nova York", AMERICA_DO_NORTE, "azul", 3) \
+    X(MEXICO, "México", AMERICA_DO_NORTE, "amarelo", 4) \
+    X(VENEZUELA, "Venezuela", AMERICA_DO_SUL, "azul", 2) \
+    X(PERU, "Peru", AMERICA_DO_SUL, "amarelo", 3) \
+    X(BRASIL, "Brasil", AMERICA_DO_SUL, "vermelho", 4) \
+    X(ARGENTINA, "Argentina", AMERICA_DO_SUL, "amarelo", 1) \
+    X(ISLANDIA, "Islândia", EUROPA, "verde", 4) \
+    X(INGLATERRA, "Inglaterra", EUROPA, "azul", 2) \
+    X(SUECIA, "Suécia", EUROPA, "branco", 2) \
+    X(MOSCOU, "Moscou", EUROPA, "preto", 2) \
+    X(ALEMANHA, "Alemanha", EUROPA, "vermelho", 4) \
+    X(POLONIA, "Polônia", EUROPA, "branco", 2) \
+    X(PORTUGAL, "Portugal", EUROPA, "verde", 1) \
+    X(ARGELIA, "Argélia", AFRICA, "verde", 3) \
+    X(EGITO, "Egito", AFRICA, "azul", 3) \
+    X(SUDAO, "Sudão", AFRICA, "branco", 1) \
+    X(CONGO, "Congo", AFRICA, "verde", 3) \
+    X(AFRICA_DO_SUL, "África do Sul", AFRICA, "amarelo", 1) \
+    X(MADAGASCAR, "Madagascar", AFRICA, "vermelho", 3) \
+    X(OMSK, "Omsk", ASIA, "branco", 3) \
+    X(DUDINKA, "Dudinka", ASIA, "vermelho", 1) \
+    X(SIBERIA, "Sibéria", ASIA, "preto", 3) \
+    X(VLADIVOSTOK, "Vladivostok", ASIA, "branco", 3) \
+    X(ARAL, "Aral", ASIA, "azul", 2) \
+    X(MONGOLIA, "Mongólia", ASIA, "preto", 2) \
+    X(TCHITA, "Tchita", ASIA, "vermelho", 1) \
+    X(CHINA, "China", ASIA, "preto", 3) \
+    X(INDIA, "Índia", ASIA, "preto", 4) \
+    X(JAPAO, "Japão", ASIA, "verde", 2) \
+    X(ORIENTE_MEDIO, "Oriente Médio", ASIA, "amarelo", 4) \
+    X(VIETNA, "Vietnã", ASIA, "azul", 3) \
+    X(SUMATRA, "Sumatra", OCEANIA, "preto", 1) \
+    X(BORNEU, "Bornéu", OCEANIA, "branco", 1) \
+    X(NOVA_GUINE, "Nova Guiné", OCEANIA, "amarelo", 1) \
+    X(AUSTRALIA, "Austrália", OCEANIA, "amarelo", 1)
+
+// Fronteiras do mapa clássico, cada uma listada uma única vez: X(território, território).
+#define FRONTEIRAS_CLASSICAS(X) \
+    X(ALASCA, MACKENZIE) X(ALASCA, VANCOUVER) X(ALASCA, VLADIVOSTOK) \
+    X(MACKENZIE, VANCOUVER) X(MACKENZIE, OTTAWA) X(MACKENZIE, GROENLANDIA) \
+    X(GROENLANDIA, LABRADOR) X(GROENLANDIA, ISLANDIA) \
+    X(VANCOUVER, OTTAWA) X(VANCOUVER, CALIFORNIA) \
+    X(OTTAWA, LABRADOR) X(OTTAWA, CALIFORNIA) X(OTTAWA, NOVA_YORK) \
+    X(LABRADOR, NOVA_YORK) \
+    X(CALIFORNIA, NOVA_YORK) X(CALIFORNIA, MEXICO) \
+    X(NOVA_YORK, MEXICO) \
+    X(MEXICO, VENEZUELA) \
+    X(VENEZUELA, PERU) X(VENEZUELA, BRASIL) \
+    X(PERU, BRASIL) X(PERU, ARGENTINA) \
+    X(BRASIL, ARGENTINA) X(BRASIL, ARGELIA) \
+    X(ISLANDIA, INGLATERRA) \
+    X(INGLATERRA, SUECIA) X(INGLATERRA, ALEMANHA) X(INGLATERRA, PORTUGAL) \
+    X(SUECIA, MOSCOU) \
+    X(MOSCOU, POLONIA) X(MOSCOU, OMSK) X(MOSCOU, ARAL) X(MOSCOU, ORIENTE_MEDIO) \
+    X(ALEMANHA, PORTUGAL) X(ALEMANHA, POLONIA) \
+    X(POLONIA, PORTUGAL) X(POLONIA, ORIENTE_MEDIO) X(POLONIA, EGITO) \
+    X(PORTUGAL, ARGELIA) X(PORTUGAL, EGITO) \
+    X(ARGELIA, EGITO) X(ARGELIA, SUDAO) X(ARGELIA, CONGO) \
+    X(EGITO, ORIENTE_MEDIO) X(EGITO, SUDAO) \
+    X(SUDAO, CONGO) X(SUDAO, AFRICA_DO_SUL) X(SUDAO, MADAGASCAR) \
+    X(CONGO, AFRICA_DO_SUL) \
+    X(AFRICA_DO_SUL, MADAGASCAR) \
+    X(OMSK, ARAL) X(OMSK, DUDINKA) X(OMSK, MONGOLIA) X(OMSK, CHINA) \
+    X(DUDINKA, SIBERIA) X(DUDINKA, TCHITA) X(DUDINKA, MONGOLIA) \
+    X(SIBERIA, TCHITA) X(SIBERIA, VLADIVOSTOK) \
+    X(VLADIVOSTOK, TCHITA) X(VLADIVOSTOK, CHINA) X(VLADIVOSTOK, JAPAO) \
+    X(ARAL, CHINA) X(ARAL, INDIA) X(ARAL, ORIENTE_MEDIO) \
+    X(MONGOLIA, TCHITA) X(MONGOLIA, CHINA) \
+    X(TCHITA, CHINA) \
+    X(CHINA, JAPAO) X(CHINA, INDIA) X(CHINA, VIETNA) \
+    X(INDIA, VIETNA) X(INDIA, ORIENTE_MEDIO) X(INDIA, SUMATRA) \
+    X(VIETNA, BORNEU) \
+    X(SUMATRA, AUSTRALIA) \
+    X(BORNEU, NOVA_GUINE) X(BORNEU, AUSTRALIA) \
+    X(NOVA_GUINE, AUSTRALIA)
+
+// Missões próprias do mapa clássico, somadas às do catálogo montado em main(): X(texto).
+#define MISSOES_CLASSICAS(X)           \
+    X("Conquistar 24 territorios") \
+    X("Controlar 18 territorios com 2 tropa(s) ou mais")
+
+// Cenários: X(identificador, nome, descrição, territórios, cores, distribuição, tropas máximas, semente, vizinhança,
+// territórios por região). Zero territórios indica o mapa clássico; os demais são mapas de referência do gerador,
+// idênticos a cada execução pela semente fixa.
+#define CENARIOS_EMBUTIDOS(X)                                                                                                          \
+    X(CLASSICO, "classico", "Mapa-múndi clássico: 42 territórios, 6 continentes e fronteiras", 0, 6, DISTRIBUICAO_UNIFORME, 0, 0, 1, 0)  \
+    X(GRADE_4K, "grade-4k", "Referência: grade de 4.096 territórios, 4 cores, regiões de 64", 4096, 4, DISTRIBUICAO_UNIFORME, 10, 1, 1, 64) \
+    X(ZIPF_1M, "zipf-1m", "Referência: 1 milhão de territórios em grade, 8 cores, tropas Zipf", 1000000, 8, DISTRIBUICAO_ZIPF, 1000, 2, 1, 1000) \
+    X(ENVIESADO_10M, "enviesado-10m", "Referência: 10 milhões de territórios sem fronteiras, tropas enviesadas", 10000000, 6, DISTRIBUICAO_ENVIESADA, 100, 3, 0, 10000)
+
+// Colunas do armazém de estatísticas: X(campo, tipo). Cada coluna é um arquivo de valores de largura fixa,
+// <tabela>.<campo>.col, que só cresce no fim. Cores são ids estáveis do dicionário <diretorio>/cores, um nome por
+// linha e o id é o número da linha a partir de zero (COR_ESTATISTICAS_VAZIA se a cor não coube no dicionário), e
+// missões são valores de TipoMissao (zero para desconhecida).
+#define COLUNAS_BATALHAS(X)    \
+    X(turno, uint32_t)         \
+    X(modo, uint8_t)           \
+    X(tropasAtacante, int32_t) \
+    X(tropasDefensor, int32_t) \
+    X(perdasAtacante, int32_t) \
+    X(perdasDefensor, int32_t) \
+    X(dadoAtacante, uint8_t)   \
+    X(dadoDefensor, uint8_t)   \
+    X(conquista, uint8_t)      \
+    X(corAtacante, uint16_t)   \
+    X(corDefensor, uint16_t)   \
+    X(missaoAtacante, uint8_t)
+
+// Uma linha por partida vencida: turno da vitória, missão e cor do vencedor e tamanho do mapa.
+#define COLUNAS_MISSOES(X) \
+    X(turno, uint32_t)     \
+    X(tipo, uint8_t)       \
+    X(cor, uint16_t)       \
+    X(territorios, uint32_t)
 
 // **** Estrutura de Dados ****
 
@@ -23,10 +243,793 @@ typedef struct
 
 typedef struct
 {
-    char corRemanescente[TAM_COR];
     int calcTropas;
 } MissaoInfo;
 
+/// @brief Categorias de memória do relatório de alocações.
+typedef enum
+{
+    MEMORIA_MAPA,
+    MEMORIA_MISSOES,
+    MEMORIA_TEXTOS,
+    MEMORIA_INDICES,
+    MEMORIA_HISTORICO,
+    MEMORIA_TEMPORARIA,
+    MEMORIA_RASTRO,
+    NUM_CATEGORIAS_MEMORIA
+} CategoriaMemoria;
+
+/// @brief Contadores de uma categoria de memória.
+typedef struct
+{
+    size_t bytesAtuais;
+    size_t bytesPico;
+    size_t alocacoes;
+    size_t liberacoes;
+} EstatisticasMemoria;
+
+/// @brief Cabeçalho escondido antes de cada bloco rastreado. A união com max_align_t preserva o alinhamento do bloco.
+typedef union
+{
+    struct
+    {
+        size_t bytes;
+        CategoriaMemoria categoria;
+    } info;
+    max_align_t alinhamento;
+} CabecalhoAlocacao;
+
+/// @brief Trecho cronometrado da linha do tempo (evento "X" do formato de trace do Chrome).
+typedef struct
+{
+    const char *nome;
+    uint64_t inicioNs;
+    uint64_t duracaoNs;
+} EventoRastro;
+
+/// @brief Bloco de eventos de uma thread. Blocos cheios são encadeados; nada é sobrescrito.
+typedef struct BlocoRastro
+{
+    EventoRastro eventos[EVENTOS_POR_BLOCO_RASTRO];
+    size_t quantidade;
+    struct BlocoRastro *proximo;
+} BlocoRastro;
+
+/// @brief Buffer de rastro de uma thread. Só a própria thread escreve nele, portanto a gravação não usa travas.
+/// Os buffers entram em uma lista global por compare-and-swap, lida apenas na exportação.
+typedef struct BufferRastro
+{
+    unsigned tid;
+    BlocoRastro *primeiro;
+    BlocoRastro *atual;
+    struct BufferRastro *proximo;
+} BufferRastro;
+
+/// @brief Trecho em andamento, encerrado automaticamente ao fim do escopo (ver RASTREAR_ESCOPO).
+typedef struct
+{
+    const char *nome;
+    uint64_t inicioNs; // Zero quando o rastro está desligado.
+} TrechoRastro;
+
+/// @brief Progresso da missão de um jogador, como visto pelos espectadores.
+typedef struct
+{
+    char cor[TAM_COR];
+    char missao[TAM_MISSAO_ESPECTADOR];
+    int32_t estado;       // 1 cumprida, 0 pendente, -1 sem avaliação pelos agregados.
+    uint32_t territorios; // Territórios possuídos pela cor.
+} MissaoEspectador;
+
+/// @brief Cabeçalho da memória compartilhada dos espectadores.
+/// Seguem-no `capacidadeJogadores` MissaoEspectador e `capacidadeTerritorios` Territorio.
+/// As capacidades são fixadas na criação; o restante é protegido pelo seqlock `sequencia` (ímpar durante a escrita).
+typedef struct
+{
+    _Atomic uint64_t sequencia;
+    _Atomic int32_t encerrado;
+    _Atomic uint32_t pronto; // MAGICA_ESPECTADOR depois que as capacidades foram gravadas; zero antes.
+    uint32_t capacidadeTerritorios;
+    uint32_t capacidadeJogadores;
+    uint64_t publicacao;
+    uint32_t turno;
+    uint32_t numTerritorios;
+    uint32_t numJogadores;
+    int32_t vencedor; // Índice do jogador vencedor, ou -1.
+} CabecalhoEspectador;
+
+/// @brief Tipos de missão do catálogo.
+typedef enum
+{
+    MISSAO_ELIMINAR_COR = 1,
+    MISSAO_CONQUISTAR,
+    MISSAO_TROPAS_MINIMAS,
+    MISSAO_TROPAS_MAXIMAS,
+    MISSAO_TROPAS_EXATAS,
+    MISSAO_DOMINAR_REGIAO,
+    MISSAO_DOMINAR_REGIOES
+} TipoMissao;
+
+/// @brief Tipos de evento emitidos pelo núcleo do jogo para os ouvintes registrados.
+typedef enum
+{
+    EVENTO_ATAQUE_INVALIDO = 1,
+    EVENTO_DADOS_ROLADOS,
+    EVENTO_TROPA_PERDIDA,
+    EVENTO_TERRITORIO_CONQUISTADO,
+    EVENTO_MISSAO_CUMPRIDA,
+    EVENTO_MISSAO_FRACASSADA
+} TipoEvento;
+
+/// @brief Motivos de um EVENTO_ATAQUE_INVALIDO. Mesmos códigos de ResultadoBlitz.codigo e ResultadoOrdem.codigo.
+typedef enum
+{
+    ATAQUE_ALIADO = 1,
+    ATAQUE_TROPAS_INSUFICIENTES = 2,
+    ATAQUE_SEM_FRONTEIRA = 4 // Só em mapas com vizinhança.
+} MotivoAtaqueInvalido;
+
+/// @brief Lado da batalha que perdeu a tropa em um EVENTO_TROPA_PERDIDA.
+typedef enum
+{
+    LADO_ATACANTE = 1,
+    LADO_DEFENSOR = 2
+} LadoBatalha;
+
+/// @brief Evento estruturado emitido pelo núcleo. Carrega cópias dos dados, e não ponteiros para o mapa,
+/// para que o ouvinte possa guardá-lo ou repassá-lo. Os campos usados dependem do tipo:
+/// - ATAQUE_INVALIDO: territórios envolvidos e motivo (MotivoAtaqueInvalido).
+/// - DADOS_ROLADOS: territórios, tropas antes da rodada e dados sorteados.
+/// - TROPA_PERDIDA: motivo com o lado que perdeu (LadoBatalha) e tropas após a perda.
+/// - TERRITORIO_CONQUISTADO: territórios com cor e tropas após a conquista.
+/// - MISSAO_CUMPRIDA: motivo com o TipoMissao, corAtacante com a cor do jogador, corDefensor com a cor alvo,
+///   quantidade e calcTropas com os parâmetros da missão.
+///   Nas missões de região, nomeDefensor traz o nome da região (MISSAO_DOMINAR_REGIAO).
+/// - MISSAO_FRACASSADA: nomeDefensor e corDefensor com o território que reprovou a missão.
+typedef struct
+{
+    TipoEvento tipo;
+    int motivo;
+    int dadoAtacante;
+    int dadoDefensor;
+    int tropasAtacante;
+    int tropasDefensor;
+    int calcTropas;
+    size_t quantidade;
+    char nomeAtacante[TAM_NOME];
+    char nomeDefensor[TAM_NOME];
+    char corAtacante[TAM_COR];
+    char corDefensor[TAM_COR];
+} EventoJogo;
+
+/// @brief Fila circular limitada, sem travas, para exatamente um produtor e um consumidor.
+/// Cada índice é alterado por um único lado; ficam em linhas de cache separadas para não disputá-las.
+typedef struct
+{
+    _Alignas(64) _Atomic size_t cabeca; // Próxima escrita; só o produtor altera.
+    _Alignas(64) _Atomic size_t cauda;  // Próxima leitura; só o consumidor altera.
+    _Alignas(64) size_t capacidade;     // Potência de 2.
+    size_t tamanhoElemento;
+    unsigned char *elementos;
+} FilaSPSC;
+
+/// @brief Tipos de mensagem do motor para a thread de exibição.
+typedef enum
+{
+    MENSAGEM_TEXTO = 1,
+    MENSAGEM_EVENTO,
+    MENSAGEM_FIM
+} TipoMensagemRender;
+
+/// @brief Mensagem da fila de exibição: um trecho da saída padrão ou um evento ainda não formatado.
+typedef struct
+{
+    uint8_t tipo;
+    uint16_t tamanho;
+    union
+    {
+        char texto[TAM_TEXTO_RENDER];
+        EventoJogo evento;
+    };
+} MensagemRender;
+
+/// @brief Bloco de bytes lido da entrada padrão pela thread de entrada.
+typedef struct
+{
+    uint16_t tamanho;
+    char bytes[TAM_BLOCO_ENTRADA];
+} BlocoEntrada;
+
+/// @brief Assinatura de um ouvinte de eventos. O contexto é o ponteiro informado no registro.
+typedef void (*OuvinteEvento)(const EventoJogo *evento, void *contexto);
+
+/// @brief Modos de resolução do ataque relâmpago (blitz).
+/// BLITZ_SIMULADO rola cada rodada internamente; BLITZ_DISTRIBUICAO_EXATA sorteia o desfecho final
+/// diretamente da distribuição exata de resultados da batalha.
+typedef enum
+{
+    BLITZ_SIMULADO = 1,
+    BLITZ_DISTRIBUICAO_EXATA = 2
+} ModoBlitz;
+
+/// @brief Resumo de uma batalha resolvida por completo no ataque relâmpago.
+/// codigo: 0 em caso de batalha executada, 1 para ataque a território aliado e 2 para tropas insuficientes.
+typedef struct
+{
+    int codigo;
+    int rodadas;
+    int perdasAtacante;
+    int perdasDefensor;
+    int conquistado;
+    int atingiuLimite;
+} ResultadoBlitz;
+
+/// @brief Modo de uma ordem de ataque em lote. Os modos de blitz reaproveitam os valores de ModoBlitz.
+typedef enum
+{
+    ORDEM_RODADA_UNICA = 0,
+    ORDEM_BLITZ_SIMULADO = BLITZ_SIMULADO,
+    ORDEM_BLITZ_DISTRIBUICAO_EXATA = BLITZ_DISTRIBUICAO_EXATA
+} ModoOrdem;
+
+/// @brief Ordem de ataque enviada em lote por bots ou servidores. IDs na base zero.
+typedef struct
+{
+    size_t atacante;
+    size_t defensor;
+    ModoOrdem modo;
+    int limitePerdas; // Apenas para os modos de blitz. Zero representa sem limite.
+} OrdemAtaque;
+
+/// @brief Resultado compacto de uma ordem em lote.
+/// codigo: 0 para ordem executada, 1 para alvo aliado, 2 para tropas insuficientes, 3 para ordem inválida
+/// (IDs fora do mapa, atacante igual ao defensor ou modo desconhecido) e 4 para alvo sem fronteira com o atacante.
+typedef struct
+{
+    uint8_t codigo;
+    uint8_t conquistado;
+    uint8_t atingiuLimite;
+    int32_t perdasAtacante;
+    int32_t perdasDefensor;
+} ResultadoOrdem;
+
+/// @brief Banco de dados (de jogar) pré-sorteados para ordens em lote.
+/// Cada palavra de 64 bits do gerador xorshift64* rende 24 dados por extração em base 6.
+typedef struct
+{
+    uint64_t estado;
+    uint64_t palavra;
+    int restantes;
+} BancoDados;
+
+/// @brief Bloco de territórios compartilhado entre snapshots (copy-on-write).
+/// Um bloco só é duplicado quando algum território dele é alterado depois do último snapshot.
+typedef struct
+{
+    int referencias;
+    Territorio itens[TERRITORIOS_POR_BLOCO];
+} BlocoMapa;
+
+/// @brief Página de ponteiros para blocos. Também é compartilhada entre snapshots e duplicada sob demanda,
+/// de modo que um snapshot novo copia apenas a tabela de páginas, e não um ponteiro por bloco.
+typedef struct
+{
+    int referencias;
+    BlocoMapa *blocos[BLOCOS_POR_PAGINA];
+} PaginaMapa;
+
+/// @brief Versão imutável do estado do jogo (territórios, informações da missão, turno corrente e ponto do histórico de
+/// batalhas).
+typedef struct
+{
+    int referencias;
+    size_t numPaginas;
+    PaginaMapa **paginas;
+    MissaoInfo info;
+    int turno;
+    uint64_t sequenciaBatalhas; // Batalhas com sequência menor pertencem a esta versão.
+} SnapshotMapa;
+
+/// @brief Mantém o mapa vivo ligado à última versão capturada, além das pilhas de desfazer e refazer.
+/// O mapa vivo só diverge da versão base nos blocos listados em blocosSujos.
+typedef struct
+{
+    Territorio *mapa;
+    size_t tamanho;
+    size_t numBlocos;
+    SnapshotMapa *base;
+    SnapshotMapa *inicial;
+    unsigned char *blocoSujo;
+    size_t *blocosSujos;
+    size_t numSujos;
+    SnapshotMapa *desfazer[LIMITE_DESFAZER];
+    int inicioDesfazer;
+    int numDesfazer;
+    SnapshotMapa *refazer[LIMITE_DESFAZER];
+    int numRefazer;
+} HistoricoMapa;
+
+/// @brief Índice hash de endereçamento aberto (sondagem linear) do nome do território para o seu índice no mapa.
+/// Os nomes nunca mudam, então o índice permanece válido após conquistas, desfazer e refazer.
+typedef struct
+{
+    const Territorio *mapa;
+    size_t capacidade; // Sempre uma potência de 2.
+    size_t quantidade;
+    uint64_t *hashes;
+    size_t *ids; // ID_INEXISTENTE marca uma posição vazia.
+} IndiceNomes;
+
+/// @brief Listas de territórios por cor, mantidas a cada conquista com remoção por troca (swap-remove) em O(1).
+/// Consultas do tipo "quais territórios a cor X possui" custam O(k), onde k é o número de territórios da cor.
+/// Também guarda, por cor, os agregados de tropas usados pelas missões, ajustados a cada alteração de território.
+typedef struct
+{
+    const Territorio *mapa;
+    size_t tamanho;
+    size_t numCores;
+    size_t capacidadeCores;
+    char (*nomes)[TAM_COR];
+    uint64_t *hashes;
+    size_t **membros;
+    size_t *quantidade;
+    size_t *capacidade;
+    int *corDoTerritorio;
+    size_t *posicaoNaLista;
+    int valido; // 0 após uma falha de alocação: as consultas voltam a varrer o mapa.
+    int limiteTropas;        // Limite de tropas das missões (calcTropas).
+    int *tropasRegistradas;  // Tropas de cada território na última atualização dos agregados.
+    size_t *comTropas;       // Por cor: territórios com ao menos 1 tropa.
+    size_t *acimaDoLimite;   // Por cor: territórios com tropas >= limiteTropas.
+    size_t *abaixoDoLimite;  // Por cor: territórios com tropas <= limiteTropas.
+} IndiceCores;
+
+/// @brief Índice de tropas em baldes: um balde por quantidade exata de tropas, com listas intrusivas duplamente
+/// encadeadas (O(1) para mover um território) e um bitset de baldes ocupados com um resumo de um nível.
+/// Achar o próximo balde ocupado custa duas contagens de zeros, então as consultas custam O(resultado).
+/// O último balde reúne quem tem BALDES_TROPAS - 1 tropas ou mais e é mantido em ordem decrescente de tropas: quem entra
+/// vindo de baldes menores tem as menores tropas e entra pela cauda, e mudanças dentro dele andam poucas posições.
+typedef struct
+{
+    const Territorio *mapa;
+    size_t tamanho;
+    int *tropas; // Tropas de cada território na última atualização.
+    size_t *proximo;
+    size_t *anterior;
+    size_t cabeca[BALDES_TROPAS];
+    size_t caudaExcedentes; // Último elemento (menos tropas) do balde de excedentes.
+    size_t quantidade[BALDES_TROPAS];
+    uint64_t ocupados[BALDES_TROPAS / 64];
+    uint64_t resumo; // Bit w: ocupados[w] != 0.
+} IndiceTropas;
+
+/// @brief Missão secreta de um jogador (uma por cor), já interpretada a partir do texto do catálogo.
+typedef struct
+{
+    char cor[TAM_COR];
+    char *texto;
+    TipoMissao tipo;
+    char corAlvo[TAM_COR]; // MISSAO_ELIMINAR_COR.
+    size_t quantidade;     // Territórios ou regiões almejados.
+    size_t regiao;         // MISSAO_DOMINAR_REGIAO (base zero).
+    int limiteTropas;
+} MissaoJogador;
+
+/// @brief Regiões (continentes) do mapa. Os membros de cada região ficam em um bitset esparso: apenas as palavras
+/// de 64 bits que contêm algum membro são guardadas, como pares (palavra, máscara) contíguos por região.
+/// Cada cor tem um bitset denso de posse, atualizado a cada troca de dono. "A cor X domina a região R" é então
+/// um AND por palavra da região, sem percorrer o mapa.
+typedef struct
+{
+    const Territorio *mapa;
+    size_t tamanhoMapa;
+    size_t palavrasPorCor;
+    size_t numRegioes;
+    size_t capacidadeRegioes;
+    char (*nomes)[TAM_NOME];
+    int *bonus;
+    size_t *numMembros;
+    size_t *inicio; // Região r ocupa as entradas [inicio[r], inicio[r + 1]) de palavras e mascaras.
+    size_t *palavras;
+    uint64_t *mascaras;
+    size_t numEntradas;
+    size_t capacidadeEntradas;
+    uint64_t **posse; // Bitset de posse por id de cor do índice de cores.
+    size_t numCoresPosse;
+    int posseValida;
+    size_t *regiaoDoTerritorio; // Regiões não se sobrepõem. ID_INEXISTENTE para territórios fora de qualquer região.
+    int *donoRegiao;            // Id da cor que domina cada região, ou -1 se dividida.
+    size_t *regioesPorCor;      // Agregados por cor, mantidos a cada troca de dono.
+    int *bonusPorCor;
+} MapaRegioes;
+
+/// @brief Entrada da tabela de transposição do solucionador. O valor é um limite inferior da probabilidade de vitória,
+/// exato quando a subárvore foi explorada até o fim.
+typedef struct
+{
+    uint64_t chave;
+    double valor;
+    int16_t profundidade;
+    uint8_t exato;
+    uint8_t geracao; // Iteração do aprofundamento que gravou a entrada.
+} EntradaTransposicao;
+
+/// @brief Classes de dono do solucionador: as cores inimigas só se distinguem quando uma delas é o alvo da missão.
+typedef enum
+{
+    CLASSE_JOGADOR,
+    CLASSE_ALVO,
+    CLASSE_INIMIGO
+} ClasseDono;
+
+/// @brief Vizinhança entre territórios em formato CSR: os vizinhos de i ficam em vizinhos[inicio[i] .. inicio[i + 1]).
+typedef struct
+{
+    size_t numTerritorios;
+    size_t numEntradas;
+    size_t *inicio;
+    size_t *vizinhos;
+} GrafoVizinhanca;
+
+/// @brief Estado do solucionador expectimax: a posição em busca, com a sua chave Zobrist, e a tabela de transposição.
+typedef struct
+{
+    const MissaoJogador *missao;
+    size_t tamanho;
+    int porTerritorio; // Missões de região e mapas com fronteiras dependem de quais territórios são possuídos, e não só de quantos.
+    const GrafoVizinhanca *fronteiras; // Vizinhança do mapa, ou NULL quando qualquer território ataca qualquer outro.
+    uint8_t dono[MAX_TERRITORIOS_SOLUCIONADOR]; // ClasseDono.
+    int tropas[MAX_TERRITORIOS_SOLUCIONADOR];
+    uint64_t chave;
+    EntradaTransposicao *tabela;
+    size_t mascaraBaldes;
+    uint8_t geracao;
+    uint64_t nos;
+    uint64_t prazoNs;
+    int esgotado;
+} Solucionador;
+
+/// @brief Lote de pares (atacante, defensor) do conselheiro de ataques, guardado em colunas: a pontuação percorre
+/// vetores contíguos de float, sem desvios, e o compilador vetoriza o laço.
+typedef struct
+{
+    size_t quantidade;
+    size_t atacante[LOTE_CONSELHEIRO];
+    size_t defensor[LOTE_CONSELHEIRO];
+    uint32_t celula[LOTE_CONSELHEIRO]; // Posição da batalha na tabela de batalhas.
+    float escala[LOTE_CONSELHEIRO];    // Fator das batalhas maiores que a tabela (1 nas demais).
+    float tropasAtacante[LOTE_CONSELHEIRO];
+    float relevancia[LOTE_CONSELHEIRO]; // Contribuição da conquista para a missão do jogador.
+    float probabilidade[LOTE_CONSELHEIRO];
+    float perdasAtacante[LOTE_CONSELHEIRO];
+    float perdasDefensor[LOTE_CONSELHEIRO];
+    float pontuacao[LOTE_CONSELHEIRO];
+} LoteAtaques;
+
+/// @brief Ataque sugerido pelo conselheiro, com a batalha resolvida até a conquista ou até restar 1 tropa.
+typedef struct
+{
+    size_t atacante;
+    size_t defensor;
+    float probabilidade;
+    float perdasAtacante;
+    float perdasDefensor;
+    float relevancia;
+    float pontuacao;
+} SugestaoAtaque;
+
+/// @brief Estado de uma consulta ao conselheiro: o jogador, o lote em preenchimento e as melhores sugestões até aqui.
+typedef struct
+{
+    const Territorio *mapa;
+    const MissaoJogador *missao;
+    int jogador;
+    int alvo;
+    size_t *faltantesRegiao; // MISSAO_DOMINAR_REGIOES: territórios que faltam ao jogador em cada região, sob demanda.
+    LoteAtaques *lote;
+    SugestaoAtaque *melhores; // Em ordem decrescente de pontuação.
+    size_t numMelhores;
+    size_t maximo;
+    size_t avaliados;
+    int interrompido; // A tarefa do computador que consultava o conselheiro foi cancelada.
+} Conselheiro;
+
+/// @brief Buffers reutilizáveis da busca em largura da fortificação, alocados uma vez por tamanho de mapa.
+/// Em vez de limpar o vetor de visitados a cada consulta, cada busca usa uma nova geração:
+/// um território foi visitado na busca atual se visitado[id] == geracao.
+typedef struct
+{
+    size_t tamanho;
+    uint32_t geracao;
+    uint32_t *visitado;
+    size_t *anterior; // Predecessor no caminho mais curto; válido para os visitados da geração atual.
+    size_t *fila;
+} BuscaCaminhos;
+
+/// @brief Jogador do computador em execução cooperativa: uma corrotina (ucontext) com pilha própria que pensa em fatias
+/// de tempo e guarda sempre a melhor jogada encontrada até o momento.
+typedef struct
+{
+    const MissaoJogador *missao;
+    const Territorio *mapa;
+    size_t tamanho;
+    ucontext_t contexto;
+    void *pilha;
+    uint64_t consumidoNs; // Tempo de pensamento acumulado nesta jogada.
+    uint64_t fimFatiaNs;
+    int cancelada;        // Orçamento esgotado ou jogador apressado: a busca deve encerrar na próxima cessão.
+    int terminada;
+    int semPilha; // Não houve pilha ou contexto para a tarefa: o jogador passa a vez.
+    int temJogada;
+    size_t atacante;
+    size_t defensor;
+    ModoOrdem modo;     // Rodada única para jogadas do solucionador, blitz para as do conselheiro.
+    const char *origem; // Quem encontrou a jogada.
+    int profundidade;
+} TarefaIA;
+
+/// @brief Uma batalha do armazém de estatísticas, na forma de linha. modo é um ModoOrdem; os dados são os da última
+/// rodada rolada (zero quando o desfecho foi sorteado pela distribuição exata). Tropas anteriores à batalha.
+#define CAMPO_AMOSTRA(campo, tipo) tipo campo;
+typedef struct
+{
+    COLUNAS_BATALHAS(CAMPO_AMOSTRA)
+} AmostraBatalha;
+
+/// @brief Uma missão cumprida do armazém de estatísticas, na forma de linha.
+typedef struct
+{
+    COLUNAS_MISSOES(CAMPO_AMOSTRA)
+} AmostraMissao;
+#undef CAMPO_AMOSTRA
+
+/// @brief Bloco em memória de uma tabela do armazém: um vetor por coluna, com LINHAS_BLOCO_ESTATISTICAS posições.
+#define VETOR_COLUNA(campo, tipo) tipo *campo;
+typedef struct
+{
+    COLUNAS_BATALHAS(VETOR_COLUNA)
+    size_t quantidade;
+} BlocoBatalhas;
+
+typedef struct
+{
+    COLUNAS_MISSOES(VETOR_COLUNA)
+    size_t quantidade;
+} BlocoMissoes;
+#undef VETOR_COLUNA
+
+/// @brief Armazém colunar de estatísticas, só de acréscimo. As linhas se acumulam nos blocos e cada coluna cheia é
+/// gravada de uma vez no fim do seu arquivo; as consultas varrem apenas as colunas de que precisam.
+/// O manifesto do diretório guarda as linhas confirmadas de cada tabela, e só é regravado depois que todas as colunas
+/// receberam o bloco: bytes além dele são restos de uma gravação interrompida e são cortados na abertura.
+typedef struct
+{
+    const char *diretorio;
+    BlocoBatalhas batalhas;
+    BlocoMissoes missoes;
+    uint64_t batalhasConfirmadas;
+    uint64_t missoesConfirmadas;
+    int falhou; // Após um erro de gravação, nada mais é gravado nesta execução.
+    char (*nomesCores)[TAM_COR]; // Dicionário de cores do diretório: o id de uma cor é a sua posição.
+    size_t numNomesCores;
+    size_t capacidadeNomesCores;
+    uint16_t *idsCores; // Por cor do índice da partida: id no dicionário, ou COR_ESTATISTICAS_VAZIA se ainda não buscado.
+    size_t numIdsCores;
+} ArmazemEstatisticas;
+
+/// @brief Resultado de um movimento de tropas da fortificação.
+typedef enum
+{
+    MOVIMENTO_OK = 0,
+    MOVIMENTO_CORES_DIFERENTES,
+    MOVIMENTO_TROPAS_INSUFICIENTES,
+    MOVIMENTO_SEM_CAMINHO,
+    MOVIMENTO_DESTINO_CHEIO,
+    MOVIMENTO_INVALIDO
+} ResultadoMovimento;
+
+/// @brief Distribuições de tropas do gerador de mapas.
+typedef enum
+{
+    DISTRIBUICAO_UNIFORME,
+    DISTRIBUICAO_ENVIESADA, // Muitos territórios fracos e poucos fortes.
+    DISTRIBUICAO_ZIPF       // P(k) proporcional a 1/k.
+} DistribuicaoTropas;
+
+/// @brief Parâmetros do gerador de mapas. A mesma semente sempre produz o mesmo mapa, com qualquer número de threads.
+typedef struct
+{
+    size_t quantidade; // Zero: mapa cadastrado pelo jogador.
+    size_t numCores;
+    DistribuicaoTropas distribuicao;
+    int tropasMaximas;
+    uint64_t semente;
+    int comVizinhanca; // Vizinhança em grade: cada território faz fronteira com até 4 outros.
+    size_t territoriosPorRegiao; // Zero: sem regiões.
+    const char *arquivoSaida;    // Gera direto no arquivo, sem montar o mapa em memória.
+    const char *arquivoEntrada;  // Carrega um mapa gerado anteriormente.
+    const double *acumuladaZipf; // Distribuição acumulada, montada antes da geração.
+} ConfiguracaoGerador;
+
+/// @brief Identificadores dos continentes, territórios e cenários embutidos, gerados a partir das listas X.
+#define IDENTIFICADOR_CONTINENTE(id, nome, bonus) CONTINENTE_##id,
+typedef enum
+{
+    CONTINENTES_CLASSICOS(IDENTIFICADOR_CONTINENTE)
+    NUM_CONTINENTES_CLASSICOS
+} ContinenteClassico;
+#undef IDENTIFICADOR_CONTINENTE
+
+#define IDENTIFICADOR_TERRITORIO(id, nome, continente, cor, tropas) TERRITORIO_##id,
+typedef enum
+{
+    TERRITORIOS_CLASSICOS(IDENTIFICADOR_TERRITORIO)
+    NUM_TERRITORIOS_CLASSICOS
+} TerritorioClassico;
+#undef IDENTIFICADOR_TERRITORIO
+
+#define IDENTIFICADOR_CENARIO(id, nome, descricao, quantidade, cores, distribuicao, tropasMaximas, semente, vizinhanca, porRegiao) CENARIO_##id,
+typedef enum
+{
+    CENARIOS_EMBUTIDOS(IDENTIFICADOR_CENARIO)
+    NUM_CENARIOS_EMBUTIDOS
+} IdCenario;
+#undef IDENTIFICADOR_CENARIO
+
+/// @brief Território de um cenário embutido.
+typedef struct
+{
+    const char *nome;
+    const char *cor;
+    int tropas;
+    uint8_t continente; // ContinenteClassico.
+} TerritorioCenario;
+
+/// @brief Continente de um cenário embutido.
+typedef struct
+{
+    const char *nome;
+    int bonus;
+} ContinenteCenario;
+
+/// @brief Fronteira (nos dois sentidos) entre dois territórios de um cenário embutido.
+typedef struct
+{
+    uint8_t a;
+    uint8_t b;
+} FronteiraCenario;
+
+/// @brief Cenário embutido: o mapa clássico (quantidade zero) ou os parâmetros fixos de um mapa de referência do gerador.
+typedef struct
+{
+    const char *nome;
+    const char *descricao;
+    size_t quantidade;
+    size_t numCores;
+    DistribuicaoTropas distribuicao;
+    int tropasMaximas;
+    uint64_t semente;
+    int comVizinhanca;
+    size_t territoriosPorRegiao;
+} CenarioEmbutido;
+
+/// @brief Fatia do trabalho do gerador entregue a uma thread. O vetor `destino` começa no território `base`.
+typedef struct
+{
+    const ConfiguracaoGerador *config;
+    Territorio *destino;
+    size_t base;
+    size_t inicio;
+    size_t fim;
+    size_t tamanhoMapa;
+    size_t largura; // Largura da grade da vizinhança.
+    const size_t *inicioVizinhos;
+    size_t *vizinhos;
+} TarefaGerador;
+
+/// @brief Cabeçalho dos arquivos de mapa. Seguem-no os territórios e, se houver vizinhança, os vetores CSR em 64 bits.
+typedef struct
+{
+    char magica[8];
+    uint32_t versao;
+    uint32_t tamanhoTerritorio; // Arquivos gravados com outro layout de Territorio são recusados.
+    uint64_t numTerritorios;
+    uint64_t numEntradasVizinhanca;
+} CabecalhoArquivoMapa;
+
+/// @brief Registro de uma batalha (rodada única, blitz ou ordem em lote) no histórico circular.
+/// Os encadeamentos guardam a sequência do registro anterior mais 1 (0 indica fim da cadeia).
+typedef struct
+{
+    uint64_t sequencia;
+    uint64_t anteriorDoTerritorio; // Conquista anterior do mesmo território.
+    uint64_t anteriorDaCor;        // Conquista anterior sofrida pela mesma cor.
+    size_t atacante;
+    size_t defensor;
+    int turno;
+    int perdasAtacante;
+    int perdasDefensor;
+    int conquista;
+    int desfeita; // 1: desfeita, ainda pode ser refeita; 2: descartada de vez por uma jogada nova.
+    char corAtacante[TAM_COR];
+    char corDefensor[TAM_COR]; // Cor do defensor antes da batalha.
+} RegistroBatalha;
+
+/// @brief Histórico circular de batalhas com memória fixa. Os índices secundários (por território e por cor perdedora)
+/// apontam para a conquista mais recente de cada um, e cada registro aponta para a anterior da mesma cadeia:
+/// as consultas percorrem apenas os registros que respondem, sem varrer o histórico.
+/// Registros sobrescritos pelo giro do buffer encerram as cadeias que passavam por eles. Batalhas desfeitas continuam
+/// nas cadeias, marcadas, e as consultas passam por cima delas.
+typedef struct
+{
+    const Territorio *mapa;
+    size_t tamanhoMapa;
+    RegistroBatalha *registros;
+    uint64_t proximaSequencia;
+    uint64_t sequenciaVisivel; // Ponto do estado atual: as batalhas a partir dele foram desfeitas.
+    uint64_t *ultimaDoTerritorio;
+    uint64_t *ultimaDaCor;
+    size_t capacidadeCores;
+} HistoricoBatalhas;
+
+/// @brief Colocação de tropas de reforço: quantas tropas vão para qual território.
+typedef struct
+{
+    size_t territorio;
+    int tropas;
+    int cor; // Id da cor no índice de cores.
+} ColocacaoTropas;
+
+/// @brief Contador especializado de um mapa fixo: percorre sempre toda a capacidade, sem desvios por território.
+/// Conta os territórios da cor informada (aliados) e os que, além disso, atendem à condição de tropas.
+/// exigeMaiorOuIgual/exigeMenorOuIgual combinados representam >=, <= ou == em relação ao limite.
+typedef size_t (*ContadorMapaFixo)(const Territorio *territorios, const uint8_t *corIds, uint8_t cor, int limite,
+                                   int exigeMaiorOuIgual, int exigeMenorOuIgual, size_t *aliados);
+
+/// @brief Mapa fixo em uso. Capacidade zero indica o mapa no heap de alocarMapa().
+typedef struct
+{
+    size_t capacidade;
+    uint8_t *corIds; // Id (no índice de cores) da cor de cada território; COR_FIXA_VAZIA nas posições sem território.
+    ContadorMapaFixo contar;
+} MapaFixoAtivo;
+
+/// @brief Gera o tipo MapaFixoN, residente na pilha, e seu contador com limite de laço constante.
+/// O laço de tamanho conhecido em tempo de compilação é desenrolado e vetorizado pelo compilador, e o acúmulo
+/// por máscaras evita desvios dependentes dos dados. Posições sem território têm cor COR_FIXA_VAZIA e nunca contam.
+#define DEFINIR_MAPA_FIXO(N)                                                                                        \
+    typedef struct                                                                                                  \
+    {                                                                                                               \
+        Territorio territorios[N];                                                                                  \
+        uint8_t corIds[N];                                                                                          \
+    } MapaFixo##N;                                                                                                  \
+                                                                                                                    \
+    static size_t contarMapaFixo##N(const Territorio *territorios, const uint8_t *corIds, uint8_t cor, int limite,  \
+                                    int exigeMaiorOuIgual, int exigeMenorOuIgual, size_t *aliados)                  \
+    {                                                                                                               \
+        size_t totalAliados = 0, totalAtendidos = 0;                                                                \
+        int ignoraMaior = !exigeMaiorOuIgual, ignoraMenor = !exigeMenorOuIgual;                                     \
+        for (size_t i = 0; i < (N); i++)                                                                            \
+        {                                                                                                           \
+            int tropas = territorios[i].tropas;                                                                     \
+            size_t daCor = corIds[i] == cor;                                                                        \
+            size_t atende = (size_t)(((tropas >= limite) | ignoraMaior) & ((tropas <= limite) | ignoraMenor));      \
+            totalAliados += daCor;                                                                                  \
+            totalAtendidos += daCor & atende;                                                                       \
+        }                                                                                                           \
+        *aliados = totalAliados;                                                                                    \
+        return totalAtendidos;                                                                                      \
+    }
+
+CAPACIDADES_MAPA_FIXO(DEFINIR_MAPA_FIXO)
+
+/// @brief Armazenamento de qualquer um dos mapas fixos. Ocupa apenas o tamanho da maior capacidade, na pilha de main().
+#define MEMBRO_MAPA_FIXO(N) MapaFixo##N mapa##N;
+typedef union
+{
+    CAPACIDADES_MAPA_FIXO(MEMBRO_MAPA_FIXO)
+} ArmazenamentoMapaFixo;
+
 // **** Protótipos das Funções ****
 
 //**** Funções de setup e gerenciamento de memória ****
@@ -34,14 +1037,13 @@ typedef struct
 /// @brief Aloca dinamicamente a memória para o vetor de territórios usando malloc.
 /// @param numTerritorios Número de territórios para alocar em memória.
 /// @return Ponteiro para o vetor de territórios, em caso de sucesso. Ou NULL, em caso de falha.
-Territorio *alocarMapa(int numTerritorios);
+Territorio *alocarMapa(size_t numTerritorios);
 
 /// @brief Libera a memória previamente alocada para o mapa usando free.
 /// @param mapa Ponteiro para o vetor de territorios.
-/// @param missaoJogador Ponteiro para o vetor de caracteres(string) que representa a missão.
 /// @param missoes
 /// @param numMissoes
-void liberarMemoria(Territorio *mapa, char *missaoJogador, char **missoes, int numMissoes);
+void liberarMemoria(Territorio *mapa, char **missoes, size_t numMissoes);
 
 // **** Funções de interface com o usuário: ****
 
@@ -49,7 +1051,7 @@ void liberarMemoria(Territorio *mapa, char *missaoJogador, char **missoes, int n
 /// Esta função modifica o mapa passado por referência (ponteiro).
 /// @param mapa Ponteiro para o vetor de territorios.
 /// @param numTerritorios Número de territórios alocados.
-void cadastrarTerritorios(Territorio *mapa, int numTerritorios);
+void cadastrarTerritorios(Territorio *mapa, size_t numTerritorios);
 
 /// @brief Imprime na tela o menu de ações disponíveis para o jogador.
 /// @param opcao Ponteiro para um inteiro, para conter o valor representado a escolha do jogador.
@@ -60,12 +1062,59 @@ void exibirMenuPrincipal(int *opcao);
 /// @param mapa Ponteiro para o mapa(vetor de territórios) em questão.
 /// @param codigoRetorno Número inteiro. 1 representa um identificador inválido e 2, uma ação cancelada.
 /// @param numTerritorios Número inteiro. Representa os territórios(elementos) alocados no vetor em questão.
-void faseDeAtaque(Territorio *mapa, int *codigoRetorno, int numTerritorios);
+void faseDeAtaque(Territorio *mapa, int *codigoRetorno, size_t numTerritorios);
+
+/// @brief Gerencia a interface do ataque relâmpago (blitz): solicita os territórios, o limite de perdas e o modo,
+/// resolve a batalha inteira em uma única chamada e exibe apenas o resumo final.
+/// @param mapa Ponteiro para o mapa(vetor de territórios) em questão.
+/// @param codigoRetorno Número inteiro. 1 representa um identificador inválido e 2, uma ação cancelada.
+/// @param numTerritorios Número inteiro. Representa os territórios(elementos) alocados no vetor em questão.
+void faseDeBlitz(Territorio *mapa, int *codigoRetorno, size_t numTerritorios);
+
+/// @brief Solicita ao jogador os IDs do atacante e do defensor e valida a escolha.
+/// @param idAtacante Ponteiro para receber o ID (base 1) do território atacante.
+/// @param idDefensor Ponteiro para receber o ID (base 1) do território defensor.
+/// @param numTerritorios Número de territórios alocados.
+/// @return 0 para IDs válidos, 1 para IDs inválidos e 2 para ação cancelada.
+int lerAlvosAtaque(size_t *idAtacante, size_t *idDefensor, size_t numTerritorios);
+
+/// @brief Confere, em mapas com vizinhança, se o defensor faz fronteira com o atacante. Se não fizer, emite
+/// EVENTO_ATAQUE_INVALIDO com o motivo ATAQUE_SEM_FRONTEIRA.
+/// @param mapa Vetor de territórios.
+/// @param idAtacante ID (base 1) do atacante.
+/// @param idDefensor ID (base 1) do defensor.
+/// @param numTerritorios Número de territórios alocados.
+/// @return 1 se o ataque pode seguir, 0 caso contrário.
+int conferirFronteira(Territorio *mapa, size_t idAtacante, size_t idDefensor, size_t numTerritorios);
+
+/// @brief Lê uma linha do jogador contendo o ID (base 1) ou o nome de um território.
+/// Nomes são resolvidos pelo índice hash de nomes.
+/// @param id Ponteiro para receber o ID lido (valores menores que 1 representam a saída).
+/// @return 1 em caso de ID ou nome válido, 0 se o nome informado não existe.
+int lerIdOuNome(long long *id);
+
+/// @brief Exibe o resumo final de um ataque relâmpago.
+/// @param atacante Território atacante, após a batalha.
+/// @param defensor Território defensor, após a batalha.
+/// @param resultado Resumo retornado por atacarBlitz().
+void exibirResultadoBlitz(const Territorio *atacante, const Territorio *defensor, const ResultadoBlitz *resultado);
 
 /// @brief Mostra o estado atual de todos os territórios no mapa, formatado como uma tabela.
 /// @param mapa Ponteiro para o vetor de territórios. Usa 'const' para garantir que a função apenas leia os dados do mapa, sem modificá-los.
 /// @param tamanho Número representando o tamanho do vetor.
-void exibirMapa(const Territorio *mapa, int tamanho);
+void exibirMapa(const Territorio *mapa, size_t tamanho);
+
+/// @brief Mostra um intervalo de territórios, formatando as linhas em blocos antes de escrevê-las.
+/// @param mapa Ponteiro para o vetor de territórios (somente leitura).
+/// @param tamanho Número de territórios do mapa.
+/// @param inicio Índice (base zero) do primeiro território exibido.
+/// @param quantidade Número de territórios a exibir. É limitado ao fim do mapa.
+void exibirMapaIntervalo(const Territorio *mapa, size_t tamanho, size_t inicio, size_t quantidade);
+
+/// @brief Solicita ao jogador um trecho do mapa (ID inicial e quantidade) e o exibe.
+/// @param mapa Ponteiro para o vetor de territórios (somente leitura).
+/// @param tamanho Número de territórios do mapa.
+void faseDeExibirTrecho(const Territorio *mapa, size_t tamanho);
 
 // **** Funções de lógica principal do jogo: ****
 
@@ -73,19 +1122,61 @@ void exibirMapa(const Territorio *mapa, int tamanho);
 /// @param destino Ponteiro referenciando o buffer a ser inicializado e populado, com o conteúdo da missão do jogador.
 /// @param missoes Vetor contendo textos(strings), representando as missões.
 /// @param totalMissoes Número de missões(elementos do vetor), para definição do intervalo de geração de números randômicos.
-void atribuirMissao(char **destino, char *missoes[], int totalMissoes);
+void atribuirMissao(char **destino, char *missoes[], size_t totalMissoes);
 
 /// @brief // Verifica se o jogador cumpriu os requisitos de sua missão atual.
 /// Implementa a lógica para cada tipo de missão (destruir um exército ou conquistar um número de territórios).
+/// Varre o mapa: é o caminho de reserva de verificarMissoesJogadores() quando os agregados não estão disponíveis.
 /// @param missao Missão atual com conteúdo alocado.
+/// @param corJogador Cor do jogador dono da missão.
 /// @param mapa Vetor de territórios, atualmente representando o mapa.
 /// @param tamanho Tamanho do vetor em questão.
 /// @return Retorna 1 (verdadeiro) se a missão foi cumprida. E 0 (falso), caso contrário.
-int verificarMissao(char *missao, const Territorio *mapa, int tamanho);
+int verificarMissao(const char *missao, const char *corJogador, const Territorio *mapa, size_t tamanho);
+
+/// @brief Interpreta o texto de uma missão do catálogo.
+/// @param texto Texto da missão.
+/// @param missao Missão a ser preenchida (tipo e parâmetros).
+/// @return 1 se o texto foi reconhecido, 0 caso contrário.
+int interpretarMissao(const char *texto, MissaoJogador *missao);
+
+/// @brief Sorteia uma missão secreta para cada cor presente no mapa. Uma cor não recebe a missão de eliminar a si mesma.
+/// @param missoes Catálogo de missões.
+/// @param totalMissoes Número de missões do catálogo.
+/// @param corTerminal Cor do jogador do terminal, o único jogador quando o índice de cores não está disponível.
+/// @return 1 em caso de sucesso, 0 em caso de falha de alocação.
+int atribuirMissoesJogadores(char *missoes[], size_t totalMissoes, const char *corTerminal);
+
+/// @brief Busca a missão de uma cor.
+/// @param cor Nome da cor.
+/// @return Missão do jogador, ou NULL se a cor não tem missão.
+const MissaoJogador *missaoDaCor(const char *cor);
+
+/// @brief Avalia uma missão apenas pelos agregados por cor e por região, em O(1).
+/// @param missao Missão do jogador.
+/// @param avaliada Recebe 0 se os agregados não permitem avaliá-la (e o chamador deve varrer o mapa).
+/// @return 1 se a missão foi cumprida.
+int avaliarMissaoPorAgregados(const MissaoJogador *missao, int *avaliada);
+
+/// @brief Verifica as missões de todos os jogadores. Com os agregados, o custo é O(jogadores), sem varrer o mapa.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @param vencedor Recebe o índice do primeiro jogador que cumpriu a missão.
+/// @return Número de jogadores que cumpriram a missão.
+size_t verificarMissoesJogadores(const Territorio *mapa, size_t tamanho, size_t *vencedor);
+
+/// @brief Verifica as missões de todos os jogadores, publica o estado para os espectadores e anuncia o vencedor, se houver.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @return 1 se algum jogador venceu e a partida terminou.
+int anunciarVencedor(const Territorio *mapa, size_t tamanho);
+
+/// @brief Libera as missões dos jogadores.
+void liberarMissoesJogadores();
 
 /// @brief Exibe o conteúdo alocado, representando a missão atual do jogador.
 /// @param missao Ponteiro com o conteúdo(string).
-void exibirMissao(char *missao);
+void exibirMissao(const char *missao);
 
 /// @brief Executa a lógica de uma batalha entre dois territórios.
 /// Realiza validações, rola os dados, compara os resultados e atualiza o número de tropas.
@@ -94,6 +1185,825 @@ void exibirMissao(char *missao);
 /// @param defensor Ponteiro representando o território defensor.
 void atacar(Territorio *atacante, Territorio *defensor);
 
+/// @brief Resolve uma única rodada de dados entre dois territórios, sem nenhuma saída no terminal.
+/// As validações (cor e tropas) são responsabilidade de quem chama.
+/// @param atacante Ponteiro representando o território atacante.
+/// @param defensor Ponteiro representando o território defensor.
+/// @param dadoAtacante Ponteiro para receber o dado sorteado pelo atacante.
+/// @param dadoDefensor Ponteiro para receber o dado sorteado pelo defensor.
+/// @return 1 se o atacante venceu a rodada, 2 se além disso conquistou o território, e 0 se a defesa venceu.
+int resolverRodada(Territorio *atacante, Territorio *defensor, int *dadoAtacante, int *dadoDefensor);
+
+/// @brief Transfere o território defensor para a cor do atacante, movendo metade das tropas do atacante.
+/// @param atacante Ponteiro representando o território atacante.
+/// @param defensor Ponteiro representando o território conquistado.
+void aplicarConquista(Territorio *atacante, Territorio *defensor);
+
+/// @brief Ataque relâmpago: repete as rodadas de atacar() internamente até o defensor ser conquistado,
+/// o atacante ficar com menos de 2 tropas ou o limite de perdas do atacante ser atingido.
+/// Não imprime nada; o resumo é devolvido para a camada de interface.
+/// @param atacante Ponteiro representando o território atacante.
+/// @param defensor Ponteiro representando o território defensor.
+/// @param limitePerdas Número máximo de tropas que o atacante aceita perder. Zero representa sem limite.
+/// @param modo BLITZ_SIMULADO ou BLITZ_DISTRIBUICAO_EXATA.
+/// @return Resumo da batalha.
+ResultadoBlitz atacarBlitz(Territorio *atacante, Territorio *defensor, int limitePerdas, ModoBlitz modo);
+
+/// @brief Aplica ao mapa o desfecho de uma batalha já sorteada, preenchendo o resumo.
+/// @param atacante Território atacante.
+/// @param defensor Território defensor.
+/// @param modo Modo da batalha: atingiuLimite só é marcado nos modos de blitz.
+/// @param perdasAtacante Tropas perdidas pelo atacante.
+/// @param perdasDefensor Tropas perdidas pelo defensor.
+/// @param tropasDefensor Tropas que o defensor precisava perder para ser conquistado.
+/// @param limitePerdas Limite de perdas informado pelo jogador (zero para sem limite). Só conta como atingido se era
+/// menor que as tropas do atacante antes da batalha menos 1.
+/// @param atacanteVenceuUltima 1 se o atacante venceu a última rodada disputada, 0 se foi a defesa.
+/// @param resultado Resumo a ser preenchido.
+void aplicarDesfechoBatalha(Territorio *atacante, Territorio *defensor, ModoOrdem modo, int perdasAtacante, int perdasDefensor,
+                            int tropasDefensor, int limitePerdas, int atacanteVenceuUltima, ResultadoBlitz *resultado);
+
+// **** Ordens de ataque em lote: ****
+
+/// @brief Inicializa o banco de dados a partir de rand(), para que srand() continue controlando as partidas.
+/// @param banco Banco a ser inicializado.
+void iniciarBancoDados(BancoDados *banco);
+
+/// @brief Retira um dado (1 a 6) do banco, sorteando uma nova palavra a cada 24 dados.
+/// @param banco Banco de dados inicializado.
+/// @return Valor do dado.
+int retirarDado(BancoDados *banco);
+
+/// @brief Valida e resolve, em ordem, um vetor de ordens de ataque, sem nenhuma saída no terminal.
+/// IDs e modos são validados antes de qualquer rodada; cor e tropas são validadas no momento
+/// de cada ordem, pois dependem das ordens anteriores. O lote inteiro forma um único ponto de desfazer.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios do mapa.
+/// @param ordens Vetor de ordens.
+/// @param numOrdens Número de ordens.
+/// @param resultados Vetor com espaço para numOrdens resultados.
+/// @param pontoDesfazer 1 para registrar o lote como ponto de desfazer; 0 para jogadas que o jogador não pode desfazer.
+/// @return Número de ordens executadas (codigo 0).
+size_t resolverOrdensEmLote(Territorio *mapa, size_t tamanho, const OrdemAtaque *ordens, size_t numOrdens, ResultadoOrdem *resultados,
+                            int pontoDesfazer);
+
+/// @brief Lê do jogador um lote de ordens (atacante, defensor, modo e limite por linha), resolve e exibe os resultados.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios do mapa.
+void faseDeOrdensEmLote(Territorio *mapa, size_t tamanho);
+
+// **** Snapshots copy-on-write (desfazer, refazer e exploração de hipóteses): ****
+
+/// @brief Cria o histórico do mapa, capturando a versão inicial. É a única cópia completa do mapa.
+/// @param mapa Ponteiro para o vetor de territórios (mapa vivo).
+/// @param tamanho Número de territórios do mapa.
+/// @return Ponteiro para o histórico, ou NULL em caso de falha de alocação.
+HistoricoMapa *criarHistoricoMapa(Territorio *mapa, size_t tamanho);
+
+/// @brief Libera o histórico, todos os snapshots mantidos por ele e os blocos que não forem mais referenciados.
+/// @param historico Ponteiro para o histórico.
+void liberarHistoricoMapa(HistoricoMapa *historico);
+
+/// @brief Registra que um território do mapa vivo foi (ou será) alterado. Custo O(1).
+/// Deve ser chamada por toda rotina que modifica territórios, antes da alteração.
+/// @param territorio Ponteiro para o território dentro do mapa registrado em historicoMapa.
+void marcarTerritorioAlterado(const Territorio *territorio);
+
+/// @brief Captura o estado atual como uma nova versão. Copia apenas os blocos alterados desde a última captura.
+/// @param historico Ponteiro para o histórico.
+/// @return Snapshot com uma referência pertencente a quem chamou (liberar com liberarSnapshot), ou NULL em falha.
+SnapshotMapa *capturarSnapshot(HistoricoMapa *historico);
+
+/// @brief Leva o mapa vivo ao estado de um snapshot. Copia apenas os blocos que diferem entre as versões.
+/// A missão, o turno corrente e o histórico de batalhas também voltam ao ponto capturado.
+/// @param historico Ponteiro para o histórico.
+/// @param snapshot Versão a ser restaurada. A referência de quem chamou é mantida.
+void restaurarSnapshot(HistoricoMapa *historico, SnapshotMapa *snapshot);
+
+/// @brief Descarta uma referência ao snapshot, liberando páginas e blocos que ficarem sem dono.
+/// @param snapshot Snapshot a ser liberado (NULL é ignorado).
+void liberarSnapshot(SnapshotMapa *snapshot);
+
+/// @brief Acessa um território dentro de um snapshot, sem restaurá-lo.
+/// @param snapshot Snapshot consultado.
+/// @param id Índice (base zero) do território.
+/// @return Ponteiro somente leitura para o território naquela versão.
+const Territorio *territorioNoSnapshot(const SnapshotMapa *snapshot, size_t id);
+
+/// @brief Lista os territórios que diferem entre dois snapshots. Páginas e blocos compartilhados são pulados sem comparação.
+/// @param a Primeiro snapshot.
+/// @param b Segundo snapshot.
+/// @param ids Vetor para receber os índices (base zero) dos territórios diferentes. Pode ser NULL.
+/// @param maxIds Capacidade do vetor ids.
+/// @param tamanho Número de territórios do mapa.
+/// @return Número total de territórios diferentes (mesmo que maior que maxIds).
+size_t compararSnapshots(const SnapshotMapa *a, const SnapshotMapa *b, size_t *ids, size_t maxIds, size_t tamanho);
+
+/// @brief Empilha o estado atual como ponto de desfazer e descarta a pilha de refazer. Chamada antes de cada jogada.
+/// @param historico Ponteiro para o histórico.
+void registrarPontoDesfazer(HistoricoMapa *historico);
+
+/// @brief Desfaz a última jogada registrada.
+/// @param historico Ponteiro para o histórico.
+/// @return 1 se algo foi desfeito, 0 se não havia jogadas para desfazer.
+int desfazerJogada(HistoricoMapa *historico);
+
+/// @brief Refaz a última jogada desfeita.
+/// @param historico Ponteiro para o histórico.
+/// @return 1 se algo foi refeito, 0 se não havia jogadas para refazer.
+int refazerJogada(HistoricoMapa *historico);
+
+/// @brief Descarta as pilhas de desfazer e refazer. Usada quando jogadas que o jogador não pode desfazer
+/// (como as do computador) alteram o mapa: desfazer depois delas as apagaria junto com a jogada anterior.
+/// @param historico Ponteiro para o histórico.
+void descartarPontosDesfazer(HistoricoMapa *historico);
+
+/// @brief Exibe os territórios alterados desde o início da partida, comparando snapshots.
+/// @param historico Ponteiro para o histórico.
+void exibirDiferencasDesdeInicio(HistoricoMapa *historico);
+
+// **** Índice de territórios por nome: ****
+
+/// @brief Cria um índice vazio com capacidade para a quantidade esperada de nomes, sem precisar crescer.
+/// @param mapa Ponteiro para o vetor de territórios cujos nomes serão indexados.
+/// @param quantidadeEsperada Número de territórios que serão inseridos.
+/// @return Ponteiro para o índice, ou NULL em caso de falha de alocação.
+IndiceNomes *criarIndiceNomes(const Territorio *mapa, size_t quantidadeEsperada);
+
+/// @brief Constrói o índice completo para um mapa já carregado.
+/// @param mapa Ponteiro para o vetor de territórios.
+/// @param tamanho Número de territórios do mapa.
+/// @return Ponteiro para o índice, ou NULL em caso de falha de alocação.
+IndiceNomes *construirIndiceNomes(const Territorio *mapa, size_t tamanho);
+
+/// @brief Insere o nome do território de índice id. Nomes repetidos mantêm o primeiro território cadastrado.
+/// @param indice Ponteiro para o índice.
+/// @param id Índice (base zero) do território no mapa.
+/// @return 1 se o nome foi inserido, 0 se ele já existia no índice.
+int inserirNomeIndice(IndiceNomes *indice, size_t id);
+
+/// @brief Busca um território pelo nome em O(1) esperado.
+/// @param indice Ponteiro para o índice (NULL resulta em busca sem sucesso).
+/// @param nome Nome exato do território.
+/// @return Índice (base zero) do território, ou ID_INEXISTENTE se o nome não estiver cadastrado.
+size_t buscarTerritorioPorNome(const IndiceNomes *indice, const char *nome);
+
+/// @brief Libera a memória do índice de nomes.
+/// @param indice Ponteiro para o índice (NULL é ignorado).
+void liberarIndiceNomes(IndiceNomes *indice);
+
+// **** Listas de territórios por cor: ****
+
+/// @brief Constrói o registro de cores e as listas de territórios de cada cor em uma única passada pelo mapa.
+/// @param mapa Ponteiro para o vetor de territórios.
+/// @param tamanho Número de territórios do mapa.
+/// @return Ponteiro para o índice, ou NULL em caso de falha de alocação.
+IndiceCores *construirIndiceCores(const Territorio *mapa, size_t tamanho);
+
+/// @brief Libera a memória do índice de cores.
+/// @param indice Ponteiro para o índice (NULL é ignorado).
+void liberarIndiceCores(IndiceCores *indice);
+
+/// @brief Busca o identificador numérico de uma cor.
+/// @param indice Ponteiro para o índice.
+/// @param cor Nome da cor.
+/// @return Identificador da cor (a partir de 0), ou -1 se ela não estiver registrada.
+int buscarCor(const IndiceCores *indice, const char *cor);
+
+/// @brief Registra uma cor, caso ainda não exista.
+/// @param indice Ponteiro para o índice.
+/// @param cor Nome da cor.
+/// @return Identificador da cor, ou -1 em caso de falha de alocação.
+int registrarCor(IndiceCores *indice, const char *cor);
+
+/// @brief Sincroniza os índices com o estado atual de um território do mapa vivo.
+/// Deve ser chamada depois de qualquer alteração de cor ou tropas (conquista, restauração de snapshot etc.).
+/// @param territorio Ponteiro para o território dentro do mapa indexado.
+void atualizarIndicesTerritorio(const Territorio *territorio);
+
+/// @brief Soma (sinal 1) ou subtrai (sinal -1) a contribuição de um território aos agregados de tropas da cor.
+/// @param indice Índice de cores.
+/// @param cor Id da cor.
+/// @param tropas Tropas do território.
+/// @param sinal 1 para somar, -1 para subtrair.
+void contabilizarTropas(IndiceCores *indice, int cor, int tropas, int sinal);
+
+/// @brief Define o limite de tropas das missões e recalcula os agregados de tropas por cor (uma única varredura).
+/// @param indice Índice de cores.
+/// @param limite Limite de tropas (calcTropas).
+void definirLimiteTropas(IndiceCores *indice, int limite);
+
+/// @brief Indica se o índice de cores pode ser usado nas consultas.
+/// @return 1 se o índice existe e está consistente, 0 caso contrário.
+int indiceCoresDisponivel();
+
+// **** Índice de tropas e consultas do mapa: ****
+
+/// @brief Constrói o índice de tropas em uma passada pelo mapa.
+/// @param mapa Ponteiro para o vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @return Ponteiro para o índice, ou NULL em caso de falha de alocação.
+IndiceTropas *construirIndiceTropas(const Territorio *mapa, size_t tamanho);
+
+/// @brief Move o território para o balde das suas tropas atuais, se elas mudaram.
+/// @param indice Índice de tropas (NULL é ignorado).
+/// @param territorio Território alterado.
+void atualizarIndiceTropas(IndiceTropas *indice, const Territorio *territorio);
+
+/// @brief Territórios com mais tropas, em ordem decrescente.
+/// @param indice Índice de tropas.
+/// @param maximo Quantidade máxima de resultados.
+/// @param ids IDs (base zero) encontrados.
+/// @return Quantidade de IDs escritos.
+size_t consultarMaisTropas(const IndiceTropas *indice, size_t maximo, size_t *ids);
+
+/// @brief Territórios com tropas em [minimo, maximoTropas], em ordem decrescente de tropas.
+/// @param indice Índice de tropas.
+/// @param minimo Menor quantidade de tropas aceita.
+/// @param maximoTropas Maior quantidade de tropas aceita.
+/// @param maximo Quantidade máxima de resultados.
+/// @param ids IDs (base zero) encontrados.
+/// @return Quantidade de IDs escritos.
+size_t consultarFaixaTropas(const IndiceTropas *indice, int minimo, int maximoTropas, size_t maximo, size_t *ids);
+
+/// @brief Territórios de uma cor, em ordem de ID, a partir das listas por cor. A lista da cor não guarda ordem
+/// (as remoções por troca são O(1)): os `maximo` menores IDs saem de um heap limitado sobre a lista inteira, em
+/// O(k log maximo) para os k territórios da cor, mais a ordenação do resultado.
+/// @param cor Cor do exército.
+/// @param maximo Quantidade máxima de resultados.
+/// @param ids IDs (base zero) encontrados.
+/// @return Quantidade de IDs escritos.
+size_t consultarCor(const char *cor, size_t maximo, size_t *ids);
+
+/// @brief Consultas do mapa: por cor, por faixa de tropas e os N territórios com mais tropas.
+/// @param mapa Ponteiro para o vetor de territórios.
+void faseDeConsultas(const Territorio *mapa);
+
+/// @brief Libera a memória do índice de tropas.
+/// @param indice Ponteiro para o índice (NULL é ignorado).
+void liberarIndiceTropas(IndiceTropas *indice);
+
+// **** Regiões (continentes) do mapa: ****
+
+/// @brief Cria um conjunto vazio de regiões para o mapa.
+/// @param mapa Vetor de territórios.
+/// @param tamanhoMapa Número de territórios do mapa.
+/// @return Ponteiro para as regiões, ou NULL em caso de falha de alocação.
+MapaRegioes *criarRegioes(const Territorio *mapa, size_t tamanhoMapa);
+
+/// @brief Acrescenta uma região com os territórios informados.
+/// @param regioes Conjunto de regiões.
+/// @param nome Nome da região.
+/// @param ids IDs (base zero) dos membros, em qualquer ordem. Nenhum pode pertencer a outra região.
+/// @param quantidade Número de membros.
+/// @param bonus Tropas de bônus para quem dominar a região.
+/// @return Id da região criada, ou -1 em caso de falha.
+long long adicionarRegiao(MapaRegioes *regioes, const char *nome, const size_t *ids, size_t quantidade, int bonus);
+
+/// @brief Divide um mapa cadastrado manualmente em regiões de territórios consecutivos.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @param territoriosPorRegiao Tamanho aproximado de cada região (zero: sem regiões).
+/// @return Regiões criadas, ou NULL se o mapa é pequeno demais para mais de uma região ou faltar memória.
+MapaRegioes *particionarRegioes(const Territorio *mapa, size_t tamanho, size_t territoriosPorRegiao);
+
+// **** Gerador de mapas: ****
+
+/// @brief Preenche a configuração do gerador com os valores padrão (nenhum mapa gerado).
+void iniciarConfiguracaoGerador(ConfiguracaoGerador *config);
+
+/// @brief Interpreta uma opção de linha de comando do gerador, consumindo o seu valor, se houver.
+/// @param argc Número de argumentos.
+/// @param argv Argumentos.
+/// @param i Posição da opção; avança sobre o valor consumido.
+/// @param config Configuração a preencher.
+/// @return 1 se a opção pertence ao gerador e é válida, 0 caso contrário.
+int interpretarOpcaoGerador(int argc, char *argv[], int *i, ConfiguracaoGerador *config);
+
+/// @brief Gera o mapa direto no vetor, em várias threads. Com vizinhança, também monta o grafo global.
+/// @param config Parâmetros do gerador.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Tamanho do vetor.
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int gerarMapa(ConfiguracaoGerador *config, Territorio *mapa, size_t tamanho);
+
+/// @brief Gera o mapa direto no arquivo, em blocos, sem montá-lo inteiro em memória.
+/// @param config Parâmetros do gerador, com arquivoSaida definido.
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int gerarArquivoMapa(ConfiguracaoGerador *config);
+
+/// @brief Abre um arquivo de mapa e valida o seu cabeçalho.
+/// @param caminho Caminho do arquivo.
+/// @param cabecalho Cabeçalho lido.
+/// @return Arquivo posicionado nos territórios, ou NULL em caso de erro.
+FILE *abrirArquivoMapa(const char *caminho, CabecalhoArquivoMapa *cabecalho);
+
+/// @brief Carrega em blocos os territórios, e a vizinhança se houver, direto no vetor.
+/// @param arquivo Arquivo aberto por abrirArquivoMapa().
+/// @param cabecalho Cabeçalho do arquivo.
+/// @param mapa Vetor de territórios com espaço para todo o arquivo.
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int carregarArquivoMapa(FILE *arquivo, const CabecalhoArquivoMapa *cabecalho, Territorio *mapa);
+
+/// @brief Informa se dois territórios fazem fronteira. Sem vizinhança, qualquer território ataca qualquer outro.
+/// @param a ID (base zero) do primeiro território.
+/// @param b ID (base zero) do segundo território.
+/// @param tamanho Número de territórios do mapa.
+/// @return 1 se fazem fronteira (ou o mapa não tem vizinhança), 0 caso contrário.
+int fazFronteira(size_t a, size_t b, size_t tamanho);
+
+/// @brief Libera o grafo de vizinhança.
+void liberarVizinhanca(GrafoVizinhanca *grafo);
+
+/// @brief Finalizador do splitmix64: espalha os bits de um inteiro de 64 bits.
+uint64_t misturarSplitMix(uint64_t x);
+
+/// @brief Monta os bitsets de posse de cada cor a partir do índice de cores.
+/// @param regioes Conjunto de regiões.
+/// @return 1 em caso de sucesso, 0 se o índice de cores não está disponível ou faltou memória.
+int construirPosseRegioes(MapaRegioes *regioes);
+
+/// @brief Move o território do bitset de posse da cor anterior para o da nova cor.
+/// Chamada pelo índice de cores a cada troca de dono (conquista, desfazer e refazer).
+/// @param id ID (base zero) do território.
+/// @param corAnterior Id da cor anterior no índice de cores.
+/// @param corNova Id da nova cor no índice de cores.
+void atualizarPosseRegioes(size_t id, int corAnterior, int corNova);
+
+/// @brief Indica se a cor domina todos os territórios da região.
+/// @param regioes Conjunto de regiões.
+/// @param regiao Id da região.
+/// @param cor Nome da cor.
+/// @return 1 se domina, 0 caso contrário.
+int regiaoDominadaPor(const MapaRegioes *regioes, size_t regiao, const char *cor);
+
+/// @brief Conta as regiões dominadas pela cor.
+/// @param regioes Conjunto de regiões.
+/// @param cor Nome da cor.
+/// @return Número de regiões dominadas.
+size_t contarRegioesDominadas(const MapaRegioes *regioes, const char *cor);
+
+/// @brief Identifica a cor que domina a região, se houver.
+/// @param regioes Conjunto de regiões.
+/// @param regiao Id da região.
+/// @return Nome da cor dominante, ou NULL se a região está dividida.
+const char *donoDaRegiao(const MapaRegioes *regioes, size_t regiao);
+
+/// @brief Exibe as regiões (até uma página), com bônus e dono atual.
+/// @param regioes Conjunto de regiões.
+void exibirRegioes(const MapaRegioes *regioes);
+
+// **** Histórico de batalhas e conquistas: ****
+
+/// @brief Cria o histórico circular de batalhas, com CAPACIDADE_HISTORICO_BATALHAS registros.
+/// @param mapa Vetor de territórios.
+/// @param tamanhoMapa Número de territórios.
+/// @return Ponteiro para o histórico, ou NULL em caso de falha de alocação.
+HistoricoBatalhas *criarHistoricoBatalhas(const Territorio *mapa, size_t tamanhoMapa);
+
+/// @brief Registra o desfecho de uma batalha. Em conquistas, encadeia o registro no território e na cor perdedora.
+/// @param atacante Território atacante.
+/// @param defensor Território defensor (após a batalha).
+/// @param corDefensorAntes Cor do defensor antes da batalha.
+/// @param perdasAtacante Tropas perdidas pelo atacante.
+/// @param perdasDefensor Tropas perdidas pelo defensor.
+/// @param conquista 1 se o defensor foi conquistado.
+void registrarBatalha(const Territorio *atacante, const Territorio *defensor, const char *corDefensorAntes,
+                      int perdasAtacante, int perdasDefensor, int conquista);
+
+/// @brief Leva o histórico ao ponto de um snapshot restaurado. As batalhas depois do ponto são marcadas como desfeitas;
+/// num refazer, as desfeitas antes dele voltam a valer. Custa o número de batalhas entre o ponto atual e o novo.
+/// @param historico Histórico de batalhas (pode ser NULL).
+/// @param sequencia Ponto do snapshot (sequenciaBatalhas).
+void moverHistoricoBatalhas(HistoricoBatalhas *historico, uint64_t sequencia);
+
+/// @brief Obtém um registro a partir de um elo de cadeia, se ele ainda não foi sobrescrito.
+/// @param historico Histórico de batalhas.
+/// @param elo Sequência do registro mais 1.
+/// @return Registro, ou NULL se o elo é nulo ou o registro já saiu do buffer.
+const RegistroBatalha *registroDoElo(const HistoricoBatalhas *historico, uint64_t elo);
+
+/// @brief Últimas conquistas de um território, da mais recente para a mais antiga.
+/// @param historico Histórico de batalhas.
+/// @param territorio ID (base zero) do território.
+/// @param maximo Número máximo de registros.
+/// @param saida Vetor com espaço para 'maximo' ponteiros.
+/// @return Número de registros encontrados.
+size_t ultimasConquistasDoTerritorio(const HistoricoBatalhas *historico, size_t territorio, size_t maximo, const RegistroBatalha **saida);
+
+/// @brief Territórios perdidos por uma cor nos últimos turnos, do mais recente para o mais antigo.
+/// @param historico Histórico de batalhas.
+/// @param cor Nome da cor.
+/// @param turnos Número de turnos considerados, contando o atual.
+/// @param maximo Número máximo de registros.
+/// @param saida Vetor com espaço para 'maximo' ponteiros.
+/// @return Número de registros encontrados.
+size_t perdasDaCorNosTurnos(const HistoricoBatalhas *historico, const char *cor, int turnos, size_t maximo, const RegistroBatalha **saida);
+
+/// @brief Consulta interativa do histórico: por território ou por cor.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+void faseDeHistorico(const Territorio *mapa, size_t tamanho);
+
+/// @brief Libera o histórico de batalhas.
+/// @param historico Histórico (pode ser NULL).
+void liberarHistoricoBatalhas(HistoricoBatalhas *historico);
+
+// **** Solucionador de fim de jogo (expectimax): ****
+
+/// @brief Prepara o solucionador para a posição atual do mapa: classes de dono, tropas, chave Zobrist e tabela de transposição.
+/// @param s Solucionador a preencher.
+/// @param mapa Vetor de territórios (até MAX_TERRITORIOS_SOLUCIONADOR).
+/// @param tamanho Tamanho do vetor.
+/// @param missao Missão do jogador.
+/// @param baldes Baldes desejados na tabela; em falta de memória, a tabela é reduzida.
+/// @param tropasTotais Recebe o total de tropas do mapa, que limita o comprimento de qualquer partida.
+/// @return 1 em caso de sucesso, 0 se o jogador não tem territórios e -1 em caso de falha de alocação.
+int prepararSolucionador(Solucionador *s, const Territorio *mapa, size_t tamanho, const MissaoJogador *missao, size_t baldes, int *tropasTotais);
+
+/// @brief Calcula a sequência de ataques que maximiza a probabilidade de cumprir a missão do jogador, seguindo as regras
+/// de atacar(): uma rodada por ataque, vitória do atacante com dado maior ou igual, conquista com metade das tropas.
+/// Usa aprofundamento iterativo até a solução exata ou o prazo, com tabela de transposição de memória fixa.
+/// @param mapa Ponteiro para o vetor de territórios (até MAX_TERRITORIOS_SOLUCIONADOR).
+/// @param tamanho Tamanho do vetor.
+/// @param missao Missão do jogador.
+void faseDeSolucionador(const Territorio *mapa, size_t tamanho, const MissaoJogador *missao);
+
+// **** Conselheiro de ataques: ****
+
+/// @brief Preenche, uma única vez, as tabelas de probabilidade de conquista e de perdas esperadas de uma batalha
+/// resolvida até o fim (como no ataque relâmpago), indexadas por perdas permitidas e tropas do defensor.
+void prepararTabelaBatalha(void);
+
+/// @brief Posição de uma batalha na tabela. Defesas maiores que a tabela são reduzidas junto com o atacante, na mesma
+/// proporção, e as perdas esperadas são multiplicadas de volta pela escala; perdas permitidas além da tabela são truncadas.
+/// @param tropasAtacante Tropas do atacante (ao menos 2).
+/// @param tropasDefensor Tropas do defensor (zero conta como 1, como em atacarBlitz()).
+/// @param escala Recebe o fator de redução (1 para batalhas dentro da tabela).
+/// @return Índice nas tabelas de batalha.
+uint32_t celulaBatalha(int tropasAtacante, int tropasDefensor, float *escala);
+
+/// @brief Informa se um território com 'tropas' conta para a missão de tropas do jogador.
+/// @param missao Missão com tipo e limite de tropas.
+/// @param tropas Tropas do território.
+/// @return 1 se atende ao limite, 0 caso contrário.
+int atendeLimiteMissao(const MissaoJogador *missao, int tropas);
+
+/// @brief Contribuição da conquista do defensor para a missão: 1 para um território da cor ou região alvo,
+/// a variação esperada de territórios que atendem ao limite nas missões de tropas (pode ser negativa),
+/// ou o inverso dos territórios que faltam na região do defensor em MISSAO_DOMINAR_REGIOES.
+/// @param conselheiro Consulta em andamento.
+/// @param atacante ID do atacante.
+/// @param defensor ID do defensor.
+/// @param celula Posição da batalha na tabela.
+/// @param escala Fator de redução da batalha.
+/// @return Contribuição para a missão.
+float relevanciaAtaque(Conselheiro *conselheiro, size_t atacante, size_t defensor, uint32_t celula, float escala);
+
+/// @brief Acrescenta um par legal ao lote, pontuando o lote quando ele enche.
+/// @param conselheiro Consulta em andamento.
+/// @param atacante ID do atacante.
+/// @param defensor ID do defensor.
+void adicionarParAtaque(Conselheiro *conselheiro, size_t atacante, size_t defensor);
+
+/// @brief Pontua todos os pares do lote: probabilidade de conquista, ponderada pela contribuição para a missão,
+/// menos a fração de tropas que o atacante espera perder.
+/// @param lote Lote preenchido.
+void pontuarLoteAtaques(LoteAtaques *lote);
+
+/// @brief Pontua o lote, mantém as melhores sugestões e esvazia o lote.
+/// @param conselheiro Consulta em andamento.
+void recolherLoteAtaques(Conselheiro *conselheiro);
+
+/// @brief Insere um território em uma seleção limitada, ordenada por chave crescente, descartando o pior excedente.
+/// @param ids IDs selecionados.
+/// @param chaves Chaves dos IDs selecionados.
+/// @param quantidade Quantidade atual da seleção.
+/// @param maximo Capacidade da seleção.
+/// @param id Território candidato.
+/// @param chave Chave do candidato.
+void inserirSelecao(size_t *ids, int *chaves, size_t *quantidade, size_t maximo, size_t id, int chave);
+
+/// @brief Lista os ataques legais do jogador da missão (cores diferentes, atacante com 2 tropas ou mais e, se o mapa
+/// tiver vizinhança, apenas entre vizinhos) e devolve os mais bem pontuados. Os atacantes saem da lista da cor do
+/// jogador e os defensores da vizinhança de cada um. Sem vizinhança, os pares ficam limitados aos atacantes mais fortes
+/// contra os defensores mais fracos (e os mais fracos entre os alvos da missão), tirados dos índices de cores e tropas.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @param missao Missão do jogador que pede os conselhos.
+/// @param maximo Número máximo de sugestões.
+/// @param sugestoes Vetor com espaço para 'maximo' sugestões.
+/// @param encontradas Recebe o número de sugestões preenchidas.
+/// @param avaliados Recebe o número de pares pontuados.
+/// @return 1 em caso de sucesso, 0 se os índices não estão disponíveis ou faltou memória.
+int aconselharAtaques(const Territorio *mapa, size_t tamanho, const MissaoJogador *missao, size_t maximo,
+                      SugestaoAtaque *sugestoes, size_t *encontradas, size_t *avaliados);
+
+/// @brief Consulta interativa ao conselheiro: pede o número de sugestões e exibe os melhores ataques do jogador.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @param missao Missão do jogador.
+void faseDeConselheiro(const Territorio *mapa, size_t tamanho, const MissaoJogador *missao);
+
+// **** Fase de fortificação: ****
+
+/// @brief Aloca os buffers da busca de caminhos para um mapa de 'tamanho' territórios.
+/// @param tamanho Número de territórios.
+/// @return Busca pronta, ou NULL em caso de falha de alocação.
+BuscaCaminhos *criarBuscaCaminhos(size_t tamanho);
+
+/// @brief Procura o caminho mais curto entre dois territórios passando apenas por territórios da cor da origem.
+/// Usa a vizinhança do mapa; sem vizinhança, todos os territórios de uma cor estão ligados entre si.
+/// Não aloca memória: a busca termina assim que o destino é alcançado.
+/// @param busca Buffers da busca.
+/// @param mapa Vetor de territórios.
+/// @param origem ID da origem (base zero).
+/// @param destino ID do destino (base zero).
+/// @return 1 se o destino é alcançável, 0 caso contrário.
+int buscarCaminhoAliado(BuscaCaminhos *busca, const Territorio *mapa, size_t origem, size_t destino);
+
+/// @brief Reconstrói, da origem ao destino, o caminho encontrado pela última busca bem-sucedida.
+/// O caminho fica nos buffers da busca e vale até a próxima busca.
+/// @param busca Buffers da busca.
+/// @param destino Destino da última busca.
+/// @param caminho Recebe o vetor de IDs do caminho.
+/// @return Número de territórios do caminho, incluindo origem e destino.
+size_t reconstruirCaminho(BuscaCaminhos *busca, size_t destino, const size_t **caminho);
+
+/// @brief Move tropas entre dois territórios da mesma cor ligados por territórios aliados.
+/// A origem mantém ao menos 1 tropa, e o movimento forma um ponto de desfazer.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @param origem ID da origem (base zero).
+/// @param destino ID do destino (base zero).
+/// @param quantidade Tropas a mover.
+/// @return Resultado do movimento.
+ResultadoMovimento moverTropas(Territorio *mapa, size_t tamanho, size_t origem, size_t destino, int quantidade);
+
+/// @brief Fase interativa de fortificação: lê origem, destino e tropas e exibe o caminho usado.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+void faseDeFortificacao(Territorio *mapa, size_t tamanho);
+
+/// @brief Libera os buffers da busca de caminhos.
+/// @param busca Busca (pode ser NULL).
+void liberarBuscaCaminhos(BuscaCaminhos *busca);
+
+// **** Jogadores controlados pelo computador (escalonador cooperativo): ****
+
+/// @brief Ponto de cessão das buscas longas. Fora de uma tarefa do computador, não faz nada. Dentro de uma,
+/// devolve o controle ao escalonador quando a fatia de tempo acabou.
+/// @return 1 se a tarefa foi cancelada e a busca deve encerrar, 0 caso contrário.
+int cederTarefaIA(void);
+
+/// @brief Guarda a melhor jogada encontrada até agora por uma tarefa.
+/// @param tarefa Tarefa do computador.
+/// @param atacante ID do atacante.
+/// @param defensor ID do defensor.
+/// @param modo Modo em que a jogada será resolvida.
+/// @param origem Busca que encontrou a jogada.
+/// @param profundidade Profundidade concluída pelo solucionador (zero para o conselheiro).
+void registrarJogadaIA(TarefaIA *tarefa, size_t atacante, size_t defensor, ModoOrdem modo, const char *origem, int profundidade);
+
+/// @brief Corpo da corrotina de um jogador do computador: uma jogada rápida do conselheiro e, em mapas pequenos,
+/// o aprofundamento iterativo do solucionador, até o fim da busca ou o cancelamento pelo escalonador.
+void executarTarefaIA(void);
+
+/// @brief Prepara a corrotina de uma tarefa sobre uma pilha do conjunto reaproveitado pelo turno.
+/// @param tarefa Tarefa a ser preparada.
+/// @param pilha Pilha de PILHA_TAREFA_IA bytes, livre até a tarefa terminar.
+/// @return 1 em caso de sucesso, 0 se o contexto não pôde ser criado.
+int prepararTarefaIA(TarefaIA *tarefa, void *pilha);
+
+/// @brief Informa, sem bloquear, se o jogador do terminal digitou algo.
+/// @return 1 se há entrada pendente em um terminal interativo, 0 caso contrário.
+int entradaPendente(void);
+
+/// @brief Turno dos jogadores do computador (todas as cores, menos a do terminal). Cada um pensa em sua corrotina,
+/// em fatias de FATIA_IA_NS intercaladas em uma única thread, até terminar a busca ou esgotar o orçamento por jogada;
+/// então joga a melhor jogada encontrada até ali. As tarefas rodam em ondas de até TAREFAS_IA_SIMULTANEAS, que
+/// reaproveitam as mesmas pilhas, e o turno inteiro dura no máximo LIMITE_TURNO_IA_MS.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios.
+/// @param corTerminal Cor do jogador do terminal.
+void turnoDasIAs(Territorio *mapa, size_t tamanho, const char *corTerminal);
+
+// **** Cenários embutidos: ****
+
+/// @brief Procura um cenário embutido pelo nome.
+/// @param nome Nome do cenário (ex.: classico).
+/// @return Cenário encontrado, ou NULL.
+const CenarioEmbutido *buscarCenario(const char *nome);
+
+/// @brief Lista os cenários embutidos e lê a escolha do jogador.
+/// @return Cenário escolhido, ou NULL se o jogador desistiu.
+const CenarioEmbutido *escolherCenario(void);
+
+/// @brief Copia os parâmetros de um cenário para a configuração do gerador.
+/// @param cenario Cenário escolhido.
+/// @param config Configuração do gerador.
+void aplicarCenario(const CenarioEmbutido *cenario, ConfiguracaoGerador *config);
+
+/// @brief Preenche o mapa com os territórios do mapa clássico e monta a sua vizinhança.
+/// @param mapa Vetor com NUM_TERRITORIOS_CLASSICOS posições.
+void carregarMapaClassico(Territorio *mapa);
+
+/// @brief Monta a vizinhança (CSR) do mapa clássico a partir da tabela de fronteiras, com duas alocações.
+/// @return Grafo de vizinhança, ou NULL em caso de falha de alocação.
+GrafoVizinhanca *construirVizinhancaClassica(void);
+
+/// @brief Grava o mapa clássico no formato de arquivo de mapa, com as fronteiras como vizinhança.
+/// Os continentes não fazem parte do formato: carregado do arquivo, o mapa é dividido em regiões como os demais.
+/// @param caminho Arquivo de saída.
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int gravarMapaClassico(const char *caminho);
+
+/// @brief Cria as regiões do mapa clássico, uma por continente, com os bônus da tabela.
+/// @param mapa Vetor de territórios.
+/// @param tamanho Número de territórios (NUM_TERRITORIOS_CLASSICOS).
+/// @return Regiões criadas, ou NULL em caso de falha de alocação.
+MapaRegioes *criarContinentesClassicos(const Territorio *mapa, size_t tamanho);
+
+// **** Armazém colunar de estatísticas de batalhas: ****
+
+/// @brief Cria o armazém de estatísticas, com os blocos de todas as colunas. O diretório é criado se preciso.
+/// @param diretorio Diretório das colunas; deve permanecer válido enquanto o armazém existir.
+/// @return Ponteiro para o armazém, ou NULL em caso de falha.
+ArmazemEstatisticas *criarArmazemEstatisticas(const char *diretorio);
+
+/// @brief Id estável de uma cor no armazém de estatísticas. Uma cor nova é acrescentada ao dicionário do diretório;
+/// depois da primeira busca, o id fica guardado pela posição da cor no índice de cores da partida.
+/// @param cor Nome da cor.
+/// @return Id no dicionário, ou COR_ESTATISTICAS_VAZIA se o dicionário está cheio ou não pôde ser gravado.
+uint16_t idCorEstatisticas(const char *cor);
+
+/// @brief Carrega o dicionário de cores do diretório. Uma última linha incompleta (gravação interrompida) é cortada.
+/// @param armazem Armazém de estatísticas.
+/// @return 1 em caso de sucesso (inclusive sem dicionário), 0 em caso de erro.
+int carregarDicionarioCores(ArmazemEstatisticas *armazem);
+
+/// @brief Acrescenta um nome ao dicionário de cores em memória, ampliando-o se preciso.
+/// @return 1 em caso de sucesso, 0 em caso de falha de alocação.
+int acrescentarNomeCor(ArmazemEstatisticas *armazem, const char *cor);
+
+/// @brief Acrescenta uma batalha ao armazém (se ligado). Turno, ids das cores e missão do atacante são preenchidos aqui.
+/// @param corAtacante Cor do atacante.
+/// @param corDefensor Cor do defensor antes da batalha.
+/// @param amostra Demais campos da batalha.
+void registrarEstatisticaBatalha(const char *corAtacante, const char *corDefensor, const AmostraBatalha *amostra);
+
+/// @brief Acrescenta uma missão cumprida ao armazém (se ligado), com o turno atual.
+/// @param tipo Tipo da missão.
+/// @param cor Cor do vencedor.
+/// @param territorios Tamanho do mapa.
+void registrarEstatisticaMissao(TipoMissao tipo, const char *cor, size_t territorios);
+
+/// @brief Monta o caminho do arquivo de uma coluna, <diretorio>/<tabela>.<campo>.col.
+/// @return 1 em caso de sucesso, 0 se o caminho não cabe em TAM_CAMINHO_ESTATISTICAS.
+int caminhoColuna(char *destino, const char *diretorio, const char *tabela, const char *campo);
+
+/// @brief Abre o arquivo de uma coluna.
+/// @param diretorio Diretório do armazém.
+/// @param tabela "batalhas" ou "missoes".
+/// @param campo Nome da coluna.
+/// @param modo Modo de fopen().
+/// @return Arquivo aberto, ou NULL.
+FILE *abrirColuna(const char *diretorio, const char *tabela, const char *campo, const char *modo);
+
+/// @brief Lê do manifesto as linhas confirmadas de cada tabela.
+/// @return 1 se o manifesto existe e é válido, -1 se é de outra versão do formato, 0 caso contrário.
+int lerManifestoEstatisticas(const char *diretorio, uint64_t *batalhas, uint64_t *missoes);
+
+/// @brief Regrava o manifesto (em um arquivo temporário, renomeado por cima do anterior).
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int gravarManifestoEstatisticas(const char *diretorio, uint64_t batalhas, uint64_t missoes);
+
+/// @brief Ajusta uma coluna ao número de linhas confirmadas: corta o excesso, e reduz `linhas` se a coluna é mais curta.
+/// @param largura Largura de um valor da coluna.
+/// @param linhas Linhas confirmadas; na saída, no máximo as linhas completas do arquivo.
+/// @param cortar 0 para só medir, 1 para cortar o arquivo em `linhas`.
+/// @return 1 em caso de sucesso, 0 em caso de erro.
+int ajustarColuna(const char *diretorio, const char *tabela, const char *campo, size_t largura, uint64_t *linhas, int cortar);
+
+/// @brief Alinha todas as colunas às linhas confirmadas, descartando restos de gravações interrompidas.
+/// Sem manifesto (diretório novo ou anterior ao manifesto), a coluna mais curta de cada tabela define as linhas.
+/// @param armazem Armazém de estatísticas.
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int alinharColunas(ArmazemEstatisticas *armazem);
+
+/// @brief Acrescenta valores ao fim do arquivo de uma coluna.
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int anexarColuna(const char *diretorio, const char *tabela, const char *campo, const void *valores, size_t largura, size_t linhas);
+
+/// @brief Grava as linhas em memória no fim dos arquivos das colunas e esvazia os blocos.
+/// @param armazem Armazém de estatísticas.
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int gravarEstatisticas(ArmazemEstatisticas *armazem);
+
+/// @brief Lê o próximo bloco de várias colunas ao mesmo tempo.
+/// @param arquivos Arquivos das colunas.
+/// @param destinos Vetores com espaço para LINHAS_BLOCO_ESTATISTICAS valores de cada coluna.
+/// @param larguras Largura em bytes de cada coluna.
+/// @param numColunas Número de colunas.
+/// @param restantes Linhas confirmadas ainda não lidas; descontadas as lidas.
+/// @return Linhas lidas, zero no fim das linhas confirmadas.
+size_t lerColunas(FILE **arquivos, void **destinos, const size_t *larguras, size_t numColunas, uint64_t *restantes);
+
+/// @brief Taxa de conquista e perdas médias por faixa de proporção de tropas, separando rodadas únicas de blitz.
+/// @param armazem Armazém de estatísticas, já gravado.
+void consultarConquistasPorProporcao(const ArmazemEstatisticas *armazem);
+
+/// @brief Turno médio, mínimo e máximo de vitória por tipo de missão.
+/// @param armazem Armazém de estatísticas, já gravado.
+void consultarTempoDeMissoes(const ArmazemEstatisticas *armazem);
+
+/// @brief Exibe as consultas agregadas do armazém, incluindo a partida atual.
+void faseDeEstatisticas(void);
+
+/// @brief Libera os blocos do armazém. As linhas ainda não gravadas são descartadas.
+/// @param armazem Armazém (pode ser NULL).
+void liberarArmazemEstatisticas(ArmazemEstatisticas *armazem);
+
+// **** Fase de reforço: ****
+
+/// @brief Calcula os reforços de todas as cores a partir dos agregados mantidos nas conquistas,
+/// sem varrer o mapa: cada cor recebe metade dos territórios que possui (no mínimo REFORCO_MINIMO)
+/// mais o bônus das regiões que domina. As tropas vão para o próximo território da lista da cor, em rodízio.
+/// @param lote Vetor com espaço para uma colocação por cor.
+/// @param capacidade Número de posições do vetor.
+/// @return Número de colocações preenchidas.
+size_t calcularReforcos(ColocacaoTropas *lote, size_t capacidade);
+
+/// @brief Aplica um lote de colocações de tropas ao mapa.
+/// @param mapa Vetor de territórios.
+/// @param lote Colocações calculadas.
+/// @param quantidade Número de colocações.
+void posicionarTropas(Territorio *mapa, const ColocacaoTropas *lote, size_t quantidade);
+
+/// @brief Inicia um novo turno: calcula, aplica e exibe os reforços de cada cor.
+/// @param mapa Vetor de territórios.
+void faseDeReforco(Territorio *mapa);
+
+/// @brief Comparador de IDs para qsort().
+int compararIds(const void *a, const void *b);
+
+/// @brief Libera as regiões e os bitsets de posse.
+/// @param regioes Conjunto de regiões (pode ser NULL).
+void liberarRegioes(MapaRegioes *regioes);
+
+// **** Mapas fixos para partidas pequenas: ****
+
+/// @brief Escolhe a menor capacidade fixa que comporta o mapa e o prepara no armazenamento da pilha.
+/// @param armazenamento Armazenamento (em geral, variável local de main()).
+/// @param numTerritorios Número de territórios da partida.
+/// @return Ponteiro para os territórios, ou NULL se o mapa não cabe em nenhuma capacidade fixa.
+Territorio *prepararMapaFixo(ArmazenamentoMapaFixo *armazenamento, size_t numTerritorios);
+
+/// @brief Copia para o mapa fixo os ids de cor do índice de cores, após construí-lo.
+void sincronizarCoresMapaFixo();
+
+/// @brief Indica se as verificações de missão podem usar o contador especializado do mapa fixo.
+/// @return 1 se há mapa fixo em uso e o índice de cores está consistente.
+int mapaFixoDisponivel();
+
+// **** Eventos do núcleo do jogo: ****
+
+/// @brief Registra um ouvinte para receber todos os eventos emitidos pelo núcleo.
+/// @param ouvinte Função chamada a cada evento.
+/// @param contexto Ponteiro repassado ao ouvinte sem alterações.
+/// @return 1 em caso de sucesso, 0 se o limite de ouvintes foi atingido.
+int registrarOuvinte(OuvinteEvento ouvinte, void *contexto);
+
+/// @brief Remove um ouvinte previamente registrado com o mesmo contexto.
+/// @param ouvinte Função registrada.
+/// @param contexto Contexto usado no registro.
+void removerOuvinte(OuvinteEvento ouvinte, void *contexto);
+
+/// @brief Indica se há ouvintes. O núcleo só monta eventos quando alguém vai recebê-los.
+/// @return Número de ouvintes registrados.
+int haOuvintes();
+
+/// @brief Preenche um evento com o tipo e as cópias dos dados dos territórios envolvidos.
+/// @param evento Evento a ser preenchido. Os demais campos são zerados.
+/// @param tipo Tipo do evento.
+/// @param atacante Território atacante (ou NULL).
+/// @param defensor Território defensor (ou NULL).
+void prepararEvento(EventoJogo *evento, TipoEvento tipo, const Territorio *atacante, const Territorio *defensor);
+
+/// @brief Entrega o evento a todos os ouvintes registrados, na ordem de registro.
+/// @param evento Evento a ser entregue.
+void emitirEvento(const EventoJogo *evento);
+
+/// @brief Ouvinte da interface de terminal: converte cada evento nas mensagens exibidas ao jogador.
+/// @param evento Evento recebido.
+/// @param contexto Não utilizado.
+void imprimirEventoTerminal(const EventoJogo *evento, void *contexto);
+
+/// @brief Calcula o hash FNV-1a de 64 bits de uma string.
+/// @param texto String terminada em '\0'.
+/// @return Valor do hash.
+uint64_t hashTexto(const char *texto);
+
 // **** Funções utilitárias: ****
 
 /// @brief Limpa o buffer de entrada do teclado (stdin), evitando problemas com leituras consecutivas de scanf e getchar.
@@ -108,24 +2018,236 @@ int menorQue(int a, int b);
 int menorOuIgualQue(int a, int b);
 int igualA(int a, int b);
 
-int verificarTropaPelaCor(const char *cor, const Territorio *mapa, int tamanho);
+int verificarTropaPelaCor(const char *cor, const Territorio *mapa, size_t tamanho);
+
+/// @brief Emite EVENTO_MISSAO_CUMPRIDA com os parâmetros da missão.
+void emitirMissaoCumprida(TipoMissao tipo, const char *corJogador, const char *corAlvo, size_t quantidade, int calcTropas);
 
 int verificarCondicaoMissao(
     const Territorio *mapa,
-    int tamanho,
+    size_t tamanho,
     const char *corJogador,
     int (*condicao)(int, int),
     int calcTropas,
-    int territoriosAlmejados);
+    size_t territoriosAlmejados);
 
 MissaoInfo *missaoInfo = NULL;
 
+HistoricoMapa *historicoMapa = NULL;
+IndiceNomes *indiceNomes = NULL;
+IndiceCores *indiceCores = NULL;
+MapaFixoAtivo mapaFixo = {0};
+MapaRegioes *regioes = NULL;
+IndiceTropas *indiceTropas = NULL;
+GrafoVizinhanca *vizinhanca = NULL;
+BuscaCaminhos *buscaCaminhos = NULL; // Criada na primeira fortificação.
+
+// Jogadores do computador: ligados com --ia. O escalonador e as tarefas trocam de contexto na mesma thread.
+int modoIA = 0;
+int orcamentoIAMs = ORCAMENTO_IA_PADRAO_MS;
+TarefaIA *tarefaIAAtual = NULL;
+ucontext_t contextoEscalonador;
+
+ArmazemEstatisticas *armazemEstatisticas = NULL; // Ligado com --estatisticas.
+
+// Tabelas dos cenários embutidos, expandidas das listas X em tempo de compilação.
+#define LINHA_CONTINENTE(id, nome, bonus) {nome, bonus},
+const ContinenteCenario continentesClassicos[NUM_CONTINENTES_CLASSICOS] = {CONTINENTES_CLASSICOS(LINHA_CONTINENTE)};
+#undef LINHA_CONTINENTE
+
+#define LINHA_TERRITORIO(id, nome, continente, cor, tropas) {nome, cor, tropas, CONTINENTE_##continente},
+const TerritorioCenario territoriosClassicos[NUM_TERRITORIOS_CLASSICOS] = {TERRITORIOS_CLASSICOS(LINHA_TERRITORIO)};
+#undef LINHA_TERRITORIO
+
+#define LINHA_FRONTEIRA(a, b) {TERRITORIO_##a, TERRITORIO_##b},
+const FronteiraCenario fronteirasClassicas[] = {FRONTEIRAS_CLASSICAS(LINHA_FRONTEIRA)};
+#undef LINHA_FRONTEIRA
+#define NUM_FRONTEIRAS_CLASSICAS (sizeof(fronteirasClassicas) / sizeof(fronteirasClassicas[0]))
+
+#define LINHA_MISSAO(texto) texto,
+const char *const missoesClassicas[] = {MISSOES_CLASSICAS(LINHA_MISSAO)};
+#undef LINHA_MISSAO
+#define NUM_MISSOES_CLASSICAS (sizeof(missoesClassicas) / sizeof(missoesClassicas[0]))
+
+#define LINHA_CENARIO(id, nome, descricao, quantidade, cores, distribuicao, tropasMaximas, semente, vizinhanca, porRegiao) \
+    {nome, descricao, quantidade, cores, distribuicao, tropasMaximas, semente, vizinhanca, porRegiao},
+const CenarioEmbutido cenariosEmbutidos[NUM_CENARIOS_EMBUTIDOS] = {CENARIOS_EMBUTIDOS(LINHA_CENARIO)};
+#undef LINHA_CENARIO
+int turnoAtual = 0;
+HistoricoBatalhas *historicoBatalhas = NULL;
+MissaoJogador *missoesJogadores = NULL;
+size_t numJogadores = 0;
+size_t *cursorReforco = NULL; // Próxima posição, na lista de cada cor, a receber reforços.
+size_t capacidadeCursorReforco = 0;
+
+// Tabelas de batalha do conselheiro: linha = perdas que o atacante ainda aceita, coluna = tropas do defensor.
+float tabelaConquista[LIMITE_TABELA_BATALHA * LIMITE_TABELA_BATALHA];
+float tabelaPerdasAtacante[LIMITE_TABELA_BATALHA * LIMITE_TABELA_BATALHA];
+float tabelaPerdasDefensor[LIMITE_TABELA_BATALHA * LIMITE_TABELA_BATALHA];
+int tabelaBatalhaPronta = 0;
+
+// Tabela de alcance do solucionador, em double: probabilidade de obter d vitórias de rodada antes de l derrotas.
+double tabelaAlcanceSolucionador[LIMITE_TABELA_BATALHA * LIMITE_TABELA_BATALHA];
+int tabelaAlcancePronta = 0;
+
+OuvinteEvento ouvintesEventos[MAX_OUVINTES];
+void *contextosOuvintes[MAX_OUVINTES];
+int numOuvintes = 0;
+
+EstatisticasMemoria estatisticasMemoria[NUM_CATEGORIAS_MEMORIA];
+
+int rastroAtivo = 0;
+char caminhoRastro[256];
+uint64_t origemRastroNs = 0;
+_Atomic(BufferRastro *) buffersRastro = NULL;
+atomic_uint proximoTidRastro = 1;
+_Thread_local BufferRastro *bufferRastroLocal = NULL;
+
+// Modo com threads: o motor conversa com as threads de entrada e de exibição só por filas SPSC.
+int modoThreads = 0;
+MensagemRender mensagensRender[CAPACIDADE_FILA_RENDER];
+BlocoEntrada blocosEntrada[CAPACIDADE_FILA_ENTRADA];
+FilaSPSC filaRender = {0, 0, CAPACIDADE_FILA_RENDER, sizeof(MensagemRender), (unsigned char *)mensagensRender};
+FilaSPSC filaEntrada = {0, 0, CAPACIDADE_FILA_ENTRADA, sizeof(BlocoEntrada), (unsigned char *)blocosEntrada};
+_Atomic int fimDaEntrada = 0;
+_Atomic size_t mensagensDescartadas = 0;
+int saidaDescartavel = 0; // Só o motor altera: marca a saída atual como despejo do mapa, que pode ser descartado.
+pthread_t threadEntrada, threadRender;
+FILE *saidaTerminal = NULL, *entradaTerminal = NULL;
+
+CabecalhoEspectador *espectadores = NULL;
+size_t tamanhoEspectadores = 0;
+char nomeEspectadores[TAM_NOME_ESPECTADOR]; // Nome da região compartilhada desta partida.
+const char *nomePartida = NULL;             // Ligado com --partida; sem ele, a região leva o PID.
+size_t bytesTotais = 0; // Soma de bytesAtuais de todas as categorias, mantida a cada alocação e liberação.
+size_t bytesPicoTotal = 0;
+
 char *format(const char *fmt, ...);
 
+// **** Rastro da linha do tempo (trace-event do Chrome/Perfetto): ****
+
+/// @brief Liga o rastro. Os trechos passam a ser gravados e o arquivo é escrito ao fim do programa.
+/// @param caminho Caminho do arquivo JSON de saída.
+/// @return 1 em caso de sucesso, 0 se o caminho é longo demais.
+int ativarRastro(const char *caminho);
+
+/// @brief Relógio monotônico em nanossegundos.
+uint64_t relogioNs();
+
+/// @brief Abre um trecho. Com o rastro desligado, custa apenas a leitura de uma flag.
+/// @param nome Nome do trecho (literal: o ponteiro é guardado sem cópia).
+/// @return Trecho em andamento.
+TrechoRastro iniciarTrecho(const char *nome);
+
+/// @brief Fecha o trecho e o grava no buffer da thread atual.
+/// @param trecho Trecho aberto por iniciarTrecho().
+void encerrarTrecho(TrechoRastro *trecho);
+
+/// @brief Escreve todos os buffers no arquivo JSON e os libera. Deve ser chamada com as demais threads encerradas.
+void finalizarRastro();
+
+// Abre um trecho que se encerra sozinho na saída do escopo (atributo cleanup do GCC/Clang), inclusive em returns antecipados.
+#if defined(__GNUC__)
+#define RASTREAR_ESCOPO(nome) TrechoRastro trechoEscopo __attribute__((cleanup(encerrarTrecho))) = iniciarTrecho(nome)
+#else
+#define RASTREAR_ESCOPO(nome) (void)0
+#endif
+
+// **** Espectadores (memória compartilhada com seqlock): ****
+
+/// @brief Tamanho da região compartilhada para as capacidades informadas.
+size_t tamanhoRegiaoEspectador(size_t capacidadeTerritorios, size_t capacidadeJogadores);
+
+/// @brief Monta o nome da região compartilhada de uma partida: PREFIXO_MEMORIA_ESPECTADOR seguido da identificação.
+/// @param destino Buffer com TAM_NOME_ESPECTADOR posições.
+/// @param partida PID (só dígitos) ou nome da partida; sem barras.
+/// @return 1 em caso de sucesso, 0 se a identificação é vazia, tem barras ou é longa demais.
+int montarNomeEspectador(char *destino, const char *partida);
+
+/// @brief Cria a região compartilhada onde o estado da partida é publicado para os espectadores.
+/// A região leva o nome de --partida ou, sem ele, o PID do processo; várias partidas podem correr ao mesmo tempo.
+/// Sem ela, o jogo segue normalmente, apenas sem espectadores.
+/// @param numTerritorios Quantidade de territórios do mapa.
+/// @param jogadores Quantidade de jogadores (cores).
+/// @return 1 em caso de sucesso, 0 caso contrário.
+int criarEspectadores(size_t numTerritorios, size_t jogadores);
+
+/// @brief Publica o mapa e o progresso das missões. O escritor nunca espera pelos leitores.
+/// @param mapa Ponteiro para o vetor de territórios.
+/// @param tamanho Tamanho do vetor.
+/// @param vencedor Índice do jogador vencedor, ou -1.
+void publicarEspectadores(const Territorio *mapa, size_t tamanho, int vencedor);
+
+/// @brief Marca a partida como encerrada para os leitores e remove a região compartilhada.
+void encerrarEspectadores();
+
+/// @brief Modo espectador: acompanha a partida de outro processo até o seu fim, sem travas.
+/// @param partida PID ou nome (--partida) da partida, como exibido pelo jogo ao iniciar.
+/// @return EXIT_SUCCESS, ou EXIT_FAILURE se nenhuma partida foi encontrada.
+int acompanharPartida(const char *partida);
+
+// **** Modo com threads (filas SPSC entre motor, entrada e exibição): ****
+
+/// @brief Insere uma cópia do elemento na fila. Nunca bloqueia.
+/// @return 1 em caso de sucesso, 0 se a fila está cheia.
+int enfileirarSPSC(FilaSPSC *fila, const void *elemento);
+
+/// @brief Retira o elemento mais antigo da fila. Nunca bloqueia.
+/// @return 1 em caso de sucesso, 0 se a fila está vazia.
+int desenfileirarSPSC(FilaSPSC *fila, void *elemento);
+
+/// @brief Separa o jogo em três threads: entrada, motor (a thread principal) e exibição.
+/// A saída e a entrada padrão do motor passam a ser as filas. Com a fila de exibição cheia, o motor espera pelos
+/// textos e eventos da partida; só os despejos de trechos do mapa são descartados (e contados).
+/// @return 1 em caso de sucesso, 0 caso contrário (o jogo segue com uma só thread).
+int ativarModoThreads();
+
+/// @brief Entrega o restante da saída, encerra as threads e devolve os fluxos padrão originais.
+void encerrarModoThreads();
+
+/// @brief Ouvinte do modo com threads: repassa o evento à thread de exibição, que o formata.
+void enfileirarEventoRender(const EventoJogo *evento, void *contexto);
+
+// **** Rastreamento de memória: ****
+
+/// @brief malloc com cabeçalho de rastreamento: contabiliza os bytes na categoria.
+/// @param categoria Categoria da alocação.
+/// @param bytes Tamanho solicitado.
+/// @return Ponteiro para a área utilizável, ou NULL.
+void *alocarRastreado(CategoriaMemoria categoria, size_t bytes);
+
+/// @brief calloc rastreado, com verificação de estouro na multiplicação.
+void *alocarZeradoRastreado(CategoriaMemoria categoria, size_t quantidade, size_t tamanho);
+
+/// @brief realloc rastreado. Um ponteiro NULL equivale a uma nova alocação.
+/// O bloco passa para a categoria informada: os bytes antigos saem da categoria anterior e os novos entram nesta.
+void *realocarRastreado(CategoriaMemoria categoria, void *ponteiro, size_t bytes);
+
+/// @brief free rastreado. Aceita NULL.
+void liberarRastreado(void *ponteiro);
+
+/// @brief Soma dos bytes atualmente alocados em todas as categorias.
+/// @return Bytes em uso (zero quando o rastreamento está desligado).
+size_t bytesEmUso();
+
+/// @brief Exibe os contadores de memória por categoria: bytes atuais, pico, alocações e liberações.
+void exibirRelatorioMemoria();
+
+/// @brief Soma bytes e uma alocação aos contadores da categoria, atualizando os picos.
+void contabilizarAlocacao(CategoriaMemoria categoria, size_t bytes);
+
+/// @brief Subtrai bytes e soma uma liberação aos contadores da categoria.
+void contabilizarLiberacao(CategoriaMemoria categoria, size_t bytes);
+
+/// @brief Sorteia um índice uniforme em [0, limite), mesmo para limites maiores que RAND_MAX.
+/// @param limite Quantidade de valores possíveis. Deve ser maior que zero.
+/// @return Índice sorteado.
+size_t sortearIndice(size_t limite);
+
 /// @brief Função Principal (main). Ponto de entrada do programa.
 /// Orquestra o fluxo do jogo, chamando as outras funções em ordem.
 /// @return Número inteiro. Zero em caso de sucesso, Exemplo: EXIT_SUCCESS. Ou diferente de zero, em caso de falha, Exemplo: EXIT_FAILURE.
-int main()
+int main(int argc, char *argv[])
 {
 #pragma region Instrucoes
 // 1. Configuração Inicial (Setup):
@@ -148,85 +2270,304 @@ int main()
 // - Ao final do jogo, libera a memória alocada para o mapa para evitar vazamentos de memória.
 #pragma endregion
 
+    // Opções de linha de comando.
+    ConfiguracaoGerador gerador;
+    iniciarConfiguracaoGerador(&gerador);
+    const CenarioEmbutido *cenario = NULL;
+    const char *diretorioEstatisticas = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--espectador") == 0)
+        {
+            if (i + 1 < argc)
+                return acompanharPartida(argv[i + 1]);
+            printf(" ❌  Informe a partida a acompanhar: %s --espectador <pid|nome>\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if (strcmp(argv[i], "--partida") == 0 && i + 1 < argc)
+            nomePartida = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            if (!ativarModoThreads())
+                printf(" ⚠️  Não foi possível iniciar as threads. O jogo seguirá com uma só thread.\n");
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            if (!ativarRastro(argv[++i]))
+                printf(" ⚠️  Caminho do arquivo de rastro muito longo. O rastro ficará desligado.\n");
+        }
+        else if (strcmp(argv[i], "--ia") == 0)
+            modoIA = 1;
+        else if (strcmp(argv[i], "--orcamento-ia") == 0 && i + 1 < argc)
+        {
+            modoIA = 1;
+            orcamentoIAMs = atoi(argv[++i]);
+            if (orcamentoIAMs < 1)
+                orcamentoIAMs = ORCAMENTO_IA_PADRAO_MS;
+        }
+        else if (strcmp(argv[i], "--estatisticas") == 0 && i + 1 < argc)
+            diretorioEstatisticas = argv[++i];
+        else if (strcmp(argv[i], "--cenario") == 0 && i + 1 < argc)
+        {
+            cenario = buscarCenario(argv[++i]);
+            if (cenario == NULL)
+                printf(" ⚠️  Cenário desconhecido: %s. O número de territórios 0 lista os cenários disponíveis.\n", argv[i]);
+        }
+        else if (interpretarOpcaoGerador(argc, argv, &i, &gerador))
+            continue;
+        else
+            printf(" ⚠️  Opção desconhecida: %s (uso: %s [--threads] [--trace arquivo.json] [--partida nome]\n"
+                   "     [--gerar N [--cores K] [--tropas uniforme|enviesada|zipf] [--tropas-max M] [--semente S]\n"
+                   "      [--vizinhanca] [--regiao T] [--salvar arquivo]] [--carregar arquivo] [--cenario nome]\n"
+                   "     [--ia [--orcamento-ia ms]] [--estatisticas diretorio] | --espectador pid|nome)\n",
+                   argv[i], argv[0]);
+    }
+
+    // Um cenário de referência passado na linha de comando pode ser gravado em arquivo como qualquer mapa gerado.
+    if (cenario != NULL)
+        aplicarCenario(cenario, &gerador);
+
+    // Geração direto no arquivo, para testes de escala: nenhuma partida é iniciada.
+    // O mapa clássico não vem do gerador: é gravado a partir das suas tabelas.
+    if (gerador.arquivoSaida != NULL && cenario != NULL && cenario->quantidade == 0)
+        return gravarMapaClassico(gerador.arquivoSaida) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (gerador.arquivoSaida != NULL)
+        return gerarArquivoMapa(&gerador) ? EXIT_SUCCESS : EXIT_FAILURE;
+
     srand(time(NULL)); // Inicializa o gerador de números aleatórios.
 
+    // A interface de terminal é apenas um dos consumidores dos eventos do núcleo do jogo.
+    registrarOuvinte(modoThreads ? enfileirarEventoRender : imprimirEventoTerminal, NULL);
+
     printf("====================================\n");
     printf("      💣 WAR ESTRUTURADO 💣 \n");
     printf("====================================\n");
 
-    int numTerritorios;
-    printf("Digite o número de territórios a cadastrar: ");
-    scanf("%d", &numTerritorios); // Em caso de letra, corresponderá a um código numérico. Não foi solicitada a validação de todas as entradas do jogador.
-    limparBufferEntrada();
+    // A quantidade é lida em 64 bits: mapas com bilhões de territórios não cabem em um int.
+    // Mapas gerados ou carregados de arquivo dispensam o cadastro.
+    long long quantidadeLida = 0;
+    CabecalhoArquivoMapa cabecalhoMapa;
+    FILE *arquivoMapa = NULL;
+    if (gerador.arquivoEntrada != NULL)
+    {
+        arquivoMapa = abrirArquivoMapa(gerador.arquivoEntrada, &cabecalhoMapa);
+        if (arquivoMapa == NULL)
+            return EXIT_FAILURE;
+        quantidadeLida = (long long)cabecalhoMapa.numTerritorios;
+    }
+    else if (gerador.quantidade > 0)
+        quantidadeLida = (long long)gerador.quantidade;
+    else if (cenario == NULL)
+    {
+        printf("Digite o número de territórios a cadastrar (0 para um cenário pronto): ");
+        scanf("%lld", &quantidadeLida); // Em caso de letra, corresponderá a um código numérico. Não foi solicitada a validação de todas as entradas do jogador.
+        limparBufferEntrada();
 
-    if (numTerritorios < 2)
+        if (quantidadeLida == 0 && (cenario = escolherCenario()) != NULL)
+        {
+            aplicarCenario(cenario, &gerador);
+            quantidadeLida = (long long)gerador.quantidade;
+        }
+    }
+
+    // O mapa clássico vem inteiro das tabelas const; os demais cenários seguem pelo gerador.
+    int cenarioClassico = cenario != NULL && cenario->quantidade == 0;
+    if (cenarioClassico)
+        quantidadeLida = NUM_TERRITORIOS_CLASSICOS;
+
+    if (quantidadeLida < 2)
     {
         // Não se trata de exceções sem tratamento aqui, mas sim entradas inválidas do jogador.
         printf("\n==== ⚠️  Não há territórios inimigos para enfrentar. Jogo finalizado. \n====");
         return EXIT_SUCCESS;
     }
 
-    // Alocação dinâmica de memória para os territórios
-    Territorio *mapa = alocarMapa(numTerritorios);
+    size_t numTerritorios = (size_t)quantidadeLida;
+
+    // Partidas pequenas usam um mapa fixo na pilha, sem alocação dinâmica. As demais, o heap.
+    ArmazenamentoMapaFixo armazenamentoMapa;
+    Territorio *mapa = prepararMapaFixo(&armazenamentoMapa, numTerritorios);
+
+    if (mapa == NULL)
+        mapa = alocarMapa(numTerritorios);
 
     if (mapa == NULL)
     {
         printf("\n ❌  Erro ao alocar memória para o mapa.\n");
+        if (arquivoMapa != NULL)
+            fclose(arquivoMapa);
         return EXIT_FAILURE;
     }
 
+    // O índice de nomes é preenchido durante o cadastro, para que os ataques aceitem nomes.
+    indiceNomes = criarIndiceNomes(mapa, numTerritorios);
+
     // Cadastrando os territórios.
-    cadastrarTerritorios(mapa, numTerritorios);
+    if (arquivoMapa != NULL || gerador.quantidade > 0 || cenarioClassico)
+    {
+        int preenchido = 1;
+        if (cenarioClassico)
+            carregarMapaClassico(mapa);
+        else
+            preenchido = arquivoMapa != NULL ? carregarArquivoMapa(arquivoMapa, &cabecalhoMapa, mapa) : gerarMapa(&gerador, mapa, numTerritorios);
+        if (arquivoMapa != NULL)
+            fclose(arquivoMapa);
+        if (!preenchido)
+            return EXIT_FAILURE;
+
+        for (size_t i = 0; indiceNomes != NULL && i < numTerritorios; i++)
+            inserirNomeIndice(indiceNomes, i);
+    }
+    else
+        cadastrarTerritorios(mapa, numTerritorios);
+
+    // Listas de territórios por cor. Sem memória para elas, as verificações de missão varrem o mapa.
+    indiceCores = construirIndiceCores(mapa, numTerritorios);
+    indiceTropas = construirIndiceTropas(mapa, numTerritorios);
+    sincronizarCoresMapaFixo();
+
+    // Mapas cadastrados manualmente não têm continentes: dividimos o mapa em regiões de territórios vizinhos no cadastro.
+    // O mapa clássico usa os seus continentes.
+    regioes = cenarioClassico ? criarContinentesClassicos(mapa, numTerritorios) : particionarRegioes(mapa, numTerritorios, gerador.territoriosPorRegiao);
+    if (regioes != NULL)
+        construirPosseRegioes(regioes);
 
     // Atribuir missão ao jogador usando armazenamento dinâmico de missões. Dessa forma, podemos evitar
     // sortear missões desalinhadas com o contexto do cadastro de territórios, como cores de jogadores,
     // ou números de tropas inconsistentes, sorteio de missões para jogadores não cadastrados, entre outros.
 
-    char *missaoJogador = NULL;
+    const char *missaoJogador = NULL;
 
-    char *missoes[numTerritorios + 4];
+    // O catálogo fica no heap: em mapas grandes, um vetor de tamanho variável na pilha estouraria.
+    // Há uma missão de eliminação por cor distinta (vindas do índice de cores), e não mais uma por território.
+    size_t capacidadeMissoes = (indiceCores != NULL ? indiceCores->numCores : numTerritorios) + 4;
+    if (regioes != NULL)
+        capacidadeMissoes += regioes->numRegioes + 1;
+    if (cenarioClassico)
+        capacidadeMissoes += NUM_MISSOES_CLASSICAS;
+    size_t totalMissoes = 0;
+    char **missoes = (char **)ALOCAR(MEMORIA_MISSOES, capacidadeMissoes * sizeof(char *));
+
+    if (missoes == NULL)
+    {
+        printf("\n ❌  Erro ao alocar memória para as missões.\n");
+        return EXIT_FAILURE;
+    }
 
     int minimoTropas = 0;
 
-    for (int i = 0; i < numTerritorios; i++)
+    for (size_t i = 0; i < numTerritorios; i++)
     {
-        missoes[i] = format("Eliminar todas as tropas da cor %s", mapa[i].cor);
         if (minimoTropas > mapa[i].tropas || minimoTropas == 0) // Vamos usar o exército com menor número de tropas como base para os cálculos.
             minimoTropas = mapa[i].tropas;
+
+        // Sem o índice de cores, a repetição de cores é verificada nas próprias missões já criadas.
+        if (indiceCores == NULL)
+        {
+            char *missaoCor = format("Eliminar todas as tropas da cor %s", mapa[i].cor);
+            int repetida = 0;
+            for (size_t m = 0; m < totalMissoes && !repetida; m++)
+                repetida = strcmp(missoes[m], missaoCor) == 0;
+
+            if (repetida)
+                LIBERAR(missaoCor);
+            else
+                missoes[totalMissoes++] = missaoCor;
+        }
     }
 
+    for (size_t c = 0; indiceCores != NULL && c < indiceCores->numCores; c++)
+        missoes[totalMissoes++] = format("Eliminar todas as tropas da cor %s", indiceCores->nomes[c]);
+
     // Usa a razão entre o mínimo de número de tropas e o total de territórios, para efetuar um cálculo rudimentar e
     // tentar evitar incoerências entre as informações da missão e dos exércitos. Atribui um valor padrão de 1, em caso de
     // recuo do valor, pois é uma referência necessária para ao menos poder ocupar um território em caso transferência na batalha.
 
-    int calcTropas = (minimoTropas / numTerritorios) / 2 > 1 ? (minimoTropas / numTerritorios) / 2 : 1;
+    // O cadastro aceita tropas negativas: o mínimo é limitado a zero antes da divisão sem sinal, mantendo o padrão de 1.
+    size_t baseTropas = minimoTropas > 0 ? (size_t)minimoTropas : 0;
+    int calcTropas = (int)((baseTropas / numTerritorios) / 2 > 1 ? (baseTropas / numTerritorios) / 2 : 1);
 
-    missoes[numTerritorios] = format("Conquistar %d territorios", numTerritorios);
-    missoes[numTerritorios + 1] = format("Controlar %d territorios com %d tropa(s) ou mais", numTerritorios, calcTropas);
-    missoes[numTerritorios + 2] = format("Controlar %d territorios com %d tropa(s) ou menos", numTerritorios, calcTropas);
-    missoes[numTerritorios + 3] = format("Controlar %d territorios com exatamente %d tropas", numTerritorios, calcTropas);
+    missoes[totalMissoes++] = format("Conquistar %zu territorios", numTerritorios);
+    missoes[totalMissoes++] = format("Controlar %zu territorios com %d tropa(s) ou mais", numTerritorios, calcTropas);
+    missoes[totalMissoes++] = format("Controlar %zu territorios com %d tropa(s) ou menos", numTerritorios, calcTropas);
+    missoes[totalMissoes++] = format("Controlar %zu territorios com exatamente %d tropas", numTerritorios, calcTropas);
 
-    missaoInfo = (MissaoInfo *)malloc(sizeof(MissaoInfo));
-    strcpy(missaoInfo->corRemanescente, "");
+    // Missões de região: uma por região, e uma de domínio da maioria das regiões.
+    for (size_t r = 0; regioes != NULL && r < regioes->numRegioes; r++)
+        missoes[totalMissoes++] = format("Dominar a região %zu (%s)", r + 1, regioes->nomes[r]);
+    if (regioes != NULL)
+        missoes[totalMissoes++] = format("Dominar %zu regiões", (regioes->numRegioes + 1) / 2);
+    for (size_t m = 0; cenarioClassico && m < NUM_MISSOES_CLASSICAS; m++)
+        missoes[totalMissoes++] = format("%s", missoesClassicas[m]);
+
+    missaoInfo = (MissaoInfo *)ALOCAR(MEMORIA_MISSOES, sizeof(MissaoInfo));
     missaoInfo->calcTropas = calcTropas;
 
-    int totalMissoes = numTerritorios + 4;
+    // Os agregados de tropas por cor passam a usar o limite das missões.
+    if (indiceCoresDisponivel())
+        definirLimiteTropas(indiceCores, calcTropas);
+
+    // Histórico copy-on-write do mapa, usado para desfazer e refazer jogadas.
+    // Sem memória para ele, o jogo segue normalmente, apenas sem essas opções.
+    historicoMapa = criarHistoricoMapa(mapa, numTerritorios);
 
-    atribuirMissao(&missaoJogador, missoes, totalMissoes); // Não podemos apontar para o char em si, mas sim para um vetor de char(para um buffer de texto).
+    // Histórico de batalhas com memória fixa, mesmo em partidas sem fim.
+    historicoBatalhas = criarHistoricoBatalhas(mapa, numTerritorios);
 
-    if (missaoJogador == NULL)
+    // Estatísticas de batalhas em colunas no disco, acumuladas entre partidas.
+    if (diretorioEstatisticas != NULL && (armazemEstatisticas = criarArmazemEstatisticas(diretorioEstatisticas)) == NULL)
+        printf("\n ⚠️  Não foi possível usar o diretório de estatísticas %s. O jogo seguirá sem elas.\n", diretorioEstatisticas);
+
+    // Cada cor presente no mapa é um jogador com sua própria missão secreta.
+    // O jogador do terminal comanda a cor do primeiro território cadastrado.
+    const MissaoJogador *missaoTerminal = atribuirMissoesJogadores(missoes, totalMissoes, mapa[0].cor) ? missaoDaCor(mapa[0].cor) : NULL;
+    if (missaoTerminal == NULL)
     {
         printf("\n ❌  Erro ao alocar memória para a missão.\n");
         return EXIT_FAILURE;
     }
+    missaoJogador = missaoTerminal->texto;
 
     exibirMissao(missaoJogador);
 
+    // Estado da partida publicado para espectadores em outros processos (--espectador).
+    if (criarEspectadores(numTerritorios, numJogadores))
+        publicarEspectadores(mapa, numTerritorios, -1);
+
     char continuar;
+    int inicioDeTurno = 1;
 
     do
     {
         int opcao;
+        int codigoRetorno = 0;
+
+        // Cada turno começa com os reforços; um turno termina quando o jogador efetua uma jogada de ataque.
+        if (inicioDeTurno)
+        {
+            // Depois de cada jogada do terminal, os jogadores do computador jogam antes do próximo turno.
+            if (modoIA && turnoAtual > 0)
+            {
+                turnoDasIAs(mapa, numTerritorios, missaoTerminal->cor);
+
+                // As jogadas do computador podem cumprir uma missão ou eliminar o jogador do terminal antes do reforço.
+                if (anunciarVencedor(mapa, numTerritorios))
+                {
+                    continuar = 'N';
+                    continue;
+                }
+                int corTerminal = indiceCoresDisponivel() ? buscarCor(indiceCores, missaoTerminal->cor) : -1;
+                if (corTerminal >= 0 && indiceCores->quantidade[corTerminal] == 0)
+                {
+                    printf("\n 💀  O exército %s foi eliminado pelo computador. Fim de jogo!\n", missaoTerminal->cor);
+                    continuar = 'N';
+                    continue;
+                }
+            }
+            faseDeReforco(mapa);
+            inicioDeTurno = 0;
+        }
 
         exibirMenuPrincipal(&opcao);
 
@@ -237,8 +2578,6 @@ int main()
             // Antes, vamos exibir as informações do mapa atual ao jogador.
             exibirMapa(mapa, numTerritorios);
 
-            int codigoRetorno;
-
             faseDeAtaque(mapa, &codigoRetorno, numTerritorios);
             // Alguns tratamentos básicos.
             if (codigoRetorno == 1) // Id's inválidos.
@@ -252,11 +2591,97 @@ int main()
                 continue;
             }
 
+            inicioDeTurno = 1;
+            break;
+        case 3:
+            // Ataque relâmpago (blitz): a batalha inteira é resolvida em uma única chamada.
+            exibirMapa(mapa, numTerritorios);
+
+            faseDeBlitz(mapa, &codigoRetorno, numTerritorios);
+            if (codigoRetorno == 1)
+            {
+                continuar = 'S';
+                continue;
+            }
+            else if (codigoRetorno == 2)
+            {
+                continuar = 'N';
+                continue;
+            }
+
+            inicioDeTurno = 1;
             break;
         case 2:
             // Escolha para exibir a missão.
             exibirMissao(missaoJogador);
             break;
+        case 4:
+            // Desfazer a última jogada.
+            if (desfazerJogada(historicoMapa))
+            {
+                printf("\n ↩️  Jogada desfeita.\n");
+                exibirMapa(mapa, numTerritorios);
+            }
+            else
+                printf("\n ⚠️  Não há jogadas para desfazer.\n");
+            break;
+        case 5:
+            // Refazer a última jogada desfeita.
+            if (refazerJogada(historicoMapa))
+            {
+                printf("\n ↪️  Jogada refeita.\n");
+                exibirMapa(mapa, numTerritorios);
+            }
+            else
+                printf("\n ⚠️  Não há jogadas para refazer.\n");
+            break;
+        case 6:
+            // Comparação entre o snapshot inicial e o estado atual.
+            exibirDiferencasDesdeInicio(historicoMapa);
+            break;
+        case 7:
+            // Exibição de um trecho qualquer do mapa, para mapas maiores que uma página.
+            faseDeExibirTrecho(mapa, numTerritorios);
+            break;
+        case 8:
+            // Várias ordens de ataque validadas e resolvidas em uma única chamada.
+            faseDeOrdensEmLote(mapa, numTerritorios);
+            exibirMapa(mapa, numTerritorios);
+            inicioDeTurno = 1;
+            break;
+        case 9:
+            // Regiões, bônus e domínio atual.
+            exibirRegioes(regioes);
+            break;
+        case 10:
+            // Consultas ao histórico de conquistas.
+            faseDeHistorico(mapa, numTerritorios);
+            break;
+        case 11:
+            // Uso de memória por categoria, para acompanhar partidas longas.
+            exibirRelatorioMemoria();
+            break;
+        case 12:
+            // Consultas filtradas, respondidas pelos índices sem percorrer o mapa.
+            faseDeConsultas(mapa);
+            break;
+        case 13:
+            // Probabilidade exata de cumprir a missão e o melhor ataque, para mapas pequenos e finais de partida.
+            faseDeSolucionador(mapa, numTerritorios, missaoTerminal);
+            break;
+        case 14:
+            // Melhores ataques legais do jogador, pontuados em lote.
+            faseDeConselheiro(mapa, numTerritorios, missaoTerminal);
+            break;
+        case 15:
+            // Reposicionamento de tropas por territórios aliados.
+            exibirMapa(mapa, numTerritorios);
+            faseDeFortificacao(mapa, numTerritorios);
+            break;
+        case 16:
+            // Agregados de todas as batalhas registradas no armazém colunar.
+            faseDeEstatisticas();
+            break;
         case 0:
             // Sair.
             continuar = 'N';
@@ -267,10 +2692,9 @@ int main()
             break;
         }
 
-        // Verificando se missão foi cumprida.
-        if (verificarMissao(missaoJogador, mapa, numTerritorios))
+        // Verificando as missões de todos os jogadores de uma só vez.
+        if (anunciarVencedor(mapa, numTerritorios))
         {
-            printf("\n 🎉  Missão cumprida! Jogador vence o jogo!\n");
             continuar = 'N'; // Não foi definido nas regras se após o termino de uma partida, o jogo pode reiniciar.
             continue;
         }
@@ -281,7 +2705,7 @@ int main()
 
     } while (continuar == 's' || continuar == 'S');
 
-    liberarMemoria(mapa, missaoJogador, missoes, totalMissoes);
+    liberarMemoria(mapa, missoes, totalMissoes);
 
     printf("\n====  Fim de jogo!!! ====\n");
 
@@ -290,12 +2714,12 @@ int main()
 
 // ***** Implementação das Funções *****
 
-void atribuirMissao(char **destino, char *missoes[], int totalMissoes)
+void atribuirMissao(char **destino, char *missoes[], size_t totalMissoes)
 {
     // Sorteando o valor da missão.
-    int indice = rand() % totalMissoes;
+    size_t indice = sortearIndice(totalMissoes);
     // Alocando conforme a opção recuperada.
-    *destino = malloc(strlen(missoes[indice]) + 1);
+    *destino = ALOCAR(MEMORIA_MISSOES, strlen(missoes[indice]) + 1);
     // Verificando se a alocação foi efetuada ou não.
     if (*destino == NULL)
     {
@@ -305,7 +2729,7 @@ void atribuirMissao(char **destino, char *missoes[], int totalMissoes)
     strcpy(*destino, missoes[indice]);
 }
 
-void exibirMissao(char *missao)
+void exibirMissao(const char *missao)
 {
     printf("\n ====================================================================== \n");
     printf("\n 🔍  Sua missão: %s\n", missao);
@@ -318,19 +2742,12 @@ int menorQue(int a, int b) { return a < b; }
 int menorOuIgualQue(int a, int b) { return a <= b; }
 int igualA(int a, int b) { return a == b; }
 
-int verificarMissao(char *missao, const Territorio *mapa, int tamanho)
+int verificarMissao(const char *missao, const char *corJogador, const Territorio *mapa, size_t tamanho)
 {
-    char corJogador[10];
-    strcpy(corJogador, missaoInfo->corRemanescente); // Cor do jogador que prevaleceu na batalha atual.
+    RASTREAR_ESCOPO("verificarMissao");
 
     int vitoriaParcial = 0;
 
-    if (corJogador == "")
-    {
-        // A cor do jogador ainda não foi definida. Vamos checar depois de um ataque, pelo menos.\n");
-        return 0;
-    }
-
     int calcTropas = missaoInfo->calcTropas; // Tenta evitar incoerências nos números da missão.
 
     int sucesso = 0;
@@ -342,39 +2759,362 @@ int verificarMissao(char *missao, const Territorio *mapa, int tamanho)
 
         sucesso = verificarTropaPelaCor(corAlvo, mapa, tamanho);
         if (sucesso)
-            printf("\n🎉 O exército %s eliminou todas as tropas da cor %s!\n", corJogador, corAlvo);
+            emitirMissaoCumprida(MISSAO_ELIMINAR_COR, corJogador, corAlvo, tamanho, calcTropas);
     }
     // Ao menos uma tropa por território, sendo que é necessário conquistar todos.
     if (strstr(missao, "Conquistar") != NULL && verificarCondicaoMissao(mapa, tamanho, corJogador, maiorOuIgualQue, calcTropas, tamanho))
     {
-        printf("\n🎉  O exército %s conquistou %d territórios!\n", corJogador, tamanho);
+        emitirMissaoCumprida(MISSAO_CONQUISTAR, corJogador, "", tamanho, calcTropas);
         sucesso = 1;
     }
     // Mais de X tropas.
     if (strstr(missao, "tropa(s) ou mais") && verificarCondicaoMissao(mapa, tamanho, corJogador, maiorOuIgualQue, calcTropas, tamanho))
     {
-        printf("\n 🎉  O exército %s controla %d territórios com %d tropa(s) ou mais!\n", corJogador, tamanho, calcTropas);
+        emitirMissaoCumprida(MISSAO_TROPAS_MINIMAS, corJogador, "", tamanho, calcTropas);
         sucesso = 1;
     }
     // Menos de X tropas.
     if (strstr(missao, "tropa(s) ou menos") && verificarCondicaoMissao(mapa, tamanho, corJogador, menorOuIgualQue, calcTropas, tamanho))
     {
-        printf("\n 🎉  O exército %s controla %d territórios com %d tropa(s) ou menos!\n", corJogador, tamanho, calcTropas);
+        emitirMissaoCumprida(MISSAO_TROPAS_MAXIMAS, corJogador, "", tamanho, calcTropas);
         sucesso = 1;
     }
     // Exatamente X tropas.
     if (strstr(missao, "territorios com exatamente") && verificarCondicaoMissao(mapa, tamanho, corJogador, igualA, calcTropas, tamanho))
     {
-        printf("\n 🎉  O exército %s controla %d territórios com exatamente %d tropas!\n", corJogador, tamanho, calcTropas);
+        emitirMissaoCumprida(MISSAO_TROPAS_EXATAS, corJogador, "", tamanho, calcTropas);
+        sucesso = 1;
+    }
+    // Domínio de uma região específica: o número da região vem no texto da missão.
+    size_t numeroRegiao = 0, regioesAlmejadas = 0;
+    if (regioes != NULL && sscanf(missao, "Dominar a região %zu", &numeroRegiao) == 1 &&
+        numeroRegiao >= 1 && numeroRegiao <= regioes->numRegioes && regiaoDominadaPor(regioes, numeroRegiao - 1, corJogador))
+    {
+        if (haOuvintes())
+        {
+            EventoJogo evento;
+            prepararEvento(&evento, EVENTO_MISSAO_CUMPRIDA, NULL, NULL);
+            evento.motivo = MISSAO_DOMINAR_REGIAO;
+            evento.quantidade = 1;
+            snprintf(evento.corAtacante, TAM_COR, "%s", corJogador);
+            snprintf(evento.nomeDefensor, TAM_NOME, "%s", regioes->nomes[numeroRegiao - 1]);
+            emitirEvento(&evento);
+        }
+        sucesso = 1;
+    }
+    // Domínio de um número de regiões quaisquer.
+    if (regioes != NULL && sscanf(missao, "Dominar %zu regiões", &regioesAlmejadas) == 1 &&
+        contarRegioesDominadas(regioes, corJogador) >= regioesAlmejadas)
+    {
+        emitirMissaoCumprida(MISSAO_DOMINAR_REGIOES, corJogador, "", regioesAlmejadas, calcTropas);
         sucesso = 1;
     }
 
     return sucesso;
 }
 
-int verificarTropaPelaCor(const char *cor, const Territorio *mapa, int tamanho)
+int interpretarMissao(const char *texto, MissaoJogador *missao)
+{
+    const char *prefixoEliminar = "Eliminar todas as tropas da cor ";
+    int limite = 0;
+    size_t quantidade = 0;
+
+    missao->limiteTropas = missaoInfo != NULL ? missaoInfo->calcTropas : 1;
+    missao->corAlvo[0] = '\0';
+    missao->quantidade = 0;
+    missao->regiao = 0;
+
+    if (strncmp(texto, prefixoEliminar, strlen(prefixoEliminar)) == 0)
+    {
+        missao->tipo = MISSAO_ELIMINAR_COR;
+        snprintf(missao->corAlvo, TAM_COR, "%s", texto + strlen(prefixoEliminar));
+        return 1;
+    }
+    if (sscanf(texto, "Conquistar %zu territorios", &quantidade) == 1)
+    {
+        missao->tipo = MISSAO_CONQUISTAR;
+        missao->quantidade = quantidade;
+        return 1;
+    }
+    if (sscanf(texto, "Controlar %zu territorios com %d", &quantidade, &limite) == 2 ||
+        sscanf(texto, "Controlar %zu territorios com exatamente %d", &quantidade, &limite) == 2)
+    {
+        missao->quantidade = quantidade;
+        missao->limiteTropas = limite;
+        if (strstr(texto, "ou mais") != NULL)
+            missao->tipo = MISSAO_TROPAS_MINIMAS;
+        else if (strstr(texto, "ou menos") != NULL)
+            missao->tipo = MISSAO_TROPAS_MAXIMAS;
+        else
+            missao->tipo = MISSAO_TROPAS_EXATAS;
+        return 1;
+    }
+    if (sscanf(texto, "Dominar a região %zu", &quantidade) == 1 && quantidade >= 1)
+    {
+        missao->tipo = MISSAO_DOMINAR_REGIAO;
+        missao->regiao = quantidade - 1;
+        missao->quantidade = 1;
+        return 1;
+    }
+    if (sscanf(texto, "Dominar %zu regiões", &quantidade) == 1)
+    {
+        missao->tipo = MISSAO_DOMINAR_REGIOES;
+        missao->quantidade = quantidade;
+        return 1;
+    }
+
+    return 0;
+}
+
+int atribuirMissoesJogadores(char *missoes[], size_t totalMissoes, const char *corTerminal)
+{
+    // Sem o índice de cores, só o jogador do terminal recebe missão.
+    size_t jogadores = indiceCoresDisponivel() ? indiceCores->numCores : 1;
+
+    missoesJogadores = (MissaoJogador *)ALOCAR_ZERADO(MEMORIA_MISSOES, jogadores, sizeof(MissaoJogador));
+    if (missoesJogadores == NULL)
+        return 0;
+
+    for (size_t j = 0; j < jogadores; j++)
+    {
+        MissaoJogador *missao = &missoesJogadores[j];
+        snprintf(missao->cor, TAM_COR, "%s", indiceCoresDisponivel() ? indiceCores->nomes[j] : corTerminal);
+
+        // Eliminar a própria cor não é uma missão: sorteia de novo algumas vezes.
+        int propria = 0;
+        for (int tentativa = 0; tentativa < 8; tentativa++)
+        {
+            LIBERAR(missao->texto);
+            atribuirMissao(&missao->texto, missoes, totalMissoes);
+            if (missao->texto == NULL)
+            {
+                numJogadores = j + 1;
+                return 0;
+            }
+
+            propria = interpretarMissao(missao->texto, missao) && missao->tipo == MISSAO_ELIMINAR_COR && strcmp(missao->corAlvo, missao->cor) == 0;
+            if (!propria)
+                break;
+        }
+
+        // Se os sorteios insistirem na própria cor, percorre o catálogo a partir da posição do jogador e fica com a
+        // primeira missão que não seja eliminar a si mesmo.
+        for (size_t m = 0; propria && m < totalMissoes; m++)
+        {
+            const char *candidata = missoes[(j + m) % totalMissoes];
+            MissaoJogador alternativa = {0};
+            if (interpretarMissao(candidata, &alternativa) && alternativa.tipo == MISSAO_ELIMINAR_COR && strcmp(alternativa.corAlvo, missao->cor) == 0)
+                continue;
+
+            LIBERAR(missao->texto);
+            missao->texto = ALOCAR(MEMORIA_MISSOES, strlen(candidata) + 1);
+            if (missao->texto == NULL)
+            {
+                numJogadores = j + 1;
+                return 0;
+            }
+            strcpy(missao->texto, candidata);
+            interpretarMissao(missao->texto, missao);
+            propria = 0;
+        }
+    }
+
+    numJogadores = jogadores;
+    return 1;
+}
+
+const MissaoJogador *missaoDaCor(const char *cor)
+{
+    if (indiceCoresDisponivel())
+    {
+        int idCor = buscarCor(indiceCores, cor);
+        return idCor >= 0 && (size_t)idCor < numJogadores ? &missoesJogadores[idCor] : NULL;
+    }
+
+    for (size_t j = 0; j < numJogadores; j++)
+        if (strcmp(missoesJogadores[j].cor, cor) == 0)
+            return &missoesJogadores[j];
+    return NULL;
+}
+
+int avaliarMissaoPorAgregados(const MissaoJogador *missao, int *avaliada)
+{
+    *avaliada = 0;
+    if (!indiceCoresDisponivel() || missao->limiteTropas != indiceCores->limiteTropas)
+        return 0;
+
+    int cor = buscarCor(indiceCores, missao->cor);
+    if (cor < 0)
+        return 0;
+
+    size_t possuidos = indiceCores->quantidade[cor];
+    size_t acima = indiceCores->acimaDoLimite[cor], abaixo = indiceCores->abaixoDoLimite[cor];
+    int usaRegioes = regioes != NULL && regioes->posseValida;
+
+    *avaliada = 1;
+    switch (missao->tipo)
+    {
+    case MISSAO_ELIMINAR_COR:
+    {
+        int alvo = buscarCor(indiceCores, missao->corAlvo);
+        return alvo < 0 || indiceCores->comTropas[alvo] == 0;
+    }
+    case MISSAO_CONQUISTAR:
+    case MISSAO_TROPAS_MINIMAS:
+        return acima >= missao->quantidade;
+    case MISSAO_TROPAS_MAXIMAS:
+        return abaixo >= missao->quantidade;
+    case MISSAO_TROPAS_EXATAS:
+        // Quem está acima e abaixo do limite ao mesmo tempo tem exatamente o limite.
+        return acima + abaixo - possuidos >= missao->quantidade;
+    case MISSAO_DOMINAR_REGIAO:
+        if (!usaRegioes || missao->regiao >= regioes->numRegioes)
+            break;
+        return regioes->donoRegiao[missao->regiao] == cor;
+    case MISSAO_DOMINAR_REGIOES:
+        if (!usaRegioes || (size_t)cor >= regioes->numCoresPosse)
+            break;
+        return regioes->regioesPorCor[cor] >= missao->quantidade;
+    }
+
+    *avaliada = 0;
+    return 0;
+}
+
+size_t verificarMissoesJogadores(const Territorio *mapa, size_t tamanho, size_t *vencedor)
+{
+    RASTREAR_ESCOPO("verificarMissoesJogadores");
+
+    size_t vencedores = 0;
+
+    for (size_t j = 0; j < numJogadores; j++)
+    {
+        const MissaoJogador *missao = &missoesJogadores[j];
+        int avaliada;
+        int cumprida = avaliarMissaoPorAgregados(missao, &avaliada);
+
+        // Jogadores já eliminados não vencem.
+        if (avaliada && indiceCores->quantidade[buscarCor(indiceCores, missao->cor)] == 0)
+            continue;
+
+        if (!avaliada)
+        {
+            cumprida = verificarMissao(missao->texto, missao->cor, mapa, tamanho);
+        }
+        else if (cumprida && missao->tipo == MISSAO_DOMINAR_REGIAO)
+        {
+            if (haOuvintes())
+            {
+                EventoJogo evento;
+                prepararEvento(&evento, EVENTO_MISSAO_CUMPRIDA, NULL, NULL);
+                evento.motivo = MISSAO_DOMINAR_REGIAO;
+                evento.quantidade = 1;
+                snprintf(evento.corAtacante, TAM_COR, "%s", missao->cor);
+                snprintf(evento.nomeDefensor, TAM_NOME, "%s", regioes->nomes[missao->regiao]);
+                emitirEvento(&evento);
+            }
+        }
+        else if (cumprida)
+        {
+            emitirMissaoCumprida(missao->tipo, missao->cor, missao->corAlvo, missao->quantidade, missao->limiteTropas);
+        }
+        else if (missao->tipo >= MISSAO_CONQUISTAR && missao->tipo <= MISSAO_TROPAS_EXATAS && haOuvintes())
+        {
+            // Caso raro: território suficientes ocupados, mas requisitos de tropas não atendidos.
+            // Só então a lista da cor é percorrida, para nomear o território reprovado.
+            int cor = buscarCor(indiceCores, missao->cor);
+            if (indiceCores->quantidade[cor] >= missao->quantidade)
+            {
+                int (*condicao)(int, int) = missao->tipo == MISSAO_TROPAS_MAXIMAS ? menorOuIgualQue
+                                            : missao->tipo == MISSAO_TROPAS_EXATAS  ? igualA
+                                                                                    : maiorOuIgualQue;
+                for (size_t k = 0; k < indiceCores->quantidade[cor]; k++)
+                {
+                    const Territorio *territorio = &mapa[indiceCores->membros[cor][k]];
+                    if (!condicao(territorio->tropas, missao->limiteTropas))
+                    {
+                        EventoJogo evento;
+                        prepararEvento(&evento, EVENTO_MISSAO_FRACASSADA, NULL, territorio);
+                        evento.calcTropas = missao->limiteTropas;
+                        evento.quantidade = missao->quantidade;
+                        emitirEvento(&evento);
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (cumprida && vencedores++ == 0)
+            *vencedor = j;
+    }
+
+    return vencedores;
+}
+
+int anunciarVencedor(const Territorio *mapa, size_t tamanho)
 {
-    for (int i = 0; i < tamanho; i++)
+    size_t vencedor;
+    size_t vencedores = verificarMissoesJogadores(mapa, tamanho, &vencedor);
+    publicarEspectadores(mapa, tamanho, vencedores > 0 ? (int)vencedor : -1);
+    if (vencedores == 0)
+        return 0;
+
+    printf("\n 🎉  Missão cumprida! O exército %s vence o jogo!\n", missoesJogadores[vencedor].cor);
+    registrarEstatisticaMissao(missoesJogadores[vencedor].tipo, missoesJogadores[vencedor].cor, tamanho);
+    return 1;
+}
+
+void liberarMissoesJogadores()
+{
+    for (size_t j = 0; j < numJogadores; j++)
+        LIBERAR(missoesJogadores[j].texto);
+    LIBERAR(missoesJogadores);
+    missoesJogadores = NULL;
+    numJogadores = 0;
+}
+
+void emitirMissaoCumprida(TipoMissao tipo, const char *corJogador, const char *corAlvo, size_t quantidade, int calcTropas)
+{
+    if (!haOuvintes())
+        return;
+
+    EventoJogo evento;
+    prepararEvento(&evento, EVENTO_MISSAO_CUMPRIDA, NULL, NULL);
+    evento.motivo = tipo;
+    evento.quantidade = quantidade;
+    evento.calcTropas = calcTropas;
+    snprintf(evento.corAtacante, TAM_COR, "%s", corJogador);
+    snprintf(evento.corDefensor, TAM_COR, "%s", corAlvo);
+    emitirEvento(&evento);
+}
+
+int verificarTropaPelaCor(const char *cor, const Territorio *mapa, size_t tamanho)
+{
+    // Mapa fixo: uma única passada sem desvios por toda a capacidade conta os territórios da cor ainda com tropas.
+    if (mapaFixoDisponivel())
+    {
+        int idCor = buscarCor(indiceCores, cor);
+        if (idCor < 0)
+            return 1;
+
+        size_t aliados;
+        return mapaFixo.contar(mapa, mapaFixo.corIds, (uint8_t)idCor, 1, 1, 0, &aliados) == 0;
+    }
+
+    // Com o índice de cores, apenas os territórios da cor alvo são visitados.
+    if (indiceCoresDisponivel())
+    {
+        int idCor = buscarCor(indiceCores, cor);
+        if (idCor < 0)
+            return 1;
+
+        for (size_t k = 0; k < indiceCores->quantidade[idCor]; k++)
+            if (mapa[indiceCores->membros[idCor][k]].tropas > 0)
+                return 0;
+        return 1;
+    }
+
+    for (size_t i = 0; i < tamanho; i++)
         if (strcmp(mapa[i].cor, cor) == 0 && mapa[i].tropas > 0)
             return 0;
     return 1;
@@ -382,52 +3122,95 @@ int verificarTropaPelaCor(const char *cor, const Territorio *mapa, int tamanho)
 
 int verificarCondicaoMissao(
     const Territorio *mapa,
-    int tamanho,
+    size_t tamanho,
     const char *corJogador,
     int (*condicao)(int, int),
     int calcTropas,
-    int territoriosAlmejados)
+    size_t territoriosAlmejados)
 {
-    int territoriosAliados = 0;
+    size_t territoriosAliados = 0, territoriosAtendidos = 0;
+    const Territorio *primeiroReprovado = NULL;
 
-    int sucesso = 0;
+    int exigeMaiorOuIgual = condicao == maiorOuIgualQue || condicao == igualA;
+    int exigeMenorOuIgual = condicao == menorOuIgualQue || condicao == igualA;
 
-    for (int i = 0; i < tamanho; i++)
+    if (mapaFixoDisponivel() && (exigeMaiorOuIgual || exigeMenorOuIgual))
     {
-        if (strcmp(mapa[i].cor, corJogador) == 0 && condicao(mapa[i].tropas, calcTropas))
-        {
-            territoriosAliados++;
+        int idCor = buscarCor(indiceCores, corJogador);
+        if (idCor < 0)
+            return 0;
 
-            if (territoriosAliados == territoriosAlmejados)
-            {
-                // Territórios almejados ocupados e requisitos de tropas atendidos.
-                sucesso = territoriosAliados == territoriosAlmejados;
-                break;
-            }
+        territoriosAtendidos = mapaFixo.contar(mapa, mapaFixo.corIds, (uint8_t)idCor, calcTropas,
+                                               exigeMaiorOuIgual, exigeMenorOuIgual, &territoriosAliados);
+
+        // O território reprovado só é procurado no caso raro em que a mensagem de fracasso será emitida.
+        if (territoriosAtendidos < territoriosAlmejados && territoriosAliados >= territoriosAlmejados)
+            for (size_t i = 0; i < tamanho && primeiroReprovado == NULL; i++)
+                if (mapaFixo.corIds[i] == (uint8_t)idCor && !condicao(mapa[i].tropas, calcTropas))
+                    primeiroReprovado = &mapa[i];
+    }
+    else if (indiceCoresDisponivel())
+    {
+        // Percorre apenas os territórios da cor do jogador: custo proporcional ao que ele possui.
+        int idCor = buscarCor(indiceCores, corJogador);
+        if (idCor < 0)
+            return 0;
+
+        territoriosAliados = indiceCores->quantidade[idCor];
+        for (size_t k = 0; k < territoriosAliados; k++)
+        {
+            const Territorio *territorio = &mapa[indiceCores->membros[idCor][k]];
+            if (condicao(territorio->tropas, calcTropas))
+                territoriosAtendidos++;
+            else if (primeiroReprovado == NULL)
+                primeiroReprovado = territorio;
         }
-        else if (strcmp(mapa[i].cor, corJogador) == 0)
+    }
+    else
+    {
+        for (size_t i = 0; i < tamanho; i++)
         {
-            territoriosAliados++;
+            if (strcmp(mapa[i].cor, corJogador) != 0)
+                continue;
 
-            if (territoriosAliados == territoriosAlmejados)
-            {
-                // Não adianta continuar o jogo para esse território. Embora tenha ocupado os territórios almejados, fracassou nos requisitos da missão.
-                printf("\n  ⚠️  A missão fracassou para %s, cor %s ! Embora tenha ocupado os territórios almejados, os requisitos de tropas não foram atendidos.\n",
-                       mapa[i].nome, mapa[i].cor);
-                break;
-            }
+            territoriosAliados++;
+            if (condicao(mapa[i].tropas, calcTropas))
+                territoriosAtendidos++;
+            else if (primeiroReprovado == NULL)
+                primeiroReprovado = &mapa[i];
         }
     }
 
-    return sucesso;
+    // Territórios almejados ocupados e requisitos de tropas atendidos.
+    if (territoriosAtendidos >= territoriosAlmejados)
+        return 1;
+
+    if (territoriosAliados >= territoriosAlmejados && primeiroReprovado != NULL && haOuvintes())
+    {
+        // Não adianta continuar o jogo para esse território. Embora tenha ocupado os territórios almejados, fracassou nos requisitos da missão.
+        EventoJogo evento;
+        prepararEvento(&evento, EVENTO_MISSAO_FRACASSADA, NULL, primeiroReprovado);
+        evento.calcTropas = calcTropas;
+        evento.quantidade = territoriosAlmejados;
+        emitirEvento(&evento);
+    }
+
+    return 0;
 }
 
-Territorio *alocarMapa(int numTerritorios)
+Territorio *alocarMapa(size_t numTerritorios)
 {
     // malloc converte implicitamente para qualquer outro tipo de ponteiro. Portanto, o cast aqui é opcional.
     // Mas nenhuma convenção foi estabelecida para o uso. Por isso, foi mantido.
 
-    Territorio *vetor = (Territorio *)malloc(numTerritorios * sizeof(Territorio));
+    // Em mapas gigantes, a multiplicação do número de bytes pode estourar o size_t antes mesmo de chegar ao malloc.
+    if (numTerritorios == 0 || numTerritorios > SIZE_MAX / sizeof(Territorio))
+    {
+        printf(" ❌  Número de territórios excede o limite endereçável!\n");
+        return NULL;
+    }
+
+    Territorio *vetor = (Territorio *)ALOCAR(MEMORIA_MAPA, numTerritorios * sizeof(Territorio));
 
     if (vetor == NULL)
     {
@@ -440,170 +3223,6177 @@ Territorio *alocarMapa(int numTerritorios)
 
 void exibirMenuPrincipal(int *opcao)
 {
+    RASTREAR_ESCOPO("exibirMenuPrincipal");
+
     printf("\n ==== Menu de Ações ==== \n");
     printf("\n1 - Atacar. \n");
     printf("2 - Verificar missão. \n");
+    printf("3 - Ataque relâmpago (blitz). \n");
+    printf("4 - Desfazer jogada. \n");
+    printf("5 - Refazer jogada. \n");
+    printf("6 - Alterações desde o início. \n");
+    printf("7 - Exibir trecho do mapa. \n");
+    printf("8 - Ordens em lote. \n");
+    printf("9 - Regiões do mapa. \n");
+    printf("10 - Histórico de conquistas. \n");
+    printf("11 - Relatório de memória. \n");
+    printf("12 - Consultar territórios (cor, tropas, maiores exércitos). \n");
+    printf("13 - Melhor sequência de ataques (solucionador). \n");
+    printf("14 - Conselheiro de ataques. \n");
+    printf("15 - Fortificar (mover tropas entre territórios aliados). \n");
+    printf("16 - Estatísticas de batalhas. \n");
     printf("0 - Sair. \n");
     printf("Escolha uma opção: ");
     // Já temos um ponteiro aqui. Não precisamos aplicar o &.
     if (scanf("%d", opcao) != 1)
     {
-        *opcao = 3; // Vamos assumir um retorno para uma entrada inválida.
+        *opcao = -1; // Vamos assumir um retorno para uma entrada inválida.
     };
     limparBufferEntrada();
 }
 
-void faseDeAtaque(Territorio *mapa, int *codigoRetorno, int numTerritorios)
+int lerAlvosAtaque(size_t *idAtacante, size_t *idDefensor, size_t numTerritorios)
 {
-    int idAtacante, idDefensor;
+    // Os IDs são lidos como long long para aceitar o 0 (sair) e valores negativos sem estourar o size_t.
+    long long atacante = 0, defensor = 0;
 
-    printf("\n==== FASE DE ATAQUE ====\n");
+    printf("\n ⚔️  Escolha o território atacante [ID ou nome] de %d a %zu, ou 0 para sair: ", 1, numTerritorios);
+    int atacanteEncontrado = lerIdOuNome(&atacante);
 
-    printf("\n ⚔️  Escolha o território atacante [ID] de %d a %d, ou 0 para sair: ", 1, numTerritorios);
-    scanf("%d", &idAtacante);
-    limparBufferEntrada();
+    printf("\n 🛡️  Escolha o território defensor [ID ou nome] de %d a %zu, ou 0 para sair: ", 1, numTerritorios);
+    int defensorEncontrado = lerIdOuNome(&defensor);
 
-    printf("\n 🛡️  Escolha o território defensor [ID] de %d a %d, ou 0 para sair: ", 1, numTerritorios);
-    scanf("%d", &idDefensor);
-    limparBufferEntrada();
+    if (!atacanteEncontrado || !defensorEncontrado)
+    {
+        printf("\n ⚠️  Território não encontrado. Tente novamente.\n");
+        return 1;
+    }
 
-    if (idAtacante > numTerritorios || idDefensor > numTerritorios)
+    if ((atacante > 0 && (unsigned long long)atacante > numTerritorios) || (defensor > 0 && (unsigned long long)defensor > numTerritorios))
     {
         printf("\n ⚠️  IDs inválidos. Tente novamente.\n");
-        *codigoRetorno = 1;
-        return;
+        return 1;
     }
-    else if (idAtacante == idDefensor)
+    else if (atacante == defensor && atacante > 0)
     {
         printf("\n ⚠️  Um território não pode atacar a si mesmo.\n");
-        *codigoRetorno = 1;
-        return;
+        return 1;
     }
-    else if (idAtacante < 1 || idDefensor < 1)
+    else if (atacante < 1 || defensor < 1)
     {
         printf("\n ❌  A ação foi cancelada.\n");
-        *codigoRetorno = 2;
-        return;
+        return 2;
     }
 
-    // Como o vetor é baseado em índice zero, precisamos informar a posição atual de forma adequada.
-    atacar(&mapa[idAtacante - 1], &mapa[idDefensor - 1]);
+    *idAtacante = (size_t)atacante;
+    *idDefensor = (size_t)defensor;
+    return 0;
 }
 
-void exibirMapa(const Territorio *mapa, int tamanho)
+int conferirFronteira(Territorio *mapa, size_t idAtacante, size_t idDefensor, size_t numTerritorios)
 {
-    printf("\n==== 🌍  MAPA DO MUNDO - ESTADO ATUAL ====\n\n");
-    // Evitar mostrar o número do exército baseado no índice zero.
-    for (int i = 0; i < tamanho; i++)
+    if (fazFronteira(idAtacante - 1, idDefensor - 1, numTerritorios))
+        return 1;
+
+    if (haOuvintes())
     {
-        printf("[%d] %s | Exército Cor: %s | Tropas: %d\n", i + 1, mapa[i].nome, mapa[i].cor, mapa[i].tropas);
+        EventoJogo evento;
+        prepararEvento(&evento, EVENTO_ATAQUE_INVALIDO, &mapa[idAtacante - 1], &mapa[idDefensor - 1]);
+        evento.motivo = ATAQUE_SEM_FRONTEIRA;
+        emitirEvento(&evento);
     }
+    return 0;
 }
 
-void cadastrarTerritorios(Territorio *mapa, int numTerritorios)
+int lerIdOuNome(long long *id)
 {
-    printf("\n==== Cadastro dos Territórios ====\n");
-
-    for (int i = 0; i < numTerritorios; i++)
-    {
-        printf("\nTerritório %d\n", i + 1);
-
-        printf("Nome: ");
-        fgets(mapa[i].nome, sizeof(mapa[i].nome), stdin);
-        limparEnter(mapa[i].nome);
+    char entrada[TAM_ENTRADA];
 
-        printf("Cor do exército: ");
-        fgets(mapa[i].cor, sizeof(mapa[i].cor), stdin);
-        limparEnter(mapa[i].cor);
+    *id = 0;
+    if (fgets(entrada, sizeof(entrada), stdin) == NULL)
+        return 1;
 
-        printf("Número de tropas: ");
-        while (scanf("%d", &mapa[i].tropas) != 1)
-        {
-            printf("\n==== Número inválido de tropas. ====\n");
-            printf("\nNúmero de tropas: ");
-            limparBufferEntrada();
-        };
+    // Entrada maior que o buffer: descarta o restante da linha.
+    if (strchr(entrada, '\n') == NULL)
         limparBufferEntrada();
+    limparEnter(entrada);
+
+    // Um número inteiro (ex.: 3, 0 ou -1) é tratado como ID. Qualquer outro texto é tratado como nome.
+    char *fim;
+    long long numero = strtoll(entrada, &fim, 10);
+    if (fim != entrada && *fim == '\0')
+    {
+        *id = numero;
+        return 1;
     }
+
+    size_t encontrado = buscarTerritorioPorNome(indiceNomes, entrada);
+    if (encontrado == ID_INEXISTENTE)
+        return 0;
+
+    *id = (long long)encontrado + 1;
+    return 1;
 }
 
-void atacar(Territorio *atacante, Territorio *defensor)
+void faseDeAtaque(Territorio *mapa, int *codigoRetorno, size_t numTerritorios)
 {
-    if (strcmp(atacante->cor, defensor->cor) == 0)
-    {
-        printf("\n ⚠️  Aviso: Você não pode atacar um território aliado!.\n");
+    RASTREAR_ESCOPO("faseDeAtaque");
+
+    size_t idAtacante, idDefensor;
+
+    printf("\n==== FASE DE ATAQUE ====\n");
+
+    *codigoRetorno = lerAlvosAtaque(&idAtacante, &idDefensor, numTerritorios);
+    if (*codigoRetorno != 0)
         return;
-    }
 
-    if (atacante->tropas < 2)
+    // Um alvo sem fronteira é tratado como uma escolha inválida: o turno não é consumido.
+    if (!conferirFronteira(mapa, idAtacante, idDefensor, numTerritorios))
     {
-        printf("\n ⚠️  Aviso: O território atacante precisa de pelo menos 2 tropas para atacar.\n");
+        *codigoRetorno = 1;
         return;
     }
 
-    // Simula a rolagem dos dados (1 a 6). Vamos evitar o retorno do valor zero.
-    int dadoAtacante = rand() % 6 + 1, dadoDefensor = rand() % 6 + 1;
-
-    printf("\n==== RESULTADO DO ATAQUE ====\n");
-    printf("\n ⚔️  Ataque de %s (%d tropas) contra 🛡️  defesa de %s (%d tropas)\n", atacante->nome, atacante->tropas, defensor->nome, defensor->tropas);
-    printf("\n 🎲  Rolagem da dados: atacante => %d | defensor => %d\n", dadoAtacante, dadoDefensor);
+    registrarPontoDesfazer(historicoMapa);
 
-    // Pelo comportamento apresentado na vídeo aula da plataforma e de acordo com o arquivo README.md, vamos implementar a lógica.
-    if (dadoAtacante >= dadoDefensor)
-    {
-        printf("\n ⚔️  Ataque bem-sucedido! O defensor perde 1 tropa.\n");
-        defensor->tropas -= 1;
-        // Se as tropas defensoras se esgotarem, a conquista do atacante é decretada.
-        if (defensor->tropas < 1)
-        {
-            printf("\n Essa batalha foi vencida pelo atacante. Mas ainda falta vencer a guerra... \n");
-            // Metade das tropas do atacante se movem para o território conquistado.
-            int tropasTransferidas = atacante->tropas / 2;
+    // Como o vetor é baseado em índice zero, precisamos informar a posição atual de forma adequada.
+    atacar(&mapa[idAtacante - 1], &mapa[idDefensor - 1]);
+}
 
-            strcpy(defensor->cor, atacante->cor);
-            defensor->tropas += tropasTransferidas;
-            atacante->tropas -= tropasTransferidas;
+void faseDeBlitz(Territorio *mapa, int *codigoRetorno, size_t numTerritorios)
+{
+    RASTREAR_ESCOPO("faseDeBlitz");
 
-            printf("\nO território %s agora pertence a %s com %d tropa(s).\n", defensor->nome, atacante->nome, defensor->tropas);
-        }
+    size_t idAtacante, idDefensor;
 
-        strcpy(missaoInfo->corRemanescente, atacante->cor);
-    }
-    else
-    {
-        // Caso contrário, a defesa é favorecida.
-        printf("\n 🛡️  Defesa bem-sucedida! O atacante perde 1 tropa.\n");
-        atacante->tropas -= 1;
+    printf("\n==== ⚡ ATAQUE RELÂMPAGO ====\n");
 
-        strcpy(missaoInfo->corRemanescente, defensor->cor);
-    }
-}
+    *codigoRetorno = lerAlvosAtaque(&idAtacante, &idDefensor, numTerritorios);
+    if (*codigoRetorno != 0)
+        return;
 
-void liberarMemoria(Territorio *mapa, char *missaoJogador, char **missoes, int numMissoes)
-{
-    free(mapa);
-    free(missaoJogador);
-    for (int i = 0; i < numMissoes; i++)
+    // Um alvo sem fronteira é tratado como uma escolha inválida: o turno não é consumido.
+    if (!conferirFronteira(mapa, idAtacante, idDefensor, numTerritorios))
     {
-        free(missoes[i]);
+        *codigoRetorno = 1;
+        return;
     }
-    if (missaoInfo != NULL)
-        free(missaoInfo);
-    printf("\nA memória alocada foi liberada com sucesso.\n");
-}
+
+    int limitePerdas;
+    printf("\n 📉  Limite de tropas que o atacante aceita perder (0 para sem limite): ");
+    if (scanf("%d", &limitePerdas) != 1 || limitePerdas < 0)
+        limitePerdas = 0;
+    limparBufferEntrada();
+
+    int modo;
+    printf("\n 🎲  Modo: 1 - Rolar cada rodada | 2 - Sortear pela distribuição exata: ");
+    if (scanf("%d", &modo) != 1 || modo != BLITZ_DISTRIBUICAO_EXATA)
+        modo = BLITZ_SIMULADO;
+    limparBufferEntrada();
+
+    Territorio *atacante = &mapa[idAtacante - 1];
+    Territorio *defensor = &mapa[idDefensor - 1];
+
+    registrarPontoDesfazer(historicoMapa);
+
+    ResultadoBlitz resultado = atacarBlitz(atacante, defensor, limitePerdas, (ModoBlitz)modo);
+
+    exibirResultadoBlitz(atacante, defensor, &resultado);
+}
+
+void exibirResultadoBlitz(const Territorio *atacante, const Territorio *defensor, const ResultadoBlitz *resultado)
+{
+    if (resultado->codigo == 1)
+    {
+        printf("\n ⚠️  Aviso: Você não pode atacar um território aliado!.\n");
+        return;
+    }
+    if (resultado->codigo == 2)
+    {
+        printf("\n ⚠️  Aviso: O território atacante precisa de pelo menos 2 tropas para atacar.\n");
+        return;
+    }
+
+    printf("\n==== RESUMO DO ATAQUE RELÂMPAGO ====\n");
+    printf("\n 🎲  Rodadas disputadas: %d\n", resultado->rodadas);
+    printf("\n ⚔️  %s perdeu %d tropa(s) | 🛡️  %s perdeu %d tropa(s)\n",
+           atacante->nome, resultado->perdasAtacante, defensor->nome, resultado->perdasDefensor);
+
+    if (resultado->conquistado)
+        printf("\n 🏆  O território %s foi conquistado e agora pertence a %s com %d tropa(s).\n", defensor->nome, defensor->cor, defensor->tropas);
+    else if (resultado->atingiuLimite)
+        printf("\n ✋  O limite de perdas foi atingido. O ataque foi interrompido.\n");
+    else
+        printf("\n 🛡️  O atacante ficou sem tropas suficientes. A defesa resistiu.\n");
+
+    printf("\n Estado final: %s (%s) com %d tropa(s) | %s (%s) com %d tropa(s)\n",
+           atacante->nome, atacante->cor, atacante->tropas, defensor->nome, defensor->cor, defensor->tropas);
+}
+
+void exibirMapa(const Territorio *mapa, size_t tamanho)
+{
+    RASTREAR_ESCOPO("exibirMapa");
+
+    printf("\n==== 🌍  MAPA DO MUNDO - ESTADO ATUAL ====\n\n");
+
+    // Em mapas grandes, despejar todas as linhas a cada jogada é inviável. Exibe só a primeira página.
+    exibirMapaIntervalo(mapa, tamanho, 0, tamanho < LINHAS_POR_PAGINA ? tamanho : LINHAS_POR_PAGINA);
+
+    if (tamanho > LINHAS_POR_PAGINA)
+        printf("... e mais %zu território(s). Use a opção de exibir trecho do mapa.\n", tamanho - LINHAS_POR_PAGINA);
+}
+
+void exibirMapaIntervalo(const Territorio *mapa, size_t tamanho, size_t inicio, size_t quantidade)
+{
+    // As linhas são formatadas em um buffer local e escritas em blocos, com uma chamada de escrita por bloco.
+    char buffer[TAM_BUFFER_EXIBICAO];
+    size_t usado = 0;
+
+    if (inicio >= tamanho)
+        return;
+    if (quantidade > tamanho - inicio)
+        quantidade = tamanho - inicio;
+
+    // No modo com threads, só as linhas do mapa podem ser descartadas com a fila de exibição cheia.
+    // O texto anterior ainda no buffer sai antes, sob a regra normal.
+    fflush(stdout);
+    saidaDescartavel = 1;
+
+    // Evitar mostrar o número do exército baseado no índice zero.
+    for (size_t i = inicio; i < inicio + quantidade; i++)
+    {
+        if (sizeof(buffer) - usado < TAM_NOME + TAM_COR + 80)
+        {
+            fwrite(buffer, 1, usado, stdout);
+            usado = 0;
+        }
+        usado += (size_t)snprintf(buffer + usado, sizeof(buffer) - usado, "[%zu] %s | Exército Cor: %s | Tropas: %d\n",
+                                  i + 1, mapa[i].nome, mapa[i].cor, mapa[i].tropas);
+    }
+    fwrite(buffer, 1, usado, stdout);
+    fflush(stdout);
+    saidaDescartavel = 0;
+}
+
+void faseDeExibirTrecho(const Territorio *mapa, size_t tamanho)
+{
+    long long inicio = 0, quantidade = 0;
+
+    printf("\n 📜  ID inicial do trecho (1 a %zu): ", tamanho);
+    scanf("%lld", &inicio);
+    limparBufferEntrada();
+
+    printf("\n 📜  Quantidade de territórios a exibir: ");
+    scanf("%lld", &quantidade);
+    limparBufferEntrada();
+
+    if (inicio < 1 || (unsigned long long)inicio > tamanho || quantidade < 1)
+    {
+        printf("\n ⚠️  Trecho inválido.\n");
+        return;
+    }
+
+    printf("\n==== 🌍  MAPA DO MUNDO - TRECHO ====\n\n");
+    exibirMapaIntervalo(mapa, tamanho, (size_t)inicio - 1, (size_t)quantidade);
+}
+
+void cadastrarTerritorios(Territorio *mapa, size_t numTerritorios)
+{
+    printf("\n==== Cadastro dos Territórios ====\n");
+
+    for (size_t i = 0; i < numTerritorios; i++)
+    {
+        printf("\nTerritório %zu\n", i + 1);
+
+        printf("Nome: ");
+        fgets(mapa[i].nome, sizeof(mapa[i].nome), stdin);
+        limparEnter(mapa[i].nome);
+
+        if (indiceNomes != NULL && !inserirNomeIndice(indiceNomes, i))
+            printf(" ⚠️  Já existe um território chamado %s. Use o ID %zu para se referir a este.\n", mapa[i].nome, i + 1);
+
+        printf("Cor do exército: ");
+        fgets(mapa[i].cor, sizeof(mapa[i].cor), stdin);
+        limparEnter(mapa[i].cor);
+
+        printf("Número de tropas: ");
+        while (scanf("%d", &mapa[i].tropas) != 1)
+        {
+            printf("\n==== Número inválido de tropas. ====\n");
+            printf("\nNúmero de tropas: ");
+            limparBufferEntrada();
+        };
+        limparBufferEntrada();
+    }
+}
+
+void atacar(Territorio *atacante, Territorio *defensor)
+{
+    RASTREAR_ESCOPO("atacar");
+
+    EventoJogo evento;
+
+    if (strcmp(atacante->cor, defensor->cor) == 0 || atacante->tropas < 2)
+    {
+        if (haOuvintes())
+        {
+            prepararEvento(&evento, EVENTO_ATAQUE_INVALIDO, atacante, defensor);
+            evento.motivo = strcmp(atacante->cor, defensor->cor) == 0 ? ATAQUE_ALIADO : ATAQUE_TROPAS_INSUFICIENTES;
+            emitirEvento(&evento);
+        }
+        return;
+    }
+
+    int tropasAtacante = atacante->tropas, tropasDefensor = defensor->tropas;
+    char corDefensorAntes[TAM_COR];
+    memcpy(corDefensorAntes, defensor->cor, TAM_COR);
+
+    int dadoAtacante, dadoDefensor;
+    int resultado = resolverRodada(atacante, defensor, &dadoAtacante, &dadoDefensor);
+    registrarBatalha(atacante, defensor, corDefensorAntes, resultado == 0, resultado >= 1, resultado == 2);
+
+    AmostraBatalha amostra = {.modo = ORDEM_RODADA_UNICA, .tropasAtacante = tropasAtacante, .tropasDefensor = tropasDefensor,
+                              .perdasAtacante = resultado == 0, .perdasDefensor = resultado >= 1,
+                              .dadoAtacante = (uint8_t)dadoAtacante, .dadoDefensor = (uint8_t)dadoDefensor, .conquista = resultado == 2};
+    registrarEstatisticaBatalha(atacante->cor, corDefensorAntes, &amostra);
+
+    // Sem ouvintes, nenhum evento é montado: chamadas sem interface não pagam pela formatação.
+    if (!haOuvintes())
+        return;
+
+    prepararEvento(&evento, EVENTO_DADOS_ROLADOS, atacante, defensor);
+    evento.tropasAtacante = tropasAtacante;
+    evento.tropasDefensor = tropasDefensor;
+    evento.dadoAtacante = dadoAtacante;
+    evento.dadoDefensor = dadoDefensor;
+    emitirEvento(&evento);
+
+    prepararEvento(&evento, EVENTO_TROPA_PERDIDA, atacante, defensor);
+    evento.motivo = resultado >= 1 ? LADO_DEFENSOR : LADO_ATACANTE;
+    if (resultado == 2)
+        evento.tropasDefensor = 0; // A tropa perdida zerou o defensor antes da transferência da conquista.
+    emitirEvento(&evento);
+
+    // Se as tropas defensoras se esgotaram, a conquista do atacante foi decretada.
+    if (resultado == 2)
+    {
+        prepararEvento(&evento, EVENTO_TERRITORIO_CONQUISTADO, atacante, defensor);
+        emitirEvento(&evento);
+    }
+}
+
+int resolverRodada(Territorio *atacante, Territorio *defensor, int *dadoAtacante, int *dadoDefensor)
+{
+    marcarTerritorioAlterado(atacante);
+    marcarTerritorioAlterado(defensor);
+
+    // Simula a rolagem dos dados (1 a 6). Vamos evitar o retorno do valor zero.
+    *dadoAtacante = rand() % 6 + 1;
+    *dadoDefensor = rand() % 6 + 1;
+
+    // Pelo comportamento apresentado na vídeo aula da plataforma e de acordo com o arquivo README.md, vamos implementar a lógica.
+    if (*dadoAtacante >= *dadoDefensor)
+    {
+        defensor->tropas -= 1;
+
+        // Se as tropas defensoras se esgotarem, a conquista do atacante é decretada.
+        if (defensor->tropas < 1)
+        {
+            aplicarConquista(atacante, defensor);
+            return 2;
+        }
+        atualizarIndicesTerritorio(defensor);
+        return 1;
+    }
+
+    atacante->tropas -= 1;
+    atualizarIndicesTerritorio(atacante);
+    return 0;
+}
+
+void aplicarConquista(Territorio *atacante, Territorio *defensor)
+{
+    // Metade das tropas do atacante se movem para o território conquistado.
+    int tropasTransferidas = atacante->tropas / 2;
+
+    strcpy(defensor->cor, atacante->cor);
+    defensor->tropas = tropasTransferidas;
+    atacante->tropas -= tropasTransferidas;
+
+    // A cor do defensor mudou: o território passa para a lista de territórios do atacante.
+    atualizarIndicesTerritorio(defensor);
+    atualizarIndicesTerritorio(atacante);
+}
+
+ResultadoBlitz atacarBlitz(Territorio *atacante, Territorio *defensor, int limitePerdas, ModoBlitz modo)
+{
+    ResultadoBlitz resultado = {0};
+
+    if (strcmp(atacante->cor, defensor->cor) == 0)
+    {
+        resultado.codigo = 1;
+        return resultado;
+    }
+
+    if (atacante->tropas < 2)
+    {
+        resultado.codigo = 2;
+        return resultado;
+    }
+
+    // O atacante pode perder tropas até restar apenas 1, ou até o limite informado pelo jogador.
+    int tropasAtacante = atacante->tropas;
+    int perdasPermitidas = atacante->tropas - 1;
+    if (limitePerdas > 0 && limitePerdas < perdasPermitidas)
+        perdasPermitidas = limitePerdas;
+
+    // Um defensor cadastrado com zero tropas ainda precisa perder uma rodada para ser conquistado.
+    int tropasDefensor = defensor->tropas > 0 ? defensor->tropas : 1;
+
+    if (modo == BLITZ_DISTRIBUICAO_EXATA)
+    {
+        // Cada rodada é independente: o atacante vence com probabilidade p = 21/36, pois empates o favorecem.
+        // Com d tropas defensoras e K perdas permitidas, a batalha termina de uma das formas:
+        //   conquista com k perdas do atacante (k < K):  C(d - 1 + k, k) * p^d * q^k
+        //   interrupção com j perdas do defensor (j < d): C(K - 1 + j, j) * q^K * p^j
+        const double p = 21.0 / 36.0, q = 15.0 / 36.0;
+
+        double pElevadoD = 1.0, qElevadoK = 1.0;
+        for (int i = 0; i < tropasDefensor; i++)
+            pElevadoD *= p;
+        for (int i = 0; i < perdasPermitidas; i++)
+            qElevadoK *= q;
+
+        // Em batalhas gigantescas as potências deixam de ser representáveis em double. Nesse caso seguimos
+        // para a simulação rodada a rodada abaixo, que também é uma amostra exata da mesma distribuição.
+        if (pElevadoD > 1e-300 && qElevadoK > 1e-300)
+        {
+            double sorteio = rand() / ((double)RAND_MAX + 1.0);
+            double acumulado = 0.0;
+            double termo = pElevadoD;
+
+            int perdasAtacante = perdasPermitidas, perdasDefensor = -1;
+
+            for (int k = 0; k < perdasPermitidas; k++)
+            {
+                acumulado += termo;
+                if (sorteio < acumulado)
+                {
+                    perdasAtacante = k;
+                    perdasDefensor = tropasDefensor;
+                    break;
+                }
+                termo *= (double)(tropasDefensor + k) / (k + 1) * q;
+            }
+
+            if (perdasDefensor < 0)
+            {
+                // Se o arredondamento deixar sobra no sorteio, fica valendo o último desfecho possível.
+                perdasDefensor = tropasDefensor - 1;
+                termo = qElevadoK;
+                for (int j = 0; j < tropasDefensor; j++)
+                {
+                    acumulado += termo;
+                    if (sorteio < acumulado)
+                    {
+                        perdasDefensor = j;
+                        break;
+                    }
+                    termo *= (double)(perdasPermitidas + j) / (j + 1) * p;
+                }
+            }
+
+            AmostraBatalha amostra = {.modo = ORDEM_BLITZ_DISTRIBUICAO_EXATA, .tropasAtacante = tropasAtacante, .tropasDefensor = tropasDefensor,
+                                      .perdasAtacante = perdasAtacante, .perdasDefensor = perdasDefensor,
+                                      .conquista = perdasDefensor == tropasDefensor};
+            registrarEstatisticaBatalha(atacante->cor, defensor->cor, &amostra);
+
+            // Na amostra exata, a batalha termina na rodada que decide a conquista ou esgota as perdas permitidas.
+            aplicarDesfechoBatalha(atacante, defensor, ORDEM_BLITZ_DISTRIBUICAO_EXATA, perdasAtacante, perdasDefensor, tropasDefensor,
+                                   limitePerdas, perdasDefensor == tropasDefensor, &resultado);
+            return resultado;
+        }
+    }
+
+    int dadoAtacante, dadoDefensor;
+    char corDefensorAntes[TAM_COR];
+    memcpy(corDefensorAntes, defensor->cor, TAM_COR);
+
+    while (resultado.perdasAtacante < perdasPermitidas)
+    {
+        int rodada = resolverRodada(atacante, defensor, &dadoAtacante, &dadoDefensor);
+        resultado.rodadas++;
+
+        if (rodada == 0)
+        {
+            resultado.perdasAtacante++;
+            continue;
+        }
+
+        resultado.perdasDefensor++;
+        if (rodada == 2)
+        {
+            resultado.conquistado = 1;
+            break;
+        }
+    }
+
+    // Um limite igual ou maior que o piso natural (tropas - 1) não interrompeu nada: o atacante só ficou sem tropas.
+    if (!resultado.conquistado)
+        resultado.atingiuLimite = limitePerdas > 0 && limitePerdas < tropasAtacante - 1 && resultado.perdasAtacante == limitePerdas;
+
+    registrarBatalha(atacante, defensor, corDefensorAntes, resultado.perdasAtacante, resultado.perdasDefensor, resultado.conquistado);
+
+    AmostraBatalha amostra = {.modo = (uint8_t)modo, .tropasAtacante = tropasAtacante, .tropasDefensor = tropasDefensor,
+                              .perdasAtacante = resultado.perdasAtacante, .perdasDefensor = resultado.perdasDefensor,
+                              .dadoAtacante = (uint8_t)dadoAtacante, .dadoDefensor = (uint8_t)dadoDefensor, .conquista = (uint8_t)resultado.conquistado};
+    registrarEstatisticaBatalha(atacante->cor, corDefensorAntes, &amostra);
+
+    return resultado;
+}
+
+void aplicarDesfechoBatalha(Territorio *atacante, Territorio *defensor, ModoOrdem modo, int perdasAtacante, int perdasDefensor,
+                            int tropasDefensor, int limitePerdas, int atacanteVenceuUltima, ResultadoBlitz *resultado)
+{
+    marcarTerritorioAlterado(atacante);
+    marcarTerritorioAlterado(defensor);
+
+    // O limite só é mais estrito que o piso natural se deixa o atacante com mais de 1 tropa.
+    int limiteEstrito = limitePerdas > 0 && limitePerdas < atacante->tropas - 1;
+
+    resultado->rodadas = perdasAtacante + perdasDefensor;
+    resultado->perdasAtacante = perdasAtacante;
+    resultado->perdasDefensor = perdasDefensor;
+
+    atacante->tropas -= perdasAtacante;
+    defensor->tropas -= perdasDefensor;
+
+    char corDefensorAntes[TAM_COR];
+    memcpy(corDefensorAntes, defensor->cor, TAM_COR);
+
+    if (perdasDefensor == tropasDefensor)
+    {
+        aplicarConquista(atacante, defensor);
+        resultado->conquistado = 1;
+    }
+    else
+    {
+        // Sem conquista, a rodada única termina com qualquer vencedor. Nos modos de blitz, o limite só foi atingido
+        // se a defesa venceu a rodada que completou as perdas informadas pelo jogador, antes do piso natural.
+        resultado->atingiuLimite = modo != ORDEM_RODADA_UNICA && !atacanteVenceuUltima && limiteEstrito && perdasAtacante == limitePerdas;
+        atualizarIndicesTerritorio(atacante);
+        atualizarIndicesTerritorio(defensor);
+    }
+
+    registrarBatalha(atacante, defensor, corDefensorAntes, perdasAtacante, perdasDefensor, resultado->conquistado);
+}
+
+void iniciarBancoDados(BancoDados *banco)
+{
+    banco->estado = 0;
+    for (int i = 0; i < 5; i++)
+        banco->estado = (banco->estado << 15) ^ (uint64_t)(rand() & 0x7FFF);
+
+    // O xorshift não pode partir do estado zero.
+    if (banco->estado == 0)
+        banco->estado = 0x9E3779B97F4A7C15ULL;
+
+    banco->palavra = 0;
+    banco->restantes = 0;
+}
+
+int retirarDado(BancoDados *banco)
+{
+    // 6^24 cabe em 64 bits. Aceitando apenas palavras abaixo de 3 * 6^24 (múltiplo exato de 6^24),
+    // os 24 dígitos em base 6 são uniformes e independentes.
+    const uint64_t limiteAceito = 3ULL * 4738381338321616896ULL;
+
+    if (banco->restantes == 0)
+    {
+        uint64_t palavra;
+        do
+        {
+            banco->estado ^= banco->estado >> 12;
+            banco->estado ^= banco->estado << 25;
+            banco->estado ^= banco->estado >> 27;
+            palavra = banco->estado * 0x2545F4914F6CDD1DULL;
+        } while (palavra >= limiteAceito);
+
+        banco->palavra = palavra;
+        banco->restantes = 24;
+    }
+
+    int dado = (int)(banco->palavra % 6) + 1;
+    banco->palavra /= 6;
+    banco->restantes--;
+    return dado;
+}
+
+size_t resolverOrdensEmLote(Territorio *mapa, size_t tamanho, const OrdemAtaque *ordens, size_t numOrdens, ResultadoOrdem *resultados,
+                            int pontoDesfazer)
+{
+    RASTREAR_ESCOPO("resolverOrdensEmLote");
+
+    size_t executadas = 0;
+    int algumaValida = 0;
+
+    // Primeira passada: validações que não dependem do estado do mapa.
+    for (size_t i = 0; i < numOrdens; i++)
+    {
+        const OrdemAtaque *ordem = &ordens[i];
+        int valida = ordem->atacante < tamanho && ordem->defensor < tamanho && ordem->atacante != ordem->defensor &&
+                     (ordem->modo == ORDEM_RODADA_UNICA || ordem->modo == ORDEM_BLITZ_SIMULADO || ordem->modo == ORDEM_BLITZ_DISTRIBUICAO_EXATA);
+
+        // Fronteiras não mudam com as conquistas: também são conferidas aqui.
+        memset(&resultados[i], 0, sizeof(ResultadoOrdem));
+        resultados[i].codigo = !valida ? 3 : !fazFronteira(ordem->atacante, ordem->defensor, tamanho) ? ATAQUE_SEM_FRONTEIRA : 0;
+        algumaValida |= resultados[i].codigo == 0;
+    }
+
+    if (!algumaValida)
+        return 0;
+
+    // O lote é uma única jogada para desfazer e refazer.
+    if (pontoDesfazer)
+        registrarPontoDesfazer(historicoMapa);
+
+    BancoDados banco;
+    iniciarBancoDados(&banco);
+
+    for (size_t i = 0; i < numOrdens; i++)
+    {
+        if (resultados[i].codigo != 0)
+            continue;
+
+        const OrdemAtaque *ordem = &ordens[i];
+        ResultadoOrdem *saida = &resultados[i];
+        Territorio *atacante = &mapa[ordem->atacante];
+        Territorio *defensor = &mapa[ordem->defensor];
+
+        if (strcmp(atacante->cor, defensor->cor) == 0)
+        {
+            saida->codigo = 1;
+            continue;
+        }
+        if (atacante->tropas < 2)
+        {
+            saida->codigo = 2;
+            continue;
+        }
+
+        if (ordem->modo == ORDEM_BLITZ_DISTRIBUICAO_EXATA)
+        {
+            // Uma única amostra por batalha: o custo já não depende do número de rodadas.
+            ResultadoBlitz blitz = atacarBlitz(atacante, defensor, ordem->limitePerdas, BLITZ_DISTRIBUICAO_EXATA);
+            saida->conquistado = (uint8_t)blitz.conquistado;
+            saida->atingiuLimite = (uint8_t)blitz.atingiuLimite;
+            saida->perdasAtacante = blitz.perdasAtacante;
+            saida->perdasDefensor = blitz.perdasDefensor;
+            executadas++;
+            continue;
+        }
+
+        int perdasPermitidas = 1;
+        int tropasDefensor = defensor->tropas > 0 ? defensor->tropas : 1;
+        int limitePerdas = 0;
+
+        if (ordem->modo == ORDEM_BLITZ_SIMULADO)
+        {
+            perdasPermitidas = atacante->tropas - 1;
+            if (ordem->limitePerdas > 0 && ordem->limitePerdas < perdasPermitidas)
+                perdasPermitidas = ordem->limitePerdas;
+            limitePerdas = ordem->limitePerdas;
+        }
+
+        // As rodadas são contadas em variáveis locais; o mapa, os índices e o histórico são tocados uma vez por ordem.
+        int perdasAtacante = 0, perdasDefensor = 0, dadoAtacante = 0, dadoDefensor = 0;
+        while (perdasAtacante < perdasPermitidas && perdasDefensor < tropasDefensor)
+        {
+            dadoAtacante = retirarDado(&banco);
+            dadoDefensor = retirarDado(&banco);
+
+            if (dadoAtacante >= dadoDefensor)
+                perdasDefensor++;
+            else
+                perdasAtacante++;
+
+            // Uma rodada única termina na primeira rolagem, qualquer que seja o vencedor.
+            if (ordem->modo == ORDEM_RODADA_UNICA)
+                break;
+        }
+
+        AmostraBatalha amostra = {.modo = (uint8_t)ordem->modo, .tropasAtacante = atacante->tropas, .tropasDefensor = tropasDefensor,
+                                  .perdasAtacante = perdasAtacante, .perdasDefensor = perdasDefensor,
+                                  .dadoAtacante = (uint8_t)dadoAtacante, .dadoDefensor = (uint8_t)dadoDefensor,
+                                  .conquista = perdasDefensor == tropasDefensor};
+        registrarEstatisticaBatalha(atacante->cor, defensor->cor, &amostra);
+
+        ResultadoBlitz blitz = {0};
+        aplicarDesfechoBatalha(atacante, defensor, ordem->modo, perdasAtacante, perdasDefensor, tropasDefensor, limitePerdas,
+                               dadoAtacante >= dadoDefensor, &blitz);
+
+        saida->conquistado = (uint8_t)blitz.conquistado;
+        saida->atingiuLimite = (uint8_t)blitz.atingiuLimite;
+        saida->perdasAtacante = perdasAtacante;
+        saida->perdasDefensor = perdasDefensor;
+        executadas++;
+    }
+
+    return executadas;
+}
+
+void faseDeOrdensEmLote(Territorio *mapa, size_t tamanho)
+{
+    long long numOrdens;
+
+    printf("\n==== 📦 ORDENS EM LOTE ====\n");
+    printf("\n Quantidade de ordens: ");
+    if (scanf("%lld", &numOrdens) != 1 || numOrdens < 1)
+    {
+        limparBufferEntrada();
+        printf("\n ⚠️  Quantidade inválida.\n");
+        return;
+    }
+    limparBufferEntrada();
+
+    OrdemAtaque *ordens = (OrdemAtaque *)ALOCAR_ZERADO(MEMORIA_TEMPORARIA, (size_t)numOrdens, sizeof(OrdemAtaque));
+    ResultadoOrdem *resultados = (ResultadoOrdem *)ALOCAR_ZERADO(MEMORIA_TEMPORARIA, (size_t)numOrdens, sizeof(ResultadoOrdem));
+
+    if (ordens == NULL || resultados == NULL)
+    {
+        printf("\n ❌  Erro ao alocar memória para as ordens.\n");
+        LIBERAR(ordens);
+        LIBERAR(resultados);
+        return;
+    }
+
+    printf("\n Uma ordem por linha: atacante defensor modo(0 - rodada | 1 - blitz | 2 - blitz exata) limite\n");
+    for (long long i = 0; i < numOrdens; i++)
+    {
+        long long idAtacante = 0, idDefensor = 0;
+        int modo = -1, limite = 0;
+
+        if (scanf("%lld %lld %d %d", &idAtacante, &idDefensor, &modo, &limite) != 4)
+            modo = -1; // Linha malformada: a ordem será rejeitada na validação do lote.
+        limparBufferEntrada();
+
+        // IDs fora do mapa viram SIZE_MAX e são rejeitados pela validação do lote.
+        ordens[i].atacante = idAtacante >= 1 ? (size_t)(idAtacante - 1) : ID_INEXISTENTE;
+        ordens[i].defensor = idDefensor >= 1 ? (size_t)(idDefensor - 1) : ID_INEXISTENTE;
+        ordens[i].modo = (ModoOrdem)modo;
+        ordens[i].limitePerdas = limite > 0 ? limite : 0;
+    }
+
+    size_t executadas = resolverOrdensEmLote(mapa, tamanho, ordens, (size_t)numOrdens, resultados, 1);
+
+    const char *descricoes[] = {"executada", "alvo aliado", "tropas insuficientes", "ordem inválida", "alvo sem fronteira"};
+    for (long long i = 0; i < numOrdens; i++)
+    {
+        const ResultadoOrdem *r = &resultados[i];
+        printf("\n [%lld] %s", i + 1, descricoes[r->codigo]);
+        if (r->codigo == 0)
+            printf(" | perdas: atacante %d, defensor %d%s", r->perdasAtacante, r->perdasDefensor, r->conquistado ? " | 🏳️  conquistado" : "");
+    }
+    printf("\n\n %zu de %lld ordem(ns) executada(s).\n", executadas, numOrdens);
+
+    LIBERAR(ordens);
+    LIBERAR(resultados);
+}
+
+void liberarMemoria(Territorio *mapa, char **missoes, size_t numMissoes)
+{
+    // O mapa fixo vive na pilha de main(); só o mapa do heap é liberado.
+    if (mapaFixo.capacidade == 0)
+        LIBERAR(mapa);
+    liberarMissoesJogadores();
+    for (size_t i = 0; i < numMissoes; i++)
+    {
+        LIBERAR(missoes[i]);
+    }
+    LIBERAR(missoes);
+    if (missaoInfo != NULL)
+        LIBERAR(missaoInfo);
+    liberarHistoricoMapa(historicoMapa);
+    historicoMapa = NULL;
+    liberarIndiceNomes(indiceNomes);
+    indiceNomes = NULL;
+    liberarIndiceCores(indiceCores);
+    indiceCores = NULL;
+    liberarIndiceTropas(indiceTropas);
+    indiceTropas = NULL;
+    liberarRegioes(regioes);
+    regioes = NULL;
+    LIBERAR(cursorReforco);
+    cursorReforco = NULL;
+    liberarHistoricoBatalhas(historicoBatalhas);
+    historicoBatalhas = NULL;
+    liberarVizinhanca(vizinhanca);
+    vizinhanca = NULL;
+    liberarBuscaCaminhos(buscaCaminhos);
+    buscaCaminhos = NULL;
+    gravarEstatisticas(armazemEstatisticas);
+    liberarArmazemEstatisticas(armazemEstatisticas);
+    armazemEstatisticas = NULL;
+
+    encerrarEspectadores();
+
+    // O rastro é gravado antes da conferência de vazamentos, pois seus buffers também são memória do jogo.
+    finalizarRastro();
+
+#if RASTREAR_MEMORIA
+    // Tudo o que o jogo alocou deveria ter voltado: qualquer sobra é vazamento.
+    if (bytesEmUso() != 0)
+    {
+        printf("\n ⚠️  Vazamento de memória detectado: %zu bytes ainda alocados.\n", bytesEmUso());
+        exibirRelatorioMemoria();
+        return;
+    }
+#endif
+    printf("\nA memória alocada foi liberada com sucesso.\n");
+}
+
+// **** Snapshots copy-on-write: ****
+
+HistoricoMapa *criarHistoricoMapa(Territorio *mapa, size_t tamanho)
+{
+    HistoricoMapa *historico = (HistoricoMapa *)ALOCAR_ZERADO(MEMORIA_HISTORICO, 1, sizeof(HistoricoMapa));
+    if (historico == NULL)
+        return NULL;
+
+    historico->mapa = mapa;
+    historico->tamanho = tamanho;
+    historico->numBlocos = (tamanho + TERRITORIOS_POR_BLOCO - 1) / TERRITORIOS_POR_BLOCO;
+    historico->blocoSujo = (unsigned char *)ALOCAR_ZERADO(MEMORIA_HISTORICO, historico->numBlocos, sizeof(unsigned char));
+    historico->blocosSujos = (size_t *)ALOCAR(MEMORIA_HISTORICO, historico->numBlocos * sizeof(size_t));
+
+    // A versão base começa vazia (sem páginas) e todos os blocos são marcados como sujos.
+    // Assim, a primeira captura é a única que copia o mapa inteiro.
+    historico->base = (SnapshotMapa *)ALOCAR_ZERADO(MEMORIA_HISTORICO, 1, sizeof(SnapshotMapa));
+    if (historico->blocoSujo == NULL || historico->blocosSujos == NULL || historico->base == NULL)
+    {
+        liberarHistoricoMapa(historico);
+        return NULL;
+    }
+
+    historico->base->referencias = 1;
+    historico->base->numPaginas = (historico->numBlocos + BLOCOS_POR_PAGINA - 1) / BLOCOS_POR_PAGINA;
+    historico->base->paginas = (PaginaMapa **)ALOCAR_ZERADO(MEMORIA_HISTORICO, historico->base->numPaginas, sizeof(PaginaMapa *));
+    if (historico->base->paginas == NULL)
+    {
+        liberarHistoricoMapa(historico);
+        return NULL;
+    }
+
+    for (size_t b = 0; b < historico->numBlocos; b++)
+    {
+        historico->blocoSujo[b] = 1;
+        historico->blocosSujos[b] = b;
+    }
+    historico->numSujos = historico->numBlocos;
+
+    historico->inicial = capturarSnapshot(historico);
+    if (historico->inicial == NULL)
+    {
+        liberarHistoricoMapa(historico);
+        return NULL;
+    }
+
+    return historico;
+}
+
+void liberarHistoricoMapa(HistoricoMapa *historico)
+{
+    if (historico == NULL)
+        return;
+
+    for (int i = 0; i < historico->numDesfazer; i++)
+        liberarSnapshot(historico->desfazer[(historico->inicioDesfazer + i) % LIMITE_DESFAZER]);
+    for (int i = 0; i < historico->numRefazer; i++)
+        liberarSnapshot(historico->refazer[i]);
+
+    liberarSnapshot(historico->inicial);
+    liberarSnapshot(historico->base);
+    LIBERAR(historico->blocoSujo);
+    LIBERAR(historico->blocosSujos);
+    LIBERAR(historico);
+}
+
+void marcarTerritorioAlterado(const Territorio *territorio)
+{
+    if (historicoMapa == NULL || territorio < historicoMapa->mapa)
+        return;
+
+    size_t id = (size_t)(territorio - historicoMapa->mapa);
+    if (id >= historicoMapa->tamanho)
+        return;
+
+    size_t bloco = id / TERRITORIOS_POR_BLOCO;
+    if (!historicoMapa->blocoSujo[bloco])
+    {
+        historicoMapa->blocoSujo[bloco] = 1;
+        historicoMapa->blocosSujos[historicoMapa->numSujos++] = bloco;
+    }
+}
+
+SnapshotMapa *capturarSnapshot(HistoricoMapa *historico)
+{
+    SnapshotMapa *base = historico->base;
+
+    // Nada mudou desde a última captura: a mesma versão é compartilhada.
+    // Um turno novo ou batalhas novas sem territórios alterados ainda exigem outra versão.
+    uint64_t sequenciaBatalhas = historicoBatalhas != NULL ? historicoBatalhas->sequenciaVisivel : 0;
+    if (historico->numSujos == 0 && base->turno == turnoAtual && base->sequenciaBatalhas == sequenciaBatalhas)
+    {
+        base->referencias++;
+        return base;
+    }
+
+    SnapshotMapa *novo = (SnapshotMapa *)ALOCAR(MEMORIA_HISTORICO, sizeof(SnapshotMapa));
+    if (novo == NULL)
+        return NULL;
+
+    novo->referencias = 1;
+    novo->numPaginas = base->numPaginas;
+    novo->paginas = (PaginaMapa **)ALOCAR(MEMORIA_HISTORICO, novo->numPaginas * sizeof(PaginaMapa *));
+    if (novo->paginas == NULL)
+    {
+        LIBERAR(novo);
+        return NULL;
+    }
+
+    if (missaoInfo != NULL)
+        novo->info = *missaoInfo;
+    else
+        memset(&novo->info, 0, sizeof(MissaoInfo));
+    novo->turno = turnoAtual;
+    novo->sequenciaBatalhas = sequenciaBatalhas;
+
+    // Copia apenas a tabela de páginas: todas as páginas passam a ser compartilhadas com a versão base.
+    for (size_t p = 0; p < novo->numPaginas; p++)
+    {
+        novo->paginas[p] = base->paginas[p];
+        if (novo->paginas[p] != NULL)
+            novo->paginas[p]->referencias++;
+    }
+
+    for (size_t i = 0; i < historico->numSujos; i++)
+    {
+        size_t b = historico->blocosSujos[i];
+        size_t p = b / BLOCOS_POR_PAGINA, posicao = b % BLOCOS_POR_PAGINA;
+
+        PaginaMapa *pagina = novo->paginas[p];
+
+        // Página compartilhada: duplica apenas a tabela de ponteiros, os blocos continuam compartilhados.
+        if (pagina == NULL || pagina->referencias > 1)
+        {
+            PaginaMapa *copia = (PaginaMapa *)ALOCAR(MEMORIA_HISTORICO, sizeof(PaginaMapa));
+            if (copia == NULL)
+            {
+                liberarSnapshot(novo);
+                return NULL;
+            }
+
+            copia->referencias = 1;
+            if (pagina != NULL)
+            {
+                memcpy(copia->blocos, pagina->blocos, sizeof(copia->blocos));
+                for (int j = 0; j < BLOCOS_POR_PAGINA; j++)
+                    if (copia->blocos[j] != NULL)
+                        copia->blocos[j]->referencias++;
+                pagina->referencias--;
+            }
+            else
+            {
+                memset(copia->blocos, 0, sizeof(copia->blocos));
+            }
+
+            novo->paginas[p] = copia;
+            pagina = copia;
+        }
+
+        BlocoMapa *bloco = (BlocoMapa *)ALOCAR_ZERADO(MEMORIA_HISTORICO, 1, sizeof(BlocoMapa));
+        if (bloco == NULL)
+        {
+            liberarSnapshot(novo);
+            return NULL;
+        }
+
+        size_t inicio = b * TERRITORIOS_POR_BLOCO;
+        size_t quantidade = historico->tamanho - inicio < TERRITORIOS_POR_BLOCO ? historico->tamanho - inicio : TERRITORIOS_POR_BLOCO;
+
+        bloco->referencias = 1;
+        memcpy(bloco->itens, &historico->mapa[inicio], quantidade * sizeof(Territorio));
+
+        BlocoMapa *anterior = pagina->blocos[posicao];
+        if (anterior != NULL && --anterior->referencias == 0)
+            LIBERAR(anterior);
+        pagina->blocos[posicao] = bloco;
+    }
+
+    for (size_t i = 0; i < historico->numSujos; i++)
+        historico->blocoSujo[historico->blocosSujos[i]] = 0;
+    historico->numSujos = 0;
+
+    // O histórico passa a referenciar a nova versão como base. A outra referência pertence a quem chamou.
+    liberarSnapshot(base);
+    novo->referencias++;
+    historico->base = novo;
+
+    return novo;
+}
+
+void restaurarSnapshot(HistoricoMapa *historico, SnapshotMapa *snapshot)
+{
+    SnapshotMapa *base = historico->base;
+
+    // Blocos sujos: o mapa vivo diverge da base, então são sempre restaurados.
+    for (size_t i = 0; i < historico->numSujos; i++)
+    {
+        size_t b = historico->blocosSujos[i];
+        const BlocoMapa *bloco = snapshot->paginas[b / BLOCOS_POR_PAGINA]->blocos[b % BLOCOS_POR_PAGINA];
+        size_t inicio = b * TERRITORIOS_POR_BLOCO;
+        size_t quantidade = historico->tamanho - inicio < TERRITORIOS_POR_BLOCO ? historico->tamanho - inicio : TERRITORIOS_POR_BLOCO;
+
+        memcpy(&historico->mapa[inicio], bloco->itens, quantidade * sizeof(Territorio));
+        for (size_t k = 0; k < quantidade; k++)
+            atualizarIndicesTerritorio(&historico->mapa[inicio + k]);
+        historico->blocoSujo[b] = 0;
+    }
+    historico->numSujos = 0;
+
+    // Demais blocos: só os que diferem entre a base e o alvo. Páginas idênticas são puladas por inteiro.
+    if (snapshot != base)
+    {
+        for (size_t p = 0; p < snapshot->numPaginas; p++)
+        {
+            const PaginaMapa *paginaAlvo = snapshot->paginas[p], *paginaBase = base->paginas[p];
+            if (paginaAlvo == paginaBase)
+                continue;
+
+            for (size_t j = 0; j < BLOCOS_POR_PAGINA; j++)
+            {
+                size_t b = p * BLOCOS_POR_PAGINA + j;
+                if (b >= historico->numBlocos)
+                    break;
+
+                const BlocoMapa *bloco = paginaAlvo->blocos[j];
+                if (paginaBase != NULL && paginaBase->blocos[j] == bloco)
+                    continue;
+
+                size_t inicio = b * TERRITORIOS_POR_BLOCO;
+                size_t quantidade = historico->tamanho - inicio < TERRITORIOS_POR_BLOCO ? historico->tamanho - inicio : TERRITORIOS_POR_BLOCO;
+
+                memcpy(&historico->mapa[inicio], bloco->itens, quantidade * sizeof(Territorio));
+                for (size_t k = 0; k < quantidade; k++)
+                    atualizarIndicesTerritorio(&historico->mapa[inicio + k]);
+            }
+        }
+    }
+
+    if (missaoInfo != NULL)
+        *missaoInfo = snapshot->info;
+    turnoAtual = snapshot->turno;
+    moverHistoricoBatalhas(historicoBatalhas, snapshot->sequenciaBatalhas);
+
+    snapshot->referencias++;
+    liberarSnapshot(base);
+    historico->base = snapshot;
+}
+
+void liberarSnapshot(SnapshotMapa *snapshot)
+{
+    if (snapshot == NULL || --snapshot->referencias > 0)
+        return;
+
+    for (size_t p = 0; p < snapshot->numPaginas; p++)
+    {
+        PaginaMapa *pagina = snapshot->paginas[p];
+        if (pagina == NULL || --pagina->referencias > 0)
+            continue;
+
+        for (int j = 0; j < BLOCOS_POR_PAGINA; j++)
+            if (pagina->blocos[j] != NULL && --pagina->blocos[j]->referencias == 0)
+                LIBERAR(pagina->blocos[j]);
+        LIBERAR(pagina);
+    }
+
+    LIBERAR(snapshot->paginas);
+    LIBERAR(snapshot);
+}
+
+const Territorio *territorioNoSnapshot(const SnapshotMapa *snapshot, size_t id)
+{
+    size_t b = id / TERRITORIOS_POR_BLOCO;
+    return &snapshot->paginas[b / BLOCOS_POR_PAGINA]->blocos[b % BLOCOS_POR_PAGINA]->itens[id % TERRITORIOS_POR_BLOCO];
+}
+
+size_t compararSnapshots(const SnapshotMapa *a, const SnapshotMapa *b, size_t *ids, size_t maxIds, size_t tamanho)
+{
+    size_t diferentes = 0;
+
+    if (a == b)
+        return 0;
+
+    for (size_t p = 0; p < a->numPaginas; p++)
+    {
+        const PaginaMapa *paginaA = a->paginas[p], *paginaB = b->paginas[p];
+        if (paginaA == paginaB)
+            continue;
+
+        for (size_t j = 0; j < BLOCOS_POR_PAGINA; j++)
+        {
+            const BlocoMapa *blocoA = paginaA->blocos[j], *blocoB = paginaB->blocos[j];
+            if (blocoA == blocoB)
+                continue;
+
+            size_t inicio = (p * BLOCOS_POR_PAGINA + j) * TERRITORIOS_POR_BLOCO;
+            for (size_t k = 0; k < TERRITORIOS_POR_BLOCO && inicio + k < tamanho; k++)
+            {
+                const Territorio *ta = &blocoA->itens[k], *tb = &blocoB->itens[k];
+                // Os campos são comparados um a um: bytes após o '\0' das strings não fazem parte do estado.
+                if (ta->tropas != tb->tropas || strcmp(ta->cor, tb->cor) != 0 || strcmp(ta->nome, tb->nome) != 0)
+                {
+                    if (ids != NULL && diferentes < maxIds)
+                        ids[diferentes] = inicio + k;
+                    diferentes++;
+                }
+            }
+        }
+    }
+
+    return diferentes;
+}
+
+void registrarPontoDesfazer(HistoricoMapa *historico)
+{
+    if (historico == NULL)
+        return;
+
+    SnapshotMapa *snapshot = capturarSnapshot(historico);
+    if (snapshot == NULL)
+        return;
+
+    // A pilha de desfazer é circular: ao atingir o limite, o ponto mais antigo é descartado.
+    if (historico->numDesfazer == LIMITE_DESFAZER)
+    {
+        liberarSnapshot(historico->desfazer[historico->inicioDesfazer]);
+        historico->inicioDesfazer = (historico->inicioDesfazer + 1) % LIMITE_DESFAZER;
+        historico->numDesfazer--;
+    }
+    historico->desfazer[(historico->inicioDesfazer + historico->numDesfazer) % LIMITE_DESFAZER] = snapshot;
+    historico->numDesfazer++;
+
+    // Uma jogada nova invalida o que havia sido desfeito.
+    while (historico->numRefazer > 0)
+        liberarSnapshot(historico->refazer[--historico->numRefazer]);
+}
+
+int desfazerJogada(HistoricoMapa *historico)
+{
+    if (historico == NULL || historico->numDesfazer == 0)
+        return 0;
+
+    SnapshotMapa *atual = capturarSnapshot(historico);
+    if (atual == NULL)
+        return 0;
+
+    historico->numDesfazer--;
+    SnapshotMapa *alvo = historico->desfazer[(historico->inicioDesfazer + historico->numDesfazer) % LIMITE_DESFAZER];
+
+    // A soma das duas pilhas nunca passa de LIMITE_DESFAZER, pois cada desfazer move um único ponto.
+    historico->refazer[historico->numRefazer++] = atual;
+
+    restaurarSnapshot(historico, alvo);
+    liberarSnapshot(alvo);
+    return 1;
+}
+
+void descartarPontosDesfazer(HistoricoMapa *historico)
+{
+    if (historico == NULL)
+        return;
+
+    while (historico->numDesfazer > 0)
+    {
+        historico->numDesfazer--;
+        liberarSnapshot(historico->desfazer[(historico->inicioDesfazer + historico->numDesfazer) % LIMITE_DESFAZER]);
+    }
+    historico->inicioDesfazer = 0;
+    while (historico->numRefazer > 0)
+        liberarSnapshot(historico->refazer[--historico->numRefazer]);
+}
+
+int refazerJogada(HistoricoMapa *historico)
+{
+    if (historico == NULL || historico->numRefazer == 0)
+        return 0;
+
+    SnapshotMapa *atual = capturarSnapshot(historico);
+    if (atual == NULL)
+        return 0;
+
+    SnapshotMapa *alvo = historico->refazer[--historico->numRefazer];
+
+    historico->desfazer[(historico->inicioDesfazer + historico->numDesfazer) % LIMITE_DESFAZER] = atual;
+    historico->numDesfazer++;
+
+    restaurarSnapshot(historico, alvo);
+    liberarSnapshot(alvo);
+    return 1;
+}
+
+void exibirDiferencasDesdeInicio(HistoricoMapa *historico)
+{
+    if (historico == NULL)
+        return;
+
+    SnapshotMapa *atual = capturarSnapshot(historico);
+    if (atual == NULL)
+    {
+        printf("\n ❌  Erro ao alocar memória para o snapshot.\n");
+        return;
+    }
+
+    size_t ids[20];
+    size_t total = compararSnapshots(historico->inicial, atual, ids, 20, historico->tamanho);
+
+    printf("\n==== 🔍  ALTERAÇÕES DESDE O INÍCIO DA PARTIDA ====\n\n");
+    if (total == 0)
+        printf("Nenhum território foi alterado.\n");
+
+    for (size_t i = 0; i < total && i < 20; i++)
+    {
+        const Territorio *antes = territorioNoSnapshot(historico->inicial, ids[i]);
+        const Territorio *depois = territorioNoSnapshot(atual, ids[i]);
+        printf("[%zu] %s | Cor: %s -> %s | Tropas: %d -> %d\n", ids[i] + 1, depois->nome, antes->cor, depois->cor, antes->tropas, depois->tropas);
+    }
+    if (total > 20)
+        printf("... e mais %zu território(s).\n", total - 20);
+
+    liberarSnapshot(atual);
+}
+
+// **** Índice de territórios por nome: ****
+
+IndiceNomes *criarIndiceNomes(const Territorio *mapa, size_t quantidadeEsperada)
+{
+    IndiceNomes *indice = (IndiceNomes *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(IndiceNomes));
+    if (indice == NULL)
+        return NULL;
+
+    // Fator de carga máximo de 50%: as sondagens lineares continuam curtas mesmo com milhões de nomes.
+    size_t capacidade = 16;
+    while (capacidade < quantidadeEsperada * 2 && capacidade <= SIZE_MAX / 4)
+        capacidade *= 2;
+
+    indice->mapa = mapa;
+    indice->capacidade = capacidade;
+    indice->hashes = (uint64_t *)ALOCAR(MEMORIA_INDICES, capacidade * sizeof(uint64_t));
+    indice->ids = (size_t *)ALOCAR(MEMORIA_INDICES, capacidade * sizeof(size_t));
+    if (indice->hashes == NULL || indice->ids == NULL)
+    {
+        liberarIndiceNomes(indice);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < capacidade; i++)
+        indice->ids[i] = ID_INEXISTENTE;
+
+    return indice;
+}
+
+IndiceNomes *construirIndiceNomes(const Territorio *mapa, size_t tamanho)
+{
+    IndiceNomes *indice = criarIndiceNomes(mapa, tamanho);
+    if (indice == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < tamanho; i++)
+        inserirNomeIndice(indice, i);
+
+    return indice;
+}
+
+int inserirNomeIndice(IndiceNomes *indice, size_t id)
+{
+    // A capacidade é definida na criação e não cresce. Acima do limite, o nome fica acessível apenas pelo ID.
+    if (indice->quantidade * 2 >= indice->capacidade)
+        return 0;
+
+    const char *nome = indice->mapa[id].nome;
+    uint64_t hash = hashTexto(nome);
+    size_t mascara = indice->capacidade - 1;
+
+    for (size_t posicao = (size_t)hash & mascara;; posicao = (posicao + 1) & mascara)
+    {
+        if (indice->ids[posicao] == ID_INEXISTENTE)
+        {
+            indice->hashes[posicao] = hash;
+            indice->ids[posicao] = id;
+            indice->quantidade++;
+            return 1;
+        }
+
+        if (indice->hashes[posicao] == hash && strcmp(indice->mapa[indice->ids[posicao]].nome, nome) == 0)
+            return 0;
+    }
+}
+
+size_t buscarTerritorioPorNome(const IndiceNomes *indice, const char *nome)
+{
+    if (indice == NULL)
+        return ID_INEXISTENTE;
+
+    uint64_t hash = hashTexto(nome);
+    size_t mascara = indice->capacidade - 1;
+
+    // Com fator de carga abaixo de 50% sempre existe uma posição vazia, que encerra a sondagem.
+    for (size_t posicao = (size_t)hash & mascara; indice->ids[posicao] != ID_INEXISTENTE; posicao = (posicao + 1) & mascara)
+    {
+        // O hash completo é comparado antes do texto, evitando strcmp em quase todas as colisões.
+        if (indice->hashes[posicao] == hash && strcmp(indice->mapa[indice->ids[posicao]].nome, nome) == 0)
+            return indice->ids[posicao];
+    }
+
+    return ID_INEXISTENTE;
+}
+
+void liberarIndiceNomes(IndiceNomes *indice)
+{
+    if (indice == NULL)
+        return;
+
+    LIBERAR(indice->hashes);
+    LIBERAR(indice->ids);
+    LIBERAR(indice);
+}
+
+// **** Listas de territórios por cor: ****
+
+IndiceCores *construirIndiceCores(const Territorio *mapa, size_t tamanho)
+{
+    IndiceCores *indice = (IndiceCores *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(IndiceCores));
+    if (indice == NULL)
+        return NULL;
+
+    indice->mapa = mapa;
+    indice->tamanho = tamanho;
+    indice->valido = 1;
+    indice->limiteTropas = 1;
+    indice->corDoTerritorio = (int *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(int));
+    indice->posicaoNaLista = (size_t *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(size_t));
+    indice->tropasRegistradas = (int *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(int));
+    if (indice->corDoTerritorio == NULL || indice->posicaoNaLista == NULL || indice->tropasRegistradas == NULL)
+    {
+        liberarIndiceCores(indice);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < tamanho; i++)
+    {
+        int idCor = registrarCor(indice, mapa[i].cor);
+        if (idCor < 0)
+        {
+            liberarIndiceCores(indice);
+            return NULL;
+        }
+
+        if (indice->quantidade[idCor] == indice->capacidade[idCor])
+        {
+            size_t novaCapacidade = indice->capacidade[idCor] == 0 ? 16 : indice->capacidade[idCor] * 2;
+            size_t *ampliado = (size_t *)REALOCAR(MEMORIA_INDICES, indice->membros[idCor], novaCapacidade * sizeof(size_t));
+            if (ampliado == NULL)
+            {
+                liberarIndiceCores(indice);
+                return NULL;
+            }
+            indice->membros[idCor] = ampliado;
+            indice->capacidade[idCor] = novaCapacidade;
+        }
+
+        indice->corDoTerritorio[i] = idCor;
+        indice->posicaoNaLista[i] = indice->quantidade[idCor];
+        indice->membros[idCor][indice->quantidade[idCor]++] = i;
+
+        indice->tropasRegistradas[i] = mapa[i].tropas;
+        contabilizarTropas(indice, idCor, mapa[i].tropas, 1);
+    }
+
+    return indice;
+}
+
+void liberarIndiceCores(IndiceCores *indice)
+{
+    if (indice == NULL)
+        return;
+
+    for (size_t c = 0; c < indice->numCores; c++)
+        LIBERAR(indice->membros[c]);
+    LIBERAR(indice->membros);
+    LIBERAR(indice->quantidade);
+    LIBERAR(indice->capacidade);
+    LIBERAR(indice->nomes);
+    LIBERAR(indice->hashes);
+    LIBERAR(indice->corDoTerritorio);
+    LIBERAR(indice->posicaoNaLista);
+    LIBERAR(indice->tropasRegistradas);
+    LIBERAR(indice->comTropas);
+    LIBERAR(indice->acimaDoLimite);
+    LIBERAR(indice->abaixoDoLimite);
+    LIBERAR(indice);
+}
+
+int buscarCor(const IndiceCores *indice, const char *cor)
+{
+    // O número de cores é pequeno (uma por jogador): uma busca linear pelo hash é suficiente.
+    uint64_t hash = hashTexto(cor);
+    for (size_t c = 0; c < indice->numCores; c++)
+        if (indice->hashes[c] == hash && strcmp(indice->nomes[c], cor) == 0)
+            return (int)c;
+    return -1;
+}
+
+int registrarCor(IndiceCores *indice, const char *cor)
+{
+    int existente = buscarCor(indice, cor);
+    if (existente >= 0)
+        return existente;
+
+    if (indice->numCores == indice->capacidadeCores)
+    {
+        size_t novaCapacidade = indice->capacidadeCores == 0 ? 8 : indice->capacidadeCores * 2;
+
+        char(*nomes)[TAM_COR] = REALOCAR(MEMORIA_INDICES, indice->nomes, novaCapacidade * sizeof(*nomes));
+        if (nomes == NULL)
+            return -1;
+        indice->nomes = nomes;
+
+        uint64_t *hashes = (uint64_t *)REALOCAR(MEMORIA_INDICES, indice->hashes, novaCapacidade * sizeof(uint64_t));
+        if (hashes == NULL)
+            return -1;
+        indice->hashes = hashes;
+
+        size_t **membros = (size_t **)REALOCAR(MEMORIA_INDICES, indice->membros, novaCapacidade * sizeof(size_t *));
+        if (membros == NULL)
+            return -1;
+        indice->membros = membros;
+
+        size_t *quantidade = (size_t *)REALOCAR(MEMORIA_INDICES, indice->quantidade, novaCapacidade * sizeof(size_t));
+        if (quantidade == NULL)
+            return -1;
+        indice->quantidade = quantidade;
+
+        size_t *capacidade = (size_t *)REALOCAR(MEMORIA_INDICES, indice->capacidade, novaCapacidade * sizeof(size_t));
+        if (capacidade == NULL)
+            return -1;
+        indice->capacidade = capacidade;
+
+        size_t *comTropas = (size_t *)REALOCAR(MEMORIA_INDICES, indice->comTropas, novaCapacidade * sizeof(size_t));
+        if (comTropas == NULL)
+            return -1;
+        indice->comTropas = comTropas;
+
+        size_t *acimaDoLimite = (size_t *)REALOCAR(MEMORIA_INDICES, indice->acimaDoLimite, novaCapacidade * sizeof(size_t));
+        if (acimaDoLimite == NULL)
+            return -1;
+        indice->acimaDoLimite = acimaDoLimite;
+
+        size_t *abaixoDoLimite = (size_t *)REALOCAR(MEMORIA_INDICES, indice->abaixoDoLimite, novaCapacidade * sizeof(size_t));
+        if (abaixoDoLimite == NULL)
+            return -1;
+        indice->abaixoDoLimite = abaixoDoLimite;
+
+        indice->capacidadeCores = novaCapacidade;
+    }
+
+    size_t c = indice->numCores++;
+    strcpy(indice->nomes[c], cor);
+    indice->hashes[c] = hashTexto(cor);
+    indice->membros[c] = NULL;
+    indice->quantidade[c] = 0;
+    indice->capacidade[c] = 0;
+    indice->comTropas[c] = 0;
+    indice->acimaDoLimite[c] = 0;
+    indice->abaixoDoLimite[c] = 0;
+
+    return (int)c;
+}
+
+void atualizarIndicesTerritorio(const Territorio *territorio)
+{
+    atualizarIndiceTropas(indiceTropas, territorio);
+
+    IndiceCores *indice = indiceCores;
+    if (indice == NULL || !indice->valido || territorio < indice->mapa)
+        return;
+
+    size_t id = (size_t)(territorio - indice->mapa);
+    if (id >= indice->tamanho)
+        return;
+
+    int corAnterior = indice->corDoTerritorio[id];
+
+    // Os agregados de tropas saem da cor anterior e entram na cor atual (que pode ser a mesma).
+    contabilizarTropas(indice, corAnterior, indice->tropasRegistradas[id], -1);
+
+    if (strcmp(indice->nomes[corAnterior], territorio->cor) == 0)
+    {
+        indice->tropasRegistradas[id] = territorio->tropas;
+        contabilizarTropas(indice, corAnterior, territorio->tropas, 1);
+        return;
+    }
+
+    int corNova = registrarCor(indice, territorio->cor);
+    if (corNova < 0)
+    {
+        indice->valido = 0;
+        return;
+    }
+
+    if (indice->quantidade[corNova] == indice->capacidade[corNova])
+    {
+        size_t novaCapacidade = indice->capacidade[corNova] == 0 ? 16 : indice->capacidade[corNova] * 2;
+        size_t *ampliado = (size_t *)REALOCAR(MEMORIA_INDICES, indice->membros[corNova], novaCapacidade * sizeof(size_t));
+        if (ampliado == NULL)
+        {
+            indice->valido = 0;
+            return;
+        }
+        indice->membros[corNova] = ampliado;
+        indice->capacidade[corNova] = novaCapacidade;
+    }
+
+    // Remoção por troca: o último território da lista antiga ocupa a posição liberada.
+    size_t posicao = indice->posicaoNaLista[id];
+    size_t ultimo = indice->membros[corAnterior][--indice->quantidade[corAnterior]];
+    indice->membros[corAnterior][posicao] = ultimo;
+    indice->posicaoNaLista[ultimo] = posicao;
+
+    indice->corDoTerritorio[id] = corNova;
+    atualizarPosseRegioes(id, corAnterior, corNova);
+    if (mapaFixo.capacidade != 0)
+        mapaFixo.corIds[id] = (uint8_t)corNova;
+    indice->posicaoNaLista[id] = indice->quantidade[corNova];
+    indice->membros[corNova][indice->quantidade[corNova]++] = id;
+
+    indice->tropasRegistradas[id] = territorio->tropas;
+    contabilizarTropas(indice, corNova, territorio->tropas, 1);
+}
+
+void contabilizarTropas(IndiceCores *indice, int cor, int tropas, int sinal)
+{
+    // Soma ou subtrai as contribuições sem desvios: as comparações valem 0 ou 1.
+    size_t delta = sinal > 0 ? 1 : (size_t)-1;
+    indice->comTropas[cor] += delta * (size_t)(tropas > 0);
+    indice->acimaDoLimite[cor] += delta * (size_t)(tropas >= indice->limiteTropas);
+    indice->abaixoDoLimite[cor] += delta * (size_t)(tropas <= indice->limiteTropas);
+}
+
+void definirLimiteTropas(IndiceCores *indice, int limite)
+{
+    indice->limiteTropas = limite;
+
+    for (size_t c = 0; c < indice->numCores; c++)
+    {
+        indice->comTropas[c] = 0;
+        indice->acimaDoLimite[c] = 0;
+        indice->abaixoDoLimite[c] = 0;
+    }
+
+    for (size_t i = 0; i < indice->tamanho; i++)
+        contabilizarTropas(indice, indice->corDoTerritorio[i], indice->tropasRegistradas[i], 1);
+}
+
+int indiceCoresDisponivel()
+{
+    return indiceCores != NULL && indiceCores->valido;
+}
+
+// **** Índice de tropas e consultas do mapa: ****
+
+/// @brief Balde de uma quantidade de tropas.
+size_t baldeDeTropas(int tropas)
+{
+    if (tropas <= 0)
+        return 0;
+    return (size_t)tropas < BALDES_TROPAS - 1 ? (size_t)tropas : BALDES_TROPAS - 1;
+}
+
+void inserirNoBalde(IndiceTropas *indice, size_t id, size_t balde)
+{
+    indice->anterior[id] = ID_INEXISTENTE;
+    indice->proximo[id] = indice->cabeca[balde];
+    if (indice->cabeca[balde] != ID_INEXISTENTE)
+        indice->anterior[indice->cabeca[balde]] = id;
+    indice->cabeca[balde] = id;
+
+    if (indice->quantidade[balde]++ == 0)
+    {
+        indice->ocupados[balde / 64] |= 1ULL << (balde % 64);
+        indice->resumo |= 1ULL << (balde / 64);
+    }
+}
+
+void removerDoBalde(IndiceTropas *indice, size_t id, size_t balde)
+{
+    if (indice->anterior[id] != ID_INEXISTENTE)
+        indice->proximo[indice->anterior[id]] = indice->proximo[id];
+    else
+        indice->cabeca[balde] = indice->proximo[id];
+    if (indice->proximo[id] != ID_INEXISTENTE)
+        indice->anterior[indice->proximo[id]] = indice->anterior[id];
+    else if (balde == BALDES_TROPAS - 1)
+        indice->caudaExcedentes = indice->anterior[id];
+
+    if (--indice->quantidade[balde] == 0)
+    {
+        indice->ocupados[balde / 64] &= ~(1ULL << (balde % 64));
+        if (indice->ocupados[balde / 64] == 0)
+            indice->resumo &= ~(1ULL << (balde / 64));
+    }
+}
+
+/// @brief Insere no balde de excedentes, na posição que mantém a ordem decrescente de tropas (empates por chegada).
+/// A busca parte de um vizinho conhecido e anda só até a posição certa.
+/// @param id Território fora de qualquer lista, com indice->tropas[id] já atualizado.
+/// @param vizinho Elemento do balde onde a busca começa, ou ID_INEXISTENTE para começar pela cauda.
+void inserirExcedente(IndiceTropas *indice, size_t id, size_t vizinho)
+{
+    size_t balde = BALDES_TROPAS - 1;
+    int tropas = indice->tropas[id];
+
+    // id fica entre 'anterior' (tropas >= as suas) e 'seguinte' (tropas menores).
+    size_t anterior = vizinho == ID_INEXISTENTE ? indice->caudaExcedentes : indice->anterior[vizinho];
+    size_t seguinte = vizinho;
+    while (anterior != ID_INEXISTENTE && indice->tropas[anterior] < tropas)
+    {
+        seguinte = anterior;
+        anterior = indice->anterior[anterior];
+    }
+    while (seguinte != ID_INEXISTENTE && indice->tropas[seguinte] >= tropas)
+    {
+        anterior = seguinte;
+        seguinte = indice->proximo[seguinte];
+    }
+
+    indice->anterior[id] = anterior;
+    indice->proximo[id] = seguinte;
+    if (anterior != ID_INEXISTENTE)
+        indice->proximo[anterior] = id;
+    else
+        indice->cabeca[balde] = id;
+    if (seguinte != ID_INEXISTENTE)
+        indice->anterior[seguinte] = id;
+    else
+        indice->caudaExcedentes = id;
+
+    if (indice->quantidade[balde]++ == 0)
+    {
+        indice->ocupados[balde / 64] |= 1ULL << (balde % 64);
+        indice->resumo |= 1ULL << (balde / 64);
+    }
+}
+
+/// @brief Par (tropas, ID) para a ordenação inicial do balde de excedentes.
+typedef struct
+{
+    int tropas;
+    size_t id;
+} ParTropas;
+
+/// @brief Ordena pares por tropas em ordem decrescente e, nos empates, por ID crescente.
+int compararParesTropas(const void *a, const void *b)
+{
+    const ParTropas *x = (const ParTropas *)a, *y = (const ParTropas *)b;
+    if (x->tropas != y->tropas)
+        return (x->tropas < y->tropas) - (x->tropas > y->tropas);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/// @brief Maior balde ocupado que não passa de `limite`.
+/// @return Balde encontrado, ou -1 se não há nenhum.
+long long baldeOcupadoAte(const IndiceTropas *indice, size_t limite)
+{
+    size_t palavra = limite / 64;
+    uint64_t bits = indice->ocupados[palavra] & (~0ULL >> (63 - limite % 64));
+    if (bits != 0)
+        return (long long)(palavra * 64 + 63 - (size_t)__builtin_clzll(bits));
+
+    // Nada nesta palavra: o resumo aponta a palavra ocupada anterior.
+    uint64_t palavras = palavra == 0 ? 0 : indice->resumo & (~0ULL >> (64 - palavra));
+    if (palavras == 0)
+        return -1;
+
+    palavra = 63 - (size_t)__builtin_clzll(palavras);
+    return (long long)(palavra * 64 + 63 - (size_t)__builtin_clzll(indice->ocupados[palavra]));
+}
+
+IndiceTropas *construirIndiceTropas(const Territorio *mapa, size_t tamanho)
+{
+    IndiceTropas *indice = (IndiceTropas *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(IndiceTropas));
+    if (indice == NULL)
+        return NULL;
+
+    indice->mapa = mapa;
+    indice->tamanho = tamanho;
+    indice->tropas = (int *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(int));
+    indice->proximo = (size_t *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(size_t));
+    indice->anterior = (size_t *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(size_t));
+    if (indice->tropas == NULL || indice->proximo == NULL || indice->anterior == NULL)
+    {
+        liberarIndiceTropas(indice);
+        return NULL;
+    }
+
+    for (size_t b = 0; b < BALDES_TROPAS; b++)
+        indice->cabeca[b] = ID_INEXISTENTE;
+    indice->caudaExcedentes = ID_INEXISTENTE;
+
+    // Inserção em ordem decrescente de ID: cada balde fica em ordem crescente. Os excedentes ficam para depois.
+    size_t excedentes = 0;
+    for (size_t i = tamanho; i-- > 0;)
+    {
+        indice->tropas[i] = mapa[i].tropas;
+        if (baldeDeTropas(mapa[i].tropas) == BALDES_TROPAS - 1)
+            excedentes++;
+        else
+            inserirNoBalde(indice, i, baldeDeTropas(mapa[i].tropas));
+    }
+
+    // Os excedentes são ordenados uma única vez e encadeados pela cauda, cada um em O(1).
+    if (excedentes == 0)
+        return indice;
+    ParTropas *pares = (ParTropas *)ALOCAR(MEMORIA_TEMPORARIA, excedentes * sizeof(ParTropas));
+    if (pares == NULL)
+    {
+        liberarIndiceTropas(indice);
+        return NULL;
+    }
+    size_t numPares = 0;
+    for (size_t i = 0; i < tamanho && numPares < excedentes; i++)
+        if (baldeDeTropas(indice->tropas[i]) == BALDES_TROPAS - 1)
+            pares[numPares++] = (ParTropas){indice->tropas[i], i};
+    qsort(pares, numPares, sizeof(ParTropas), compararParesTropas);
+    for (size_t k = 0; k < numPares; k++)
+        inserirExcedente(indice, pares[k].id, ID_INEXISTENTE);
+    LIBERAR(pares);
+
+    return indice;
+}
+
+void atualizarIndiceTropas(IndiceTropas *indice, const Territorio *territorio)
+{
+    if (indice == NULL || territorio < indice->mapa)
+        return;
+
+    size_t id = (size_t)(territorio - indice->mapa);
+    if (id >= indice->tamanho || indice->tropas[id] == territorio->tropas)
+        return;
+
+    size_t baldeAnterior = baldeDeTropas(indice->tropas[id]), baldeNovo = baldeDeTropas(territorio->tropas);
+    indice->tropas[id] = territorio->tropas;
+    if (baldeNovo == BALDES_TROPAS - 1)
+    {
+        // Dentro dos excedentes, a busca da nova posição parte do antigo vizinho; quem chega de fora entra pela cauda.
+        size_t vizinho = baldeAnterior == baldeNovo ? indice->proximo[id] : ID_INEXISTENTE;
+        removerDoBalde(indice, id, baldeAnterior);
+        inserirExcedente(indice, id, vizinho);
+    }
+    else if (baldeAnterior != baldeNovo)
+    {
+        removerDoBalde(indice, id, baldeAnterior);
+        inserirNoBalde(indice, id, baldeNovo);
+    }
+}
+
+/// @brief Coleta do balde de excedentes, já em ordem decrescente: pula quem passa de maximoTropas e para no primeiro
+/// abaixo do mínimo ou ao atingir `maximo` resultados. Sem teto de tropas (maiores exércitos), custa O(resultado).
+size_t coletarExcedentes(const IndiceTropas *indice, int minimo, int maximoTropas, size_t maximo, size_t *ids)
+{
+    size_t encontrados = 0;
+    for (size_t id = indice->cabeca[BALDES_TROPAS - 1]; id != ID_INEXISTENTE && encontrados < maximo && indice->tropas[id] >= minimo;
+         id = indice->proximo[id])
+        if (indice->tropas[id] <= maximoTropas)
+            ids[encontrados++] = id;
+    return encontrados;
+}
+
+size_t consultarFaixaTropas(const IndiceTropas *indice, int minimo, int maximoTropas, size_t maximo, size_t *ids)
+{
+    if (minimo > maximoTropas || maximo == 0)
+        return 0;
+
+    size_t encontrados = 0;
+    size_t primeiroBalde = baldeDeTropas(minimo);
+    long long balde = baldeOcupadoAte(indice, baldeDeTropas(maximoTropas));
+
+    // Do maior balde para o menor; os baldes vazios são saltados pelo bitset.
+    while (balde >= (long long)primeiroBalde && encontrados < maximo)
+    {
+        if (balde == BALDES_TROPAS - 1)
+            encontrados += coletarExcedentes(indice, minimo, maximoTropas, maximo - encontrados, ids + encontrados);
+        else
+            for (size_t id = indice->cabeca[balde]; id != ID_INEXISTENTE && encontrados < maximo; id = indice->proximo[id])
+                if (indice->tropas[id] >= minimo && indice->tropas[id] <= maximoTropas) // Só o balde zero mistura valores (tropas <= 0).
+                    ids[encontrados++] = id;
+
+        balde = balde == 0 ? -1 : baldeOcupadoAte(indice, (size_t)balde - 1);
+    }
+
+    return encontrados;
+}
+
+size_t consultarMaisTropas(const IndiceTropas *indice, size_t maximo, size_t *ids)
+{
+    return consultarFaixaTropas(indice, INT_MIN, INT_MAX, maximo, ids);
+}
+
+size_t consultarCor(const char *cor, size_t maximo, size_t *ids)
+{
+    int idCor = buscarCor(indiceCores, cor);
+    if (idCor < 0)
+        return 0;
+
+    const size_t *membros = indiceCores->membros[idCor];
+    size_t quantidade = indiceCores->quantidade[idCor];
+    if (maximo == 0)
+        return 0;
+
+    // A lista da cor perde a ordem nas remoções por troca. Os `maximo` menores IDs são escolhidos em um heap de
+    // máximo limitado (a raiz é o maior ID guardado), em O(k log maximo), e só eles são ordenados no fim.
+    size_t encontrados = 0;
+    for (size_t m = 0; m < quantidade; m++)
+    {
+        size_t id = membros[m], pos;
+        if (encontrados < maximo)
+        {
+            // Sobe a partir da última folha.
+            for (pos = encontrados++; pos > 0 && ids[(pos - 1) / 2] < id; pos = (pos - 1) / 2)
+                ids[pos] = ids[(pos - 1) / 2];
+            ids[pos] = id;
+            continue;
+        }
+        if (id >= ids[0])
+            continue;
+
+        // Substitui a raiz e desce até o lugar do novo ID.
+        for (pos = 0;;)
+        {
+            size_t filho = 2 * pos + 1;
+            if (filho >= encontrados)
+                break;
+            if (filho + 1 < encontrados && ids[filho + 1] > ids[filho])
+                filho++;
+            if (ids[filho] <= id)
+                break;
+            ids[pos] = ids[filho];
+            pos = filho;
+        }
+        ids[pos] = id;
+    }
+
+    qsort(ids, encontrados, sizeof(size_t), compararIds);
+    return encontrados;
+}
+
+void faseDeConsultas(const Territorio *mapa)
+{
+    if (indiceTropas == NULL || !indiceCoresDisponivel())
+    {
+        printf("\n ⚠️  Os índices de consulta não estão disponíveis.\n");
+        return;
+    }
+
+    int tipo = 0;
+    printf("\n==== 🔎  CONSULTAR TERRITÓRIOS ====\n");
+    printf("\n 1 - Por cor | 2 - Por faixa de tropas | 3 - Maiores exércitos: ");
+    if (scanf("%d", &tipo) != 1)
+        tipo = 0;
+    limparBufferEntrada();
+
+    size_t encontrados[LINHAS_POR_PAGINA];
+    size_t quantidade = 0;
+    int limite = LINHAS_POR_PAGINA;
+
+    if (tipo == 1)
+    {
+        char cor[TAM_COR];
+        printf("\n Cor: ");
+        if (fgets(cor, sizeof(cor), stdin) == NULL)
+            return;
+        if (strchr(cor, '\n') == NULL)
+            limparBufferEntrada();
+        limparEnter(cor);
+
+        quantidade = consultarCor(cor, LINHAS_POR_PAGINA, encontrados);
+    }
+    else if (tipo == 2)
+    {
+        int minimo, maximo;
+        printf("\n Tropas mínimas e máximas (ex.: 5 10): ");
+        if (scanf("%d %d", &minimo, &maximo) != 2)
+        {
+            limparBufferEntrada();
+            printf("\n ⚠️  Faixa inválida.\n");
+            return;
+        }
+        limparBufferEntrada();
+
+        quantidade = consultarFaixaTropas(indiceTropas, minimo, maximo, LINHAS_POR_PAGINA, encontrados);
+    }
+    else if (tipo == 3)
+    {
+        printf("\n Quantidade de territórios: ");
+        if (scanf("%d", &limite) != 1 || limite < 1)
+            limite = 1;
+        limparBufferEntrada();
+        if (limite > LINHAS_POR_PAGINA)
+            limite = LINHAS_POR_PAGINA;
+
+        quantidade = consultarMaisTropas(indiceTropas, (size_t)limite, encontrados);
+    }
+    else
+    {
+        printf("\n ⚠️  Opção inválida.\n");
+        return;
+    }
+
+    if (quantidade == 0)
+        printf("\n Nenhum território encontrado.\n");
+
+    for (size_t i = 0; i < quantidade; i++)
+        printf("[%zu] %s | Exército Cor: %s | Tropas: %d\n", encontrados[i] + 1, mapa[encontrados[i]].nome,
+               mapa[encontrados[i]].cor, mapa[encontrados[i]].tropas);
+
+    if (quantidade == LINHAS_POR_PAGINA)
+        printf("... limite de %d linhas atingido. Refine a consulta para ver os demais.\n", LINHAS_POR_PAGINA);
+}
+
+void liberarIndiceTropas(IndiceTropas *indice)
+{
+    if (indice == NULL)
+        return;
+
+    LIBERAR(indice->tropas);
+    LIBERAR(indice->proximo);
+    LIBERAR(indice->anterior);
+    LIBERAR(indice);
+}
+
+// **** Regiões (continentes) do mapa: ****
+
+MapaRegioes *criarRegioes(const Territorio *mapa, size_t tamanhoMapa)
+{
+    MapaRegioes *novas = (MapaRegioes *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(MapaRegioes));
+    if (novas == NULL)
+        return NULL;
+
+    novas->mapa = mapa;
+    novas->tamanhoMapa = tamanhoMapa;
+    novas->palavrasPorCor = (tamanhoMapa + 63) / 64;
+
+    // O vetor de início tem sempre uma posição a mais que o número de regiões.
+    novas->inicio = (size_t *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(size_t));
+    novas->regiaoDoTerritorio = (size_t *)ALOCAR(MEMORIA_INDICES, tamanhoMapa * sizeof(size_t));
+    if (novas->inicio == NULL || novas->regiaoDoTerritorio == NULL)
+    {
+        liberarRegioes(novas);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < tamanhoMapa; i++)
+        novas->regiaoDoTerritorio[i] = ID_INEXISTENTE;
+
+    return novas;
+}
+
+int compararIds(const void *a, const void *b)
+{
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+long long adicionarRegiao(MapaRegioes *regioes, const char *nome, const size_t *ids, size_t quantidade, int bonus)
+{
+    if (quantidade == 0)
+        return -1;
+
+    if (regioes->numRegioes == regioes->capacidadeRegioes)
+    {
+        size_t novaCapacidade = regioes->capacidadeRegioes == 0 ? 8 : regioes->capacidadeRegioes * 2;
+
+        char(*nomes)[TAM_NOME] = REALOCAR(MEMORIA_INDICES, regioes->nomes, novaCapacidade * sizeof(*nomes));
+        if (nomes == NULL)
+            return -1;
+        regioes->nomes = nomes;
+
+        int *bonusAmpliado = (int *)REALOCAR(MEMORIA_INDICES, regioes->bonus, novaCapacidade * sizeof(int));
+        if (bonusAmpliado == NULL)
+            return -1;
+        regioes->bonus = bonusAmpliado;
+
+        size_t *numMembros = (size_t *)REALOCAR(MEMORIA_INDICES, regioes->numMembros, novaCapacidade * sizeof(size_t));
+        if (numMembros == NULL)
+            return -1;
+        regioes->numMembros = numMembros;
+
+        size_t *inicio = (size_t *)REALOCAR(MEMORIA_INDICES, regioes->inicio, (novaCapacidade + 1) * sizeof(size_t));
+        if (inicio == NULL)
+            return -1;
+        regioes->inicio = inicio;
+
+        regioes->capacidadeRegioes = novaCapacidade;
+    }
+
+    // Com os IDs ordenados, membros da mesma palavra ficam vizinhos e viram uma única entrada.
+    size_t *ordenados = (size_t *)ALOCAR(MEMORIA_TEMPORARIA, quantidade * sizeof(size_t));
+    if (ordenados == NULL)
+        return -1;
+    memcpy(ordenados, ids, quantidade * sizeof(size_t));
+    qsort(ordenados, quantidade, sizeof(size_t), compararIds);
+
+    if (ordenados[quantidade - 1] >= regioes->tamanhoMapa)
+    {
+        LIBERAR(ordenados);
+        return -1;
+    }
+
+    // Como nos continentes do WAR, um território pertence a no máximo uma região.
+    for (size_t i = 0; i < quantidade; i++)
+    {
+        if (regioes->regiaoDoTerritorio[ordenados[i]] != ID_INEXISTENTE)
+        {
+            LIBERAR(ordenados);
+            return -1;
+        }
+    }
+
+    // No pior caso, cada membro ocupa uma palavra diferente.
+    if (regioes->numEntradas + quantidade > regioes->capacidadeEntradas)
+    {
+        size_t novaCapacidade = regioes->capacidadeEntradas == 0 ? 64 : regioes->capacidadeEntradas;
+        while (novaCapacidade < regioes->numEntradas + quantidade)
+            novaCapacidade *= 2;
+
+        size_t *palavras = (size_t *)REALOCAR(MEMORIA_INDICES, regioes->palavras, novaCapacidade * sizeof(size_t));
+        if (palavras == NULL)
+        {
+            LIBERAR(ordenados);
+            return -1;
+        }
+        regioes->palavras = palavras;
+
+        uint64_t *mascaras = (uint64_t *)REALOCAR(MEMORIA_INDICES, regioes->mascaras, novaCapacidade * sizeof(uint64_t));
+        if (mascaras == NULL)
+        {
+            LIBERAR(ordenados);
+            return -1;
+        }
+        regioes->mascaras = mascaras;
+
+        regioes->capacidadeEntradas = novaCapacidade;
+    }
+
+    size_t r = regioes->numRegioes;
+    size_t membrosDistintos = 0;
+    size_t entrada = regioes->numEntradas;
+
+    for (size_t i = 0; i < quantidade; i++)
+    {
+        if (i > 0 && ordenados[i] == ordenados[i - 1])
+            continue;
+
+        size_t palavra = ordenados[i] / 64;
+        uint64_t bit = 1ULL << (ordenados[i] % 64);
+
+        if (entrada == regioes->numEntradas || regioes->palavras[entrada - 1] != palavra)
+        {
+            regioes->palavras[entrada] = palavra;
+            regioes->mascaras[entrada] = 0;
+            entrada++;
+        }
+        regioes->mascaras[entrada - 1] |= bit;
+        regioes->regiaoDoTerritorio[ordenados[i]] = regioes->numRegioes;
+        membrosDistintos++;
+    }
+    LIBERAR(ordenados);
+
+    snprintf(regioes->nomes[r], TAM_NOME, "%s", nome);
+    regioes->bonus[r] = bonus;
+    regioes->numMembros[r] = membrosDistintos;
+    regioes->numEntradas = entrada;
+    regioes->inicio[r + 1] = entrada;
+    regioes->numRegioes++;
+
+    return (long long)r;
+}
+
+MapaRegioes *particionarRegioes(const Territorio *mapa, size_t tamanho, size_t territoriosPorRegiao)
+{
+    if (territoriosPorRegiao == 0)
+        return NULL;
+
+    size_t numRegioes = (tamanho + territoriosPorRegiao - 1) / territoriosPorRegiao;
+    if (numRegioes < 2)
+        return NULL;
+
+    MapaRegioes *novas = criarRegioes(mapa, tamanho);
+    size_t *ids = (size_t *)ALOCAR(MEMORIA_TEMPORARIA, territoriosPorRegiao * 2 * sizeof(size_t));
+    if (novas == NULL || ids == NULL)
+    {
+        liberarRegioes(novas);
+        LIBERAR(ids);
+        return NULL;
+    }
+
+    for (size_t r = 0; r < numRegioes; r++)
+    {
+        // Divisão equilibrada: os tamanhos das regiões diferem em no máximo um território.
+        size_t primeiro = r * tamanho / numRegioes, fim = (r + 1) * tamanho / numRegioes;
+        for (size_t i = primeiro; i < fim; i++)
+            ids[i - primeiro] = i;
+
+        char nome[TAM_NOME];
+        snprintf(nome, TAM_NOME, "Região %zu", r + 1);
+
+        int bonus = (int)((fim - primeiro) / 2 > 0 ? (fim - primeiro) / 2 : 1);
+        if (adicionarRegiao(novas, nome, ids, fim - primeiro, bonus) < 0)
+        {
+            liberarRegioes(novas);
+            LIBERAR(ids);
+            return NULL;
+        }
+    }
+
+    LIBERAR(ids);
+    return novas;
+}
+
+int construirPosseRegioes(MapaRegioes *regioes)
+{
+    regioes->posseValida = 0;
+    if (!indiceCoresDisponivel())
+        return 0;
+
+    for (size_t c = 0; c < regioes->numCoresPosse; c++)
+        LIBERAR(regioes->posse[c]);
+    LIBERAR(regioes->posse);
+    LIBERAR(regioes->regioesPorCor);
+    LIBERAR(regioes->bonusPorCor);
+    LIBERAR(regioes->donoRegiao);
+    regioes->numCoresPosse = 0;
+
+    regioes->posse = (uint64_t **)ALOCAR_ZERADO(MEMORIA_INDICES, indiceCores->numCores, sizeof(uint64_t *));
+    regioes->regioesPorCor = (size_t *)ALOCAR_ZERADO(MEMORIA_INDICES, indiceCores->numCores, sizeof(size_t));
+    regioes->bonusPorCor = (int *)ALOCAR_ZERADO(MEMORIA_INDICES, indiceCores->numCores, sizeof(int));
+    regioes->donoRegiao = (int *)ALOCAR(MEMORIA_INDICES, regioes->numRegioes * sizeof(int));
+    if (regioes->posse == NULL || regioes->regioesPorCor == NULL || regioes->bonusPorCor == NULL || regioes->donoRegiao == NULL)
+        return 0;
+
+    for (size_t c = 0; c < indiceCores->numCores; c++)
+    {
+        regioes->posse[c] = (uint64_t *)ALOCAR_ZERADO(MEMORIA_INDICES, regioes->palavrasPorCor, sizeof(uint64_t));
+        regioes->numCoresPosse = c + 1;
+        if (regioes->posse[c] == NULL)
+            return 0;
+
+        // Os membros de cada cor já estão listados no índice: apenas os bits deles são ligados.
+        for (size_t k = 0; k < indiceCores->quantidade[c]; k++)
+        {
+            size_t id = indiceCores->membros[c][k];
+            regioes->posse[c][id / 64] |= 1ULL << (id % 64);
+        }
+    }
+
+    // Dono inicial de cada região: o único candidato é a cor do primeiro membro.
+    regioes->posseValida = 1;
+    for (size_t r = 0; r < regioes->numRegioes; r++)
+    {
+        size_t e = regioes->inicio[r];
+        size_t primeiroMembro = regioes->palavras[e] * 64 + (size_t)__builtin_ctzll(regioes->mascaras[e]);
+        int candidata = indiceCores->corDoTerritorio[primeiroMembro];
+
+        regioes->donoRegiao[r] = -1;
+        if (regiaoDominadaPor(regioes, r, indiceCores->nomes[candidata]))
+        {
+            regioes->donoRegiao[r] = candidata;
+            regioes->regioesPorCor[candidata]++;
+            regioes->bonusPorCor[candidata] += regioes->bonus[r];
+        }
+    }
+
+    return 1;
+}
+
+void atualizarPosseRegioes(size_t id, int corAnterior, int corNova)
+{
+    if (regioes == NULL || !regioes->posseValida)
+        return;
+
+    // Uma cor nova, registrada depois da construção, ganha seu bitset agora.
+    if ((size_t)corNova >= regioes->numCoresPosse)
+    {
+        uint64_t **posse = (uint64_t **)REALOCAR(MEMORIA_INDICES, regioes->posse, ((size_t)corNova + 1) * sizeof(uint64_t *));
+        if (posse == NULL)
+        {
+            regioes->posseValida = 0;
+            return;
+        }
+        regioes->posse = posse;
+
+        size_t *regioesPorCor = (size_t *)REALOCAR(MEMORIA_INDICES, regioes->regioesPorCor, ((size_t)corNova + 1) * sizeof(size_t));
+        if (regioesPorCor == NULL)
+        {
+            regioes->posseValida = 0;
+            return;
+        }
+        regioes->regioesPorCor = regioesPorCor;
+
+        int *bonusPorCor = (int *)REALOCAR(MEMORIA_INDICES, regioes->bonusPorCor, ((size_t)corNova + 1) * sizeof(int));
+        if (bonusPorCor == NULL)
+        {
+            regioes->posseValida = 0;
+            return;
+        }
+        regioes->bonusPorCor = bonusPorCor;
+
+        for (size_t c = regioes->numCoresPosse; c <= (size_t)corNova; c++)
+        {
+            regioes->regioesPorCor[c] = 0;
+            regioes->bonusPorCor[c] = 0;
+            regioes->posse[c] = (uint64_t *)ALOCAR_ZERADO(MEMORIA_INDICES, regioes->palavrasPorCor, sizeof(uint64_t));
+            regioes->numCoresPosse = c + 1;
+            if (regioes->posse[c] == NULL)
+            {
+                regioes->posseValida = 0;
+                return;
+            }
+        }
+    }
+
+    uint64_t bit = 1ULL << (id % 64);
+    regioes->posse[corAnterior][id / 64] &= ~bit;
+    regioes->posse[corNova][id / 64] |= bit;
+
+    // Apenas a região do território pode mudar de dono: o custo independe do tamanho do mapa.
+    size_t r = regioes->regiaoDoTerritorio[id];
+    if (r == ID_INEXISTENTE)
+        return;
+
+    if (regioes->donoRegiao[r] == corAnterior)
+    {
+        regioes->donoRegiao[r] = -1;
+        regioes->regioesPorCor[corAnterior]--;
+        regioes->bonusPorCor[corAnterior] -= regioes->bonus[r];
+    }
+
+    if (regiaoDominadaPor(regioes, r, indiceCores->nomes[corNova]))
+    {
+        regioes->donoRegiao[r] = corNova;
+        regioes->regioesPorCor[corNova]++;
+        regioes->bonusPorCor[corNova] += regioes->bonus[r];
+    }
+}
+
+int regiaoDominadaPor(const MapaRegioes *regioes, size_t regiao, const char *cor)
+{
+    size_t primeira = regioes->inicio[regiao], fim = regioes->inicio[regiao + 1];
+
+    if (regioes->posseValida && indiceCoresDisponivel())
+    {
+        int idCor = buscarCor(indiceCores, cor);
+        if (idCor < 0 || (size_t)idCor >= regioes->numCoresPosse)
+            return 0;
+
+        // Um AND por palavra da região: a região é da cor se nenhum membro está fora do bitset de posse.
+        const uint64_t *posse = regioes->posse[idCor];
+        uint64_t faltantes = 0;
+        for (size_t e = primeira; e < fim; e++)
+            faltantes |= regioes->mascaras[e] & ~posse[regioes->palavras[e]];
+        return faltantes == 0;
+    }
+
+    // Sem os bitsets de posse, os membros da região são comparados um a um.
+    for (size_t e = primeira; e < fim; e++)
+    {
+        uint64_t mascara = regioes->mascaras[e];
+        while (mascara != 0)
+        {
+            size_t id = regioes->palavras[e] * 64 + (size_t)__builtin_ctzll(mascara);
+            if (strcmp(regioes->mapa[id].cor, cor) != 0)
+                return 0;
+            mascara &= mascara - 1;
+        }
+    }
+    return 1;
+}
+
+size_t contarRegioesDominadas(const MapaRegioes *regioes, const char *cor)
+{
+    size_t dominadas = 0;
+    for (size_t r = 0; r < regioes->numRegioes; r++)
+        dominadas += (size_t)regiaoDominadaPor(regioes, r, cor);
+    return dominadas;
+}
+
+const char *donoDaRegiao(const MapaRegioes *regioes, size_t regiao)
+{
+    // O único candidato é a cor do primeiro membro da região.
+    size_t e = regioes->inicio[regiao];
+    size_t primeiroMembro = regioes->palavras[e] * 64 + (size_t)__builtin_ctzll(regioes->mascaras[e]);
+    const char *candidata = regioes->mapa[primeiroMembro].cor;
+
+    return regiaoDominadaPor(regioes, regiao, candidata) ? candidata : NULL;
+}
+
+void exibirRegioes(const MapaRegioes *regioes)
+{
+    if (regioes == NULL)
+    {
+        printf("\n ⚠️  Este mapa não possui regiões.\n");
+        return;
+    }
+
+    printf("\n==== 🗺️  REGIÕES DO MAPA ====\n");
+
+    size_t exibidas = regioes->numRegioes < LINHAS_POR_PAGINA ? regioes->numRegioes : LINHAS_POR_PAGINA;
+    for (size_t r = 0; r < exibidas; r++)
+    {
+        const char *dono = donoDaRegiao(regioes, r);
+        printf("[%zu] %s | Territórios: %zu | Bônus: %d | Domínio: %s\n", r + 1, regioes->nomes[r], regioes->numMembros[r],
+               regioes->bonus[r], dono != NULL ? dono : "dividida");
+    }
+
+    if (exibidas < regioes->numRegioes)
+        printf("... (%zu regiões no total)\n", regioes->numRegioes);
+}
+
+void liberarRegioes(MapaRegioes *regioes)
+{
+    if (regioes == NULL)
+        return;
+
+    for (size_t c = 0; c < regioes->numCoresPosse; c++)
+        LIBERAR(regioes->posse[c]);
+    LIBERAR(regioes->posse);
+    LIBERAR(regioes->nomes);
+    LIBERAR(regioes->bonus);
+    LIBERAR(regioes->numMembros);
+    LIBERAR(regioes->inicio);
+    LIBERAR(regioes->palavras);
+    LIBERAR(regioes->mascaras);
+    LIBERAR(regioes->regiaoDoTerritorio);
+    LIBERAR(regioes->donoRegiao);
+    LIBERAR(regioes->regioesPorCor);
+    LIBERAR(regioes->bonusPorCor);
+    LIBERAR(regioes);
+}
+
+// **** Histórico de batalhas e conquistas: ****
+
+HistoricoBatalhas *criarHistoricoBatalhas(const Territorio *mapa, size_t tamanhoMapa)
+{
+    HistoricoBatalhas *historico = (HistoricoBatalhas *)ALOCAR_ZERADO(MEMORIA_HISTORICO, 1, sizeof(HistoricoBatalhas));
+    if (historico == NULL)
+        return NULL;
+
+    historico->mapa = mapa;
+    historico->tamanhoMapa = tamanhoMapa;
+    historico->registros = (RegistroBatalha *)ALOCAR_ZERADO(MEMORIA_HISTORICO, CAPACIDADE_HISTORICO_BATALHAS, sizeof(RegistroBatalha));
+    historico->ultimaDoTerritorio = (uint64_t *)ALOCAR_ZERADO(MEMORIA_HISTORICO, tamanhoMapa, sizeof(uint64_t));
+    if (historico->registros == NULL || historico->ultimaDoTerritorio == NULL)
+    {
+        liberarHistoricoBatalhas(historico);
+        return NULL;
+    }
+
+    return historico;
+}
+
+void registrarBatalha(const Territorio *atacante, const Territorio *defensor, const char *corDefensorAntes,
+                      int perdasAtacante, int perdasDefensor, int conquista)
+{
+    HistoricoBatalhas *historico = historicoBatalhas;
+    if (historico == NULL)
+        return;
+
+    // Uma batalha nova depois de um desfazer descarta de vez as desfeitas: elas não poderão mais ser refeitas.
+    uint64_t maisAntiga = historico->proximaSequencia > CAPACIDADE_HISTORICO_BATALHAS
+                              ? historico->proximaSequencia - CAPACIDADE_HISTORICO_BATALHAS
+                              : 0;
+    for (uint64_t s = historico->sequenciaVisivel > maisAntiga ? historico->sequenciaVisivel : maisAntiga;
+         s < historico->proximaSequencia; s++)
+        historico->registros[s % CAPACIDADE_HISTORICO_BATALHAS].desfeita = 2;
+
+    uint64_t sequencia = historico->proximaSequencia++;
+    historico->sequenciaVisivel = historico->proximaSequencia;
+    RegistroBatalha *registro = &historico->registros[sequencia % CAPACIDADE_HISTORICO_BATALHAS];
+
+    memset(registro, 0, sizeof(RegistroBatalha));
+    registro->sequencia = sequencia;
+    registro->atacante = (size_t)(atacante - historico->mapa);
+    registro->defensor = (size_t)(defensor - historico->mapa);
+    registro->turno = turnoAtual;
+    registro->perdasAtacante = perdasAtacante;
+    registro->perdasDefensor = perdasDefensor;
+    registro->conquista = conquista;
+    memcpy(registro->corAtacante, atacante->cor, TAM_COR);
+    memcpy(registro->corDefensor, corDefensorAntes, TAM_COR);
+
+    if (!conquista)
+        return;
+
+    // Índice por território: a conquista passa a ser a mais recente dele.
+    registro->anteriorDoTerritorio = historico->ultimaDoTerritorio[registro->defensor];
+    historico->ultimaDoTerritorio[registro->defensor] = sequencia + 1;
+
+    // Índice por cor perdedora. Sem o índice de cores, não há id para a cor e a cadeia não é mantida.
+    int idCor = indiceCoresDisponivel() ? buscarCor(indiceCores, corDefensorAntes) : -1;
+    if (idCor < 0)
+        return;
+
+    if ((size_t)idCor >= historico->capacidadeCores)
+    {
+        size_t novaCapacidade = historico->capacidadeCores == 0 ? 8 : historico->capacidadeCores;
+        while (novaCapacidade <= (size_t)idCor)
+            novaCapacidade *= 2;
+
+        uint64_t *ampliado = (uint64_t *)REALOCAR(MEMORIA_HISTORICO, historico->ultimaDaCor, novaCapacidade * sizeof(uint64_t));
+        if (ampliado == NULL)
+            return;
+        for (size_t c = historico->capacidadeCores; c < novaCapacidade; c++)
+            ampliado[c] = 0;
+        historico->ultimaDaCor = ampliado;
+        historico->capacidadeCores = novaCapacidade;
+    }
+
+    registro->anteriorDaCor = historico->ultimaDaCor[idCor];
+    historico->ultimaDaCor[idCor] = sequencia + 1;
+}
+
+void moverHistoricoBatalhas(HistoricoBatalhas *historico, uint64_t sequencia)
+{
+    if (historico == NULL || sequencia == historico->sequenciaVisivel)
+        return;
+
+    int desfazer = sequencia < historico->sequenciaVisivel;
+    uint64_t inicio = desfazer ? sequencia : historico->sequenciaVisivel;
+    uint64_t fim = desfazer ? historico->sequenciaVisivel : sequencia;
+
+    // Registros já sobrescritos pelo giro do buffer não precisam de marca.
+    if (historico->proximaSequencia - inicio > CAPACIDADE_HISTORICO_BATALHAS)
+        inicio = historico->proximaSequencia - CAPACIDADE_HISTORICO_BATALHAS;
+
+    for (uint64_t s = inicio; s < fim; s++)
+    {
+        RegistroBatalha *registro = &historico->registros[s % CAPACIDADE_HISTORICO_BATALHAS];
+        if (desfazer && registro->desfeita == 0)
+            registro->desfeita = 1;
+        else if (!desfazer && registro->desfeita == 1)
+            registro->desfeita = 0;
+    }
+    historico->sequenciaVisivel = sequencia;
+}
+
+const RegistroBatalha *registroDoElo(const HistoricoBatalhas *historico, uint64_t elo)
+{
+    if (elo == 0)
+        return NULL;
+
+    uint64_t sequencia = elo - 1;
+    if (historico->proximaSequencia - sequencia > CAPACIDADE_HISTORICO_BATALHAS)
+        return NULL; // O buffer já deu a volta sobre esse registro.
+
+    return &historico->registros[sequencia % CAPACIDADE_HISTORICO_BATALHAS];
+}
+
+size_t ultimasConquistasDoTerritorio(const HistoricoBatalhas *historico, size_t territorio, size_t maximo, const RegistroBatalha **saida)
+{
+    if (territorio >= historico->tamanhoMapa)
+        return 0;
+
+    size_t encontrados = 0;
+    const RegistroBatalha *registro = registroDoElo(historico, historico->ultimaDoTerritorio[territorio]);
+
+    while (registro != NULL && encontrados < maximo)
+    {
+        if (!registro->desfeita)
+            saida[encontrados++] = registro;
+        registro = registroDoElo(historico, registro->anteriorDoTerritorio);
+    }
+
+    return encontrados;
+}
+
+size_t perdasDaCorNosTurnos(const HistoricoBatalhas *historico, const char *cor, int turnos, size_t maximo, const RegistroBatalha **saida)
+{
+    if (!indiceCoresDisponivel())
+        return 0;
+
+    int idCor = buscarCor(indiceCores, cor);
+    if (idCor < 0 || (size_t)idCor >= historico->capacidadeCores)
+        return 0;
+
+    // A cadeia está em ordem decrescente de turno: para no primeiro registro fora da janela.
+    int primeiroTurno = turnoAtual - turnos + 1;
+    size_t encontrados = 0;
+    const RegistroBatalha *registro = registroDoElo(historico, historico->ultimaDaCor[idCor]);
+
+    while (registro != NULL && encontrados < maximo && registro->turno >= primeiroTurno)
+    {
+        if (!registro->desfeita)
+            saida[encontrados++] = registro;
+        registro = registroDoElo(historico, registro->anteriorDaCor);
+    }
+
+    return encontrados;
+}
+
+void faseDeHistorico(const Territorio *mapa, size_t tamanho)
+{
+    if (historicoBatalhas == NULL)
+    {
+        printf("\n ⚠️  O histórico de batalhas não está disponível.\n");
+        return;
+    }
+
+    int tipo = 0;
+    printf("\n==== 📚  HISTÓRICO DE CONQUISTAS ====\n");
+    printf("\n 1 - Últimas conquistas de um território | 2 - Territórios perdidos por uma cor: ");
+    if (scanf("%d", &tipo) != 1)
+        tipo = 0;
+    limparBufferEntrada();
+
+    const RegistroBatalha *encontrados[LINHAS_POR_PAGINA];
+    size_t quantidade = 0;
+    int limite = 0;
+
+    if (tipo == 1)
+    {
+        long long id;
+        printf("\n Território [ID ou nome]: ");
+        if (!lerIdOuNome(&id) || id < 1 || (unsigned long long)id > tamanho)
+        {
+            printf("\n ⚠️  Território inválido.\n");
+            return;
+        }
+
+        printf("\n Quantidade de conquistas: ");
+        if (scanf("%d", &limite) != 1 || limite < 1)
+            limite = 1;
+        limparBufferEntrada();
+
+        size_t maximo = (size_t)limite < LINHAS_POR_PAGINA ? (size_t)limite : LINHAS_POR_PAGINA;
+        quantidade = ultimasConquistasDoTerritorio(historicoBatalhas, (size_t)id - 1, maximo, encontrados);
+    }
+    else if (tipo == 2)
+    {
+        char cor[TAM_COR];
+        printf("\n Cor: ");
+        if (fgets(cor, sizeof(cor), stdin) == NULL)
+            return;
+        if (strchr(cor, '\n') == NULL)
+            limparBufferEntrada();
+        limparEnter(cor);
+
+        printf("\n Últimos turnos: ");
+        if (scanf("%d", &limite) != 1 || limite < 1)
+            limite = 1;
+        limparBufferEntrada();
+
+        quantidade = perdasDaCorNosTurnos(historicoBatalhas, cor, limite, LINHAS_POR_PAGINA, encontrados);
+    }
+    else
+    {
+        printf("\n ⚠️  Opção inválida.\n");
+        return;
+    }
+
+    if (quantidade == 0)
+        printf("\n Nenhuma conquista encontrada no histórico recente.\n");
+
+    for (size_t i = 0; i < quantidade; i++)
+    {
+        const RegistroBatalha *r = encontrados[i];
+        printf(" [turno %d] %s (%s) conquistado por %s (%s) | perdas: atacante %d, defensor %d\n", r->turno,
+               mapa[r->defensor].nome, r->corDefensor, mapa[r->atacante].nome, r->corAtacante, r->perdasAtacante, r->perdasDefensor);
+    }
+}
+
+void liberarHistoricoBatalhas(HistoricoBatalhas *historico)
+{
+    if (historico == NULL)
+        return;
+
+    LIBERAR(historico->registros);
+    LIBERAR(historico->ultimaDoTerritorio);
+    LIBERAR(historico->ultimaDaCor);
+    LIBERAR(historico);
+}
+
+// **** Solucionador de fim de jogo (expectimax): ****
+
+/// @brief Chave Zobrist do estado de um território. As chaves são sorteadas sob demanda pelo splitmix64,
+/// pois as tropas não têm limite para uma tabela pré-calculada.
+/// Fora das missões de região, o ID fica de fora e as chaves são somadas: posições que diferem só pela ordem dos
+/// territórios (o mesmo multiconjunto de dono e tropas) são a mesma entrada da tabela.
+uint64_t chaveZobrist(const Solucionador *s, size_t id, uint8_t dono, int tropas)
+{
+    uint64_t territorio = s->porTerritorio ? (uint64_t)(id + 1) << 40 : 0;
+    return misturarSplitMix(territorio ^ ((uint64_t)dono << 32) ^ (uint32_t)tropas);
+}
+
+/// @brief Altera um território da posição, atualizando a chave de forma incremental.
+void definirTerritorioSolucionador(Solucionador *s, size_t id, uint8_t dono, int tropas)
+{
+    s->chave += chaveZobrist(s, id, dono, tropas) - chaveZobrist(s, id, s->dono[id], s->tropas[id]);
+    s->dono[id] = dono;
+    s->tropas[id] = tropas;
+}
+
+/// @brief Verifica a missão na posição do solucionador, com as mesmas regras dos agregados por cor.
+int missaoCumpridaSolucionador(const Solucionador *s)
+{
+    const MissaoJogador *missao = s->missao;
+    size_t atendidos = 0;
+
+    switch (missao->tipo)
+    {
+    case MISSAO_ELIMINAR_COR:
+        for (size_t i = 0; i < s->tamanho; i++)
+            if (s->dono[i] == CLASSE_ALVO && s->tropas[i] > 0)
+                return 0;
+        return 1;
+    case MISSAO_CONQUISTAR:
+    case MISSAO_TROPAS_MINIMAS:
+    case MISSAO_TROPAS_MAXIMAS:
+    case MISSAO_TROPAS_EXATAS:
+        for (size_t i = 0; i < s->tamanho; i++)
+        {
+            int tropas = s->tropas[i], limite = missao->limiteTropas;
+            int condicao = missao->tipo == MISSAO_TROPAS_MAXIMAS ? tropas <= limite
+                           : missao->tipo == MISSAO_TROPAS_EXATAS ? tropas == limite
+                                                                  : tropas >= limite;
+            atendidos += s->dono[i] == CLASSE_JOGADOR && condicao;
+        }
+        return atendidos >= missao->quantidade;
+    case MISSAO_DOMINAR_REGIAO:
+    case MISSAO_DOMINAR_REGIOES:
+    {
+        if (regioes == NULL)
+            return 0;
+
+        // Regiões são disjuntas e não vazias: em até 64 territórios, cabem em uma máscara.
+        uint64_t incompletas = 0;
+        for (size_t i = 0; i < s->tamanho; i++)
+            if (regioes->regiaoDoTerritorio[i] != ID_INEXISTENTE && s->dono[i] != CLASSE_JOGADOR)
+                incompletas |= 1ULL << regioes->regiaoDoTerritorio[i];
+
+        if (missao->tipo == MISSAO_DOMINAR_REGIAO)
+            return missao->regiao < regioes->numRegioes && !(incompletas >> missao->regiao & 1);
+        return regioes->numRegioes - (size_t)__builtin_popcountll(incompletas) >= missao->quantidade;
+    }
+    }
+    return 0;
+}
+
+/// @brief Limite superior da probabilidade de cumprir a missão a partir da posição, qualquer que seja a sequência de ataques.
+/// O jogador nunca perde territórios e o seu total de tropas só diminui, uma tropa por rodada perdida. Então a missão
+/// exige ao menos D vitórias de rodada (as tropas inimigas a conquistar, no caminho mais barato) antes de o jogador
+/// perder mais que L tropas (o que sobra acima do mínimo que a posição final precisa manter). Rodadas são independentes:
+/// a chance de D vitórias antes de L + 1 derrotas limita qualquer estratégia.
+/// @return 0 se a missão ficou inviável, 1 se não há limite útil.
+double limiteSuperiorSolucionador(const Solucionador *s)
+{
+    const MissaoJogador *missao = s->missao;
+    int custos[MAX_TERRITORIOS_SOLUCIONADOR]; // Vitórias de rodada para tomar cada território ou região candidata.
+    size_t numCustos = 0, proprios = 0, atendidos = 0, conquistas = 0;
+    long long tropasJogador = 0, minimoFinal = 0, vitorias = 0;
+    int limite = missao->limiteTropas > 1 ? missao->limiteTropas : 1;
+
+    for (size_t i = 0; i < s->tamanho; i++)
+    {
+        if (s->dono[i] == CLASSE_JOGADOR)
+        {
+            proprios++;
+            tropasJogador += s->tropas[i];
+            atendidos += s->tropas[i] >= limite;
+        }
+        else if (missao->tipo != MISSAO_ELIMINAR_COR || s->dono[i] == CLASSE_ALVO)
+            custos[numCustos++] = s->tropas[i] > 1 ? s->tropas[i] : 1;
+    }
+
+    switch (missao->tipo)
+    {
+    case MISSAO_ELIMINAR_COR:
+        // Todo território do alvo com tropas precisa ser tomado.
+        numCustos = 0;
+        for (size_t i = 0; i < s->tamanho; i++)
+            if (s->dono[i] == CLASSE_ALVO && s->tropas[i] > 0)
+                custos[numCustos++] = s->tropas[i];
+        conquistas = numCustos;
+        break;
+    case MISSAO_CONQUISTAR:
+    case MISSAO_TROPAS_MINIMAS:
+    case MISSAO_TROPAS_EXATAS:
+        // Um território do jogador abaixo do limite nunca sobe: faltantes só vêm de conquistas, cada uma com 'limite' tropas.
+        conquistas = missao->quantidade > atendidos ? missao->quantidade - atendidos : 0;
+        minimoFinal = (long long)missao->quantidade * limite - (long long)missao->quantidade;
+        break;
+    case MISSAO_TROPAS_MAXIMAS:
+        // Territórios do jogador podem descer até o limite perdendo rodadas; faltam só os que ele ainda não tem.
+        conquistas = missao->quantidade > proprios ? missao->quantidade - proprios : 0;
+        break;
+    case MISSAO_DOMINAR_REGIAO:
+    case MISSAO_DOMINAR_REGIOES:
+    {
+        if (regioes == NULL || (missao->tipo == MISSAO_DOMINAR_REGIAO && missao->regiao >= regioes->numRegioes))
+            return 0.0;
+
+        // Custo de cada região: as tropas inimigas nela. Regiões são disjuntas, então os custos se somam.
+        int custoRegiao[MAX_TERRITORIOS_SOLUCIONADOR] = {0};
+        for (size_t i = 0; i < s->tamanho; i++)
+            if (regioes->regiaoDoTerritorio[i] != ID_INEXISTENTE && s->dono[i] != CLASSE_JOGADOR)
+                custoRegiao[regioes->regiaoDoTerritorio[i]] += s->tropas[i] > 1 ? s->tropas[i] : 1;
+
+        numCustos = 0;
+        size_t completas = 0;
+        for (size_t r = 0; r < regioes->numRegioes; r++)
+        {
+            if (missao->tipo == MISSAO_DOMINAR_REGIAO && r != missao->regiao)
+                continue;
+            if (custoRegiao[r] == 0)
+                completas++;
+            else
+                custos[numCustos++] = custoRegiao[r];
+        }
+        conquistas = missao->tipo == MISSAO_DOMINAR_REGIAO ? numCustos : missao->quantidade > completas ? missao->quantidade - completas : 0;
+        break;
+    }
+    default:
+        return 1.0;
+    }
+
+    // As conquistas mais baratas dão o menor número de vitórias possível (seleção parcial, poucos candidatos).
+    if (conquistas > numCustos)
+        return 0.0;
+    for (size_t k = 0; k < conquistas; k++)
+    {
+        size_t menor = k;
+        for (size_t m = k + 1; m < numCustos; m++)
+            if (custos[m] < custos[menor])
+                menor = m;
+        int troca = custos[k];
+        custos[k] = custos[menor];
+        custos[menor] = troca;
+        vitorias += custos[k];
+    }
+
+    // Cada território do jogador, antigo ou conquistado, mantém ao menos uma tropa. Nas missões de região as conquistas
+    // contam regiões, e não territórios: ficam de fora.
+    int porRegiao = missao->tipo == MISSAO_DOMINAR_REGIAO || missao->tipo == MISSAO_DOMINAR_REGIOES;
+    minimoFinal += (long long)(proprios + (porRegiao ? 0 : conquistas));
+    long long perdasPossiveis = tropasJogador - minimoFinal;
+    if (perdasPossiveis < 0)
+        return 0.0;
+    if (vitorias == 0 || perdasPossiveis + 1 >= LIMITE_TABELA_BATALHA)
+        return 1.0;
+    if (vitorias >= LIMITE_TABELA_BATALHA)
+        vitorias = LIMITE_TABELA_BATALHA - 1; // Menos vitórias exigidas: o limite continua válido, só menos justo.
+    return tabelaAlcanceSolucionador[(size_t)(perdasPossiveis + 1) * LIMITE_TABELA_BATALHA + (size_t)vitorias];
+}
+
+/// @brief Lista os ataques da posição, um representante por classe de equivalência: fora das missões de região,
+/// atacantes com as mesmas tropas (e defensores com o mesmo dono e tropas) levam a posições equivalentes.
+/// Na eliminação de cor, só territórios do alvo são atacados: as regras só tiram tropas, e conquistar outro
+/// território apenas divide as tropas do atacante.
+/// Com fronteiras, cada atacante só ataca os vizinhos inimigos. Não há classes de equivalência, e na eliminação
+/// de cor qualquer vizinho inimigo pode ser atacado, pois conquistá-lo pode abrir o caminho até o alvo.
+/// @return Número de ataques escritos em `atacantes` e `defensores`.
+size_t listarAtaquesSolucionador(const Solucionador *s, uint8_t *atacantes, uint8_t *defensores)
+{
+    size_t total = 0;
+    if (s->fronteiras != NULL)
+    {
+        for (size_t a = 0; a < s->tamanho; a++)
+        {
+            if (s->dono[a] != CLASSE_JOGADOR || s->tropas[a] < 2)
+                continue;
+            for (size_t e = s->fronteiras->inicio[a]; e < s->fronteiras->inicio[a + 1]; e++)
+            {
+                size_t d = s->fronteiras->vizinhos[e];
+                if (s->dono[d] == CLASSE_JOGADOR)
+                    continue;
+                atacantes[total] = (uint8_t)a;
+                defensores[total++] = (uint8_t)d;
+            }
+        }
+        return total;
+    }
+
+    uint8_t opcoesAtaque[MAX_TERRITORIOS_SOLUCIONADOR], opcoesDefesa[MAX_TERRITORIOS_SOLUCIONADOR];
+    size_t numAtaque = 0, numDefesa = 0;
+
+    for (size_t i = 0; i < s->tamanho; i++)
+    {
+        int atacante = s->dono[i] == CLASSE_JOGADOR && s->tropas[i] >= 2;
+        int defensor = s->dono[i] != CLASSE_JOGADOR && (s->missao->tipo != MISSAO_ELIMINAR_COR || (s->dono[i] == CLASSE_ALVO && s->tropas[i] > 0));
+        if (!atacante && !defensor)
+            continue;
+
+        uint8_t *opcoes = atacante ? opcoesAtaque : opcoesDefesa;
+        size_t *quantidade = atacante ? &numAtaque : &numDefesa;
+        int repetido = 0;
+        for (size_t k = 0; !s->porTerritorio && k < *quantidade && !repetido; k++)
+            repetido = s->dono[opcoes[k]] == s->dono[i] && s->tropas[opcoes[k]] == s->tropas[i];
+        if (!repetido)
+            opcoes[(*quantidade)++] = (uint8_t)i;
+    }
+
+    for (size_t a = 0; a < numAtaque; a++)
+        for (size_t d = 0; d < numDefesa; d++)
+        {
+            atacantes[total] = opcoesAtaque[a];
+            defensores[total++] = opcoesDefesa[d];
+        }
+    return total;
+}
+
+/// @brief Entrada da tabela com a chave da posição atual, ou NULL.
+EntradaTransposicao *procurarTransposicao(Solucionador *s)
+{
+    EntradaTransposicao *balde = &s->tabela[(s->chave & s->mascaraBaldes) * 2];
+    for (int k = 0; k < 2; k++)
+        if (balde[k].chave == s->chave && balde[k].profundidade >= 0)
+            return &balde[k];
+    return NULL;
+}
+
+/// @brief Grava o resultado da posição atual. Em cada balde, a primeira entrada prefere buscas mais profundas
+/// (ou exatas) e a segunda é sempre substituída; entradas de iterações anteriores cedem lugar primeiro.
+void gravarTransposicao(Solucionador *s, double valor, int profundidade, int exato)
+{
+    EntradaTransposicao *balde = &s->tabela[(s->chave & s->mascaraBaldes) * 2];
+    EntradaTransposicao *destino = &balde[1];
+    if (balde[0].chave == s->chave || balde[0].profundidade < 0 || balde[0].geracao != s->geracao ||
+        (!balde[0].exato && (exato || profundidade >= balde[0].profundidade)))
+        destino = &balde[0];
+    else if (balde[1].chave == s->chave && balde[1].exato && !exato)
+        return; // Nunca troca um valor exato por um limite inferior.
+
+    destino->chave = s->chave;
+    destino->valor = valor;
+    destino->profundidade = (int16_t)(profundidade < INT16_MAX ? profundidade : INT16_MAX);
+    destino->exato = (uint8_t)exato;
+    destino->geracao = s->geracao;
+}
+
+double buscarExpectimax(Solucionador *s, int profundidade, int *exato);
+
+/// @brief Valor esperado de um ataque: média dos dois resultados possíveis da rodada.
+double valorAtaque(Solucionador *s, size_t atacante, size_t defensor, int profundidade, int *exato)
+{
+    uint8_t donoDefensor = s->dono[defensor];
+    int tropasAtacante = s->tropas[atacante], tropasDefensor = s->tropas[defensor];
+    int exatoVitoria, exatoDerrota;
+
+    // O defensor perde uma tropa; zerado, é conquistado com metade das tropas do atacante.
+    if (tropasDefensor - 1 < 1)
+    {
+        int transferidas = tropasAtacante / 2;
+        definirTerritorioSolucionador(s, defensor, CLASSE_JOGADOR, transferidas);
+        definirTerritorioSolucionador(s, atacante, CLASSE_JOGADOR, tropasAtacante - transferidas);
+    }
+    else
+        definirTerritorioSolucionador(s, defensor, donoDefensor, tropasDefensor - 1);
+    double vitoria = buscarExpectimax(s, profundidade, &exatoVitoria);
+    definirTerritorioSolucionador(s, defensor, donoDefensor, tropasDefensor);
+    definirTerritorioSolucionador(s, atacante, CLASSE_JOGADOR, tropasAtacante);
+
+    // O atacante perde uma tropa.
+    definirTerritorioSolucionador(s, atacante, CLASSE_JOGADOR, tropasAtacante - 1);
+    double derrota = buscarExpectimax(s, profundidade, &exatoDerrota);
+    definirTerritorioSolucionador(s, atacante, CLASSE_JOGADOR, tropasAtacante);
+
+    *exato = exatoVitoria && exatoDerrota;
+    return PROBABILIDADE_VITORIA_RODADA * vitoria + (1.0 - PROBABILIDADE_VITORIA_RODADA) * derrota;
+}
+
+double buscarExpectimax(Solucionador *s, int profundidade, int *exato)
+{
+    // O relógio é consultado a cada 1024 posições, que também são o ponto de cessão das tarefas do computador.
+    if ((++s->nos & 1023) == 0 && (relogioNs() > s->prazoNs || cederTarefaIA()))
+        s->esgotado = 1;
+    if (s->esgotado)
+    {
+        *exato = 0;
+        return 0.0;
+    }
+
+    if (missaoCumpridaSolucionador(s))
+    {
+        *exato = 1;
+        return 1.0;
+    }
+
+    EntradaTransposicao *entrada = procurarTransposicao(s);
+    if (entrada != NULL && (entrada->exato || entrada->profundidade >= profundidade))
+    {
+        *exato = entrada->exato;
+        return entrada->valor;
+    }
+
+    // Posições em que a missão ficou inviável valem 0 de forma exata; nas demais, nenhum ataque supera o limite.
+    double limite = limiteSuperiorSolucionador(s);
+    if (limite <= 0.0)
+    {
+        *exato = 1;
+        return 0.0;
+    }
+
+    uint8_t atacantes[MAX_TERRITORIOS_SOLUCIONADOR * MAX_TERRITORIOS_SOLUCIONADOR];
+    uint8_t defensores[MAX_TERRITORIOS_SOLUCIONADOR * MAX_TERRITORIOS_SOLUCIONADOR];
+    size_t numAtaques = listarAtaquesSolucionador(s, atacantes, defensores);
+
+    // Sem ataques possíveis, a posição está resolvida. No limite de profundidade, vale o que já foi garantido: nada.
+    double melhor = 0.0;
+    int todosExatos = 1;
+    if (profundidade == 0)
+        todosExatos = numAtaques == 0;
+
+    for (size_t k = 0; profundidade > 0 && k < numAtaques && melhor < limite; k++)
+    {
+        int exatoFilho;
+        double valor = valorAtaque(s, atacantes[k], defensores[k], profundidade - 1, &exatoFilho);
+        todosExatos &= exatoFilho;
+        if (valor > melhor)
+            melhor = valor;
+    }
+
+    // Alcançado o limite superior, nenhum outro ataque faria melhor.
+    *exato = todosExatos || melhor >= limite;
+    if (s->esgotado)
+    {
+        *exato = 0;
+        return melhor;
+    }
+
+    gravarTransposicao(s, melhor, profundidade, *exato);
+    return melhor;
+}
+
+/// @brief Melhor ataque da posição, avaliado com a tabela já preenchida pela busca.
+/// @return Probabilidade de vitória do ataque escolhido; -1 se não há ataques.
+double melhorAtaqueSolucionador(Solucionador *s, int profundidade, size_t *atacante, size_t *defensor)
+{
+    uint8_t atacantes[MAX_TERRITORIOS_SOLUCIONADOR * MAX_TERRITORIOS_SOLUCIONADOR];
+    uint8_t defensores[MAX_TERRITORIOS_SOLUCIONADOR * MAX_TERRITORIOS_SOLUCIONADOR];
+    size_t numAtaques = listarAtaquesSolucionador(s, atacantes, defensores);
+
+    double melhor = -1.0;
+    for (size_t k = 0; k < numAtaques; k++)
+    {
+        int exato;
+        double valor = valorAtaque(s, atacantes[k], defensores[k], profundidade > 0 ? profundidade - 1 : 0, &exato);
+        if (valor > melhor)
+        {
+            melhor = valor;
+            *atacante = atacantes[k];
+            *defensor = defensores[k];
+        }
+    }
+    return melhor;
+}
+
+int prepararSolucionador(Solucionador *s, const Territorio *mapa, size_t tamanho, const MissaoJogador *missao, size_t baldes, int *tropasTotais)
+{
+    memset(s, 0, sizeof(Solucionador));
+    s->missao = missao;
+    s->tamanho = tamanho;
+    s->fronteiras = vizinhanca != NULL && vizinhanca->numTerritorios == tamanho ? vizinhanca : NULL;
+    s->porTerritorio = missao->tipo == MISSAO_DOMINAR_REGIAO || missao->tipo == MISSAO_DOMINAR_REGIOES || s->fronteiras != NULL;
+
+    int jogador = buscarCor(indiceCores, missao->cor);
+    int alvo = missao->tipo == MISSAO_ELIMINAR_COR ? buscarCor(indiceCores, missao->corAlvo) : -1;
+    if (jogador < 0)
+        return 0;
+
+    // Sem memória para a tabela inteira, o solucionador segue com uma menor.
+    while (baldes >= 1024 && (s->tabela = (EntradaTransposicao *)ALOCAR(MEMORIA_TEMPORARIA, baldes * 2 * sizeof(EntradaTransposicao))) == NULL)
+        baldes /= 2;
+    if (s->tabela == NULL)
+        return -1;
+    s->mascaraBaldes = baldes - 1;
+    for (size_t i = 0; i < baldes * 2; i++)
+        s->tabela[i].profundidade = -1; // Entrada vazia.
+
+    // Mesma recorrência da tabela do conselheiro, em double: o limite superior não pode ficar abaixo do valor real.
+    if (!tabelaAlcancePronta)
+    {
+        const size_t n = LIMITE_TABELA_BATALHA;
+        for (size_t l = 0; l < n; l++)
+            for (size_t d = 0; d < n; d++)
+                tabelaAlcanceSolucionador[l * n + d] = d == 0 ? 1.0 : l == 0 ? 0.0
+                    : PROBABILIDADE_VITORIA_RODADA * tabelaAlcanceSolucionador[l * n + d - 1] +
+                      (1.0 - PROBABILIDADE_VITORIA_RODADA) * tabelaAlcanceSolucionador[(l - 1) * n + d];
+        tabelaAlcancePronta = 1;
+    }
+
+    // Cada ataque consome uma tropa do mapa: o total de tropas limita o comprimento de qualquer partida.
+    *tropasTotais = 0;
+    for (size_t i = 0; i < tamanho; i++)
+    {
+        int cor = indiceCores->corDoTerritorio[i];
+        s->dono[i] = cor == jogador ? CLASSE_JOGADOR : cor == alvo ? CLASSE_ALVO : CLASSE_INIMIGO;
+        s->tropas[i] = mapa[i].tropas;
+        s->chave += chaveZobrist(s, i, s->dono[i], s->tropas[i]);
+        *tropasTotais += mapa[i].tropas > 0 ? mapa[i].tropas : 0;
+    }
+    return 1;
+}
+
+void faseDeSolucionador(const Territorio *mapa, size_t tamanho, const MissaoJogador *missao)
+{
+    printf("\n==== 🧠  SOLUCIONADOR DE FIM DE JOGO ====\n");
+
+    if (tamanho > MAX_TERRITORIOS_SOLUCIONADOR || !indiceCoresDisponivel() || missao == NULL || missao->tipo == 0)
+    {
+        printf("\n ⚠️  O solucionador atende mapas de até %d territórios com missões reconhecidas.\n", MAX_TERRITORIOS_SOLUCIONADOR);
+        return;
+    }
+
+    int limiteMs = 0;
+    printf("\n Tempo limite em milissegundos: ");
+    if (scanf("%d", &limiteMs) != 1 || limiteMs < 1)
+        limiteMs = 200;
+    limparBufferEntrada();
+
+    Solucionador s;
+    int tropasTotais = 0;
+    int preparado = prepararSolucionador(&s, mapa, tamanho, missao, BALDES_TRANSPOSICAO, &tropasTotais);
+    if (preparado < 0)
+        printf("\n ❌  Erro ao alocar memória para o solucionador.\n");
+    if (preparado != 1)
+        return;
+
+    uint64_t inicioNs = relogioNs();
+    s.prazoNs = inicioNs + (uint64_t)limiteMs * 1000000ULL;
+
+    // Aprofundamento iterativo: cada iteração completa dá um limite inferior melhor; a busca exata encerra o laço.
+    double probabilidade = 0.0;
+    int profundidadeConcluida = 0, exato = 0;
+    for (int profundidade = 1; profundidade <= tropasTotais + 1 && profundidade <= PROFUNDIDADE_MAXIMA_SOLUCIONADOR && !exato; profundidade++)
+    {
+        s.geracao++;
+        int exatoIteracao;
+        double valor = buscarExpectimax(&s, profundidade, &exatoIteracao);
+        if (s.esgotado)
+            break;
+
+        probabilidade = valor;
+        profundidadeConcluida = profundidade;
+        exato = exatoIteracao;
+    }
+
+    double decorridoMs = (double)(relogioNs() - inicioNs) / 1e6;
+    printf("\n Missão: %s\n", missao->texto);
+    printf(" Profundidade %d%s | %llu posições | %.1f ms\n", profundidadeConcluida, exato ? " (solução exata)" : " (limite inferior)",
+           (unsigned long long)s.nos, decorridoMs);
+    if (exato)
+        printf(" 🎯  Probabilidade de cumprir a missão: %.2f%%\n", probabilidade * 100.0);
+    else
+        printf(" 🎯  Probabilidade de cumprir a missão: entre %.2f%% e %.2f%%\n", probabilidade * 100.0,
+               limiteSuperiorSolucionador(&s) * 100.0);
+
+    if (missaoCumpridaSolucionador(&s))
+        printf(" A missão já está cumprida.\n");
+    else if (probabilidade <= 0.0)
+        printf(" Nenhuma sequência de ataques cumpre a missão dentro da profundidade explorada.\n");
+    else
+    {
+        // Linha principal: os melhores ataques segundo a tabela, supondo que os dados favoreçam o atacante.
+        // As posições já estão na tabela, então a reconstrução não refaz a busca.
+        s.esgotado = 0;
+        s.prazoNs = UINT64_MAX;
+        printf(" Sequência sugerida (se os dados favorecerem o ataque):\n");
+        for (int passo = 0; passo < 12 && passo < profundidadeConcluida && !missaoCumpridaSolucionador(&s); passo++)
+        {
+            size_t atacante = 0, defensor = 0;
+            if (melhorAtaqueSolucionador(&s, profundidadeConcluida - passo, &atacante, &defensor) <= 0.0)
+                break;
+
+            printf("  %d. [%zu] %s (%d tropas) ataca [%zu] %s (%d tropas)\n", passo + 1, atacante + 1, mapa[atacante].nome,
+                   s.tropas[atacante], defensor + 1, mapa[defensor].nome, s.tropas[defensor]);
+
+            if (s.tropas[defensor] - 1 < 1)
+            {
+                int transferidas = s.tropas[atacante] / 2;
+                definirTerritorioSolucionador(&s, defensor, CLASSE_JOGADOR, transferidas);
+                definirTerritorioSolucionador(&s, atacante, CLASSE_JOGADOR, s.tropas[atacante] - transferidas);
+            }
+            else
+                definirTerritorioSolucionador(&s, defensor, s.dono[defensor], s.tropas[defensor] - 1);
+        }
+    }
+
+    LIBERAR(s.tabela);
+}
+
+// **** Conselheiro de ataques: ****
+
+void prepararTabelaBatalha(void)
+{
+    if (tabelaBatalhaPronta)
+        return;
+
+    // Cada rodada é independente: o defensor perde uma tropa com probabilidade p e o atacante com q = 1 - p.
+    // Com l perdas permitidas e d tropas defensoras, a batalha segue para (l, d - 1) ou para (l - 1, d).
+    const float p = (float)PROBABILIDADE_VITORIA_RODADA, q = 1.0f - p;
+    const size_t n = LIMITE_TABELA_BATALHA;
+
+    for (size_t l = 0; l < n; l++)
+        for (size_t d = 0; d < n; d++)
+        {
+            size_t c = l * n + d;
+            if (d == 0 || l == 0)
+            {
+                // Defensor já conquistado, ou atacante sem perdas permitidas: a batalha acabou.
+                tabelaConquista[c] = d == 0 ? 1.0f : 0.0f;
+                tabelaPerdasAtacante[c] = 0.0f;
+                tabelaPerdasDefensor[c] = 0.0f;
+                continue;
+            }
+            tabelaConquista[c] = p * tabelaConquista[c - 1] + q * tabelaConquista[c - n];
+            tabelaPerdasAtacante[c] = p * tabelaPerdasAtacante[c - 1] + q * (1.0f + tabelaPerdasAtacante[c - n]);
+            tabelaPerdasDefensor[c] = p * (1.0f + tabelaPerdasDefensor[c - 1]) + q * tabelaPerdasDefensor[c - n];
+        }
+
+    tabelaBatalhaPronta = 1;
+}
+
+uint32_t celulaBatalha(int tropasAtacante, int tropasDefensor, float *escala)
+{
+    int perdas = tropasAtacante - 1;
+    int defesa = tropasDefensor > 0 ? tropasDefensor : 1;
+
+    *escala = 1.0f;
+    if (defesa >= LIMITE_TABELA_BATALHA)
+    {
+        // Aproximação: a batalha é reduzida mantendo a razão de forças.
+        *escala = (float)defesa / (LIMITE_TABELA_BATALHA - 1);
+        perdas = (int)((float)perdas / *escala + 0.5f);
+        defesa = LIMITE_TABELA_BATALHA - 1;
+        if (perdas < 1)
+            perdas = 1;
+    }
+
+    // Contra menos de LIMITE_TABELA_BATALHA defensores, quase nunca a batalha consome tantas perdas do atacante:
+    // as perdas permitidas além da tabela não mudam o desfecho de forma perceptível.
+    if (perdas >= LIMITE_TABELA_BATALHA)
+        perdas = LIMITE_TABELA_BATALHA - 1;
+
+    return (uint32_t)perdas * LIMITE_TABELA_BATALHA + (uint32_t)defesa;
+}
+
+int atendeLimiteMissao(const MissaoJogador *missao, int tropas)
+{
+    if (missao->tipo == MISSAO_TROPAS_MAXIMAS)
+        return tropas <= missao->limiteTropas;
+    if (missao->tipo == MISSAO_TROPAS_EXATAS)
+        return tropas == missao->limiteTropas;
+    return tropas >= missao->limiteTropas;
+}
+
+float relevanciaAtaque(Conselheiro *conselheiro, size_t atacante, size_t defensor, uint32_t celula, float escala)
+{
+    const MissaoJogador *missao = conselheiro->missao;
+
+    switch (missao->tipo)
+    {
+    case MISSAO_ELIMINAR_COR:
+        return indiceCores->corDoTerritorio[defensor] == conselheiro->alvo ? 1.0f : 0.0f;
+    case MISSAO_CONQUISTAR:
+    case MISSAO_TROPAS_MINIMAS:
+    case MISSAO_TROPAS_MAXIMAS:
+    case MISSAO_TROPAS_EXATAS:
+    {
+        // Territórios do jogador que atendem ao limite antes e depois da conquista, com as perdas esperadas:
+        // metade das tropas restantes vai para o território conquistado, como em aplicarConquista().
+        int tropas = conselheiro->mapa[atacante].tropas;
+        int restantes = tropas - (int)(tabelaPerdasAtacante[celula] * escala + 0.5f);
+        int transferidas = restantes / 2;
+        return (float)(atendeLimiteMissao(missao, restantes - transferidas) + atendeLimiteMissao(missao, transferidas) -
+                       atendeLimiteMissao(missao, tropas));
+    }
+    case MISSAO_DOMINAR_REGIAO:
+        return regioes != NULL && regioes->regiaoDoTerritorio[defensor] == missao->regiao ? 1.0f : 0.0f;
+    case MISSAO_DOMINAR_REGIOES:
+    {
+        if (conselheiro->faltantesRegiao == NULL)
+            return 0.0f;
+
+        size_t regiao = regioes->regiaoDoTerritorio[defensor];
+        if (regiao == ID_INEXISTENTE)
+            return 0.0f;
+
+        // Contagem feita uma vez por região: membros fora do bitset de posse do jogador.
+        if (conselheiro->faltantesRegiao[regiao] == ID_INEXISTENTE)
+        {
+            const uint64_t *posse = regioes->posse[conselheiro->jogador];
+            size_t possuidos = 0;
+            for (size_t e = regioes->inicio[regiao]; e < regioes->inicio[regiao + 1]; e++)
+                possuidos += (size_t)__builtin_popcountll(regioes->mascaras[e] & posse[regioes->palavras[e]]);
+            conselheiro->faltantesRegiao[regiao] = regioes->numMembros[regiao] - possuidos;
+        }
+
+        // O defensor é inimigo, então falta ao menos ele: quanto menos faltar, mais perto do domínio.
+        return 1.0f / (float)conselheiro->faltantesRegiao[regiao];
+    }
+    }
+    return 0.0f;
+}
+
+void adicionarParAtaque(Conselheiro *conselheiro, size_t atacante, size_t defensor)
+{
+    LoteAtaques *lote = conselheiro->lote;
+    size_t i = lote->quantidade++;
+
+    lote->atacante[i] = atacante;
+    lote->defensor[i] = defensor;
+    lote->celula[i] = celulaBatalha(conselheiro->mapa[atacante].tropas, conselheiro->mapa[defensor].tropas, &lote->escala[i]);
+    lote->tropasAtacante[i] = (float)conselheiro->mapa[atacante].tropas;
+    lote->relevancia[i] = conselheiro->missao->tipo != 0
+                              ? relevanciaAtaque(conselheiro, atacante, defensor, lote->celula[i], lote->escala[i])
+                              : 0.0f;
+
+    if (lote->quantidade == LOTE_CONSELHEIRO)
+    {
+        recolherLoteAtaques(conselheiro);
+        conselheiro->interrompido = cederTarefaIA();
+    }
+}
+
+void pontuarLoteAtaques(LoteAtaques *lote)
+{
+    size_t n = lote->quantidade;
+
+    // Consulta às tabelas separada da aritmética: o segundo laço não tem acessos indiretos e é vetorizado.
+    for (size_t i = 0; i < n; i++)
+    {
+        lote->probabilidade[i] = tabelaConquista[lote->celula[i]];
+        lote->perdasAtacante[i] = tabelaPerdasAtacante[lote->celula[i]];
+        lote->perdasDefensor[i] = tabelaPerdasDefensor[lote->celula[i]];
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        lote->perdasAtacante[i] *= lote->escala[i];
+        lote->perdasDefensor[i] *= lote->escala[i];
+        lote->pontuacao[i] = lote->probabilidade[i] * (1.0f + PESO_MISSAO_CONSELHEIRO * lote->relevancia[i]) -
+                             PESO_PERDAS_CONSELHEIRO * lote->perdasAtacante[i] / lote->tropasAtacante[i];
+    }
+}
+
+void recolherLoteAtaques(Conselheiro *conselheiro)
+{
+    LoteAtaques *lote = conselheiro->lote;
+    pontuarLoteAtaques(lote);
+
+    for (size_t i = 0; i < lote->quantidade; i++)
+    {
+        float pontuacao = lote->pontuacao[i];
+        if (conselheiro->numMelhores == conselheiro->maximo &&
+            pontuacao <= conselheiro->melhores[conselheiro->numMelhores - 1].pontuacao)
+            continue;
+
+        // Inserção ordenada: a lista de melhores é curta, e quase todos os pares param no teste acima.
+        size_t posicao = conselheiro->numMelhores < conselheiro->maximo ? conselheiro->numMelhores++ : conselheiro->numMelhores - 1;
+        while (posicao > 0 && conselheiro->melhores[posicao - 1].pontuacao < pontuacao)
+        {
+            conselheiro->melhores[posicao] = conselheiro->melhores[posicao - 1];
+            posicao--;
+        }
+
+        SugestaoAtaque *sugestao = &conselheiro->melhores[posicao];
+        sugestao->atacante = lote->atacante[i];
+        sugestao->defensor = lote->defensor[i];
+        sugestao->probabilidade = lote->probabilidade[i];
+        sugestao->perdasAtacante = lote->perdasAtacante[i];
+        sugestao->perdasDefensor = lote->perdasDefensor[i];
+        sugestao->relevancia = lote->relevancia[i];
+        sugestao->pontuacao = pontuacao;
+    }
+
+    conselheiro->avaliados += lote->quantidade;
+    lote->quantidade = 0;
+}
+
+void inserirSelecao(size_t *ids, int *chaves, size_t *quantidade, size_t maximo, size_t id, int chave)
+{
+    if (*quantidade == maximo && chave >= chaves[maximo - 1])
+        return;
+
+    size_t posicao = *quantidade < maximo ? (*quantidade)++ : maximo - 1;
+    while (posicao > 0 && chaves[posicao - 1] > chave)
+    {
+        ids[posicao] = ids[posicao - 1];
+        chaves[posicao] = chaves[posicao - 1];
+        posicao--;
+    }
+    ids[posicao] = id;
+    chaves[posicao] = chave;
+}
+
+int aconselharAtaques(const Territorio *mapa, size_t tamanho, const MissaoJogador *missao, size_t maximo,
+                      SugestaoAtaque *sugestoes, size_t *encontradas, size_t *avaliados)
+{
+    *encontradas = 0;
+    *avaliados = 0;
+    if (!indiceCoresDisponivel() || missao == NULL || maximo == 0)
+        return 0;
+
+    int jogador = buscarCor(indiceCores, missao->cor);
+    if (jogador < 0)
+        return 1; // O jogador não tem territórios: nenhum ataque possível.
+
+    Conselheiro conselheiro;
+    memset(&conselheiro, 0, sizeof(Conselheiro));
+    conselheiro.mapa = mapa;
+    conselheiro.missao = missao;
+    conselheiro.jogador = jogador;
+    conselheiro.alvo = missao->tipo == MISSAO_ELIMINAR_COR ? buscarCor(indiceCores, missao->corAlvo) : -1;
+    conselheiro.melhores = sugestoes;
+    conselheiro.maximo = maximo;
+    conselheiro.lote = (LoteAtaques *)ALOCAR(MEMORIA_TEMPORARIA, sizeof(LoteAtaques));
+    if (conselheiro.lote == NULL)
+        return 0;
+    conselheiro.lote->quantidade = 0;
+
+    if (missao->tipo == MISSAO_DOMINAR_REGIOES && regioes != NULL && regioes->posseValida &&
+        (size_t)jogador < regioes->numCoresPosse && regioes->numRegioes > 0)
+    {
+        conselheiro.faltantesRegiao = (size_t *)ALOCAR(MEMORIA_TEMPORARIA, regioes->numRegioes * sizeof(size_t));
+        if (conselheiro.faltantesRegiao != NULL)
+            for (size_t r = 0; r < regioes->numRegioes; r++)
+                conselheiro.faltantesRegiao[r] = ID_INEXISTENTE; // Ainda não contada.
+    }
+
+    prepararTabelaBatalha();
+
+    const size_t *membros = indiceCores->membros[jogador];
+    size_t possuidos = indiceCores->quantidade[jogador];
+    const int *corDoTerritorio = indiceCores->corDoTerritorio;
+
+    if (vizinhanca != NULL && vizinhanca->numTerritorios == tamanho)
+    {
+        // Com vizinhança, todos os pares legais: O(territórios do jogador + vizinhos deles).
+        for (size_t m = 0; m < possuidos && !conselheiro.interrompido; m++)
+        {
+            size_t atacante = membros[m];
+            if (mapa[atacante].tropas < 2)
+                continue;
+            for (size_t e = vizinhanca->inicio[atacante]; e < vizinhanca->inicio[atacante + 1]; e++)
+                if (corDoTerritorio[vizinhanca->vizinhos[e]] != jogador)
+                    adicionarParAtaque(&conselheiro, atacante, vizinhanca->vizinhos[e]);
+        }
+    }
+    else
+    {
+        // Sem vizinhança, qualquer território inimigo é alvo e os pares crescem com o produto dos dois lados.
+        // A nota cresce com as tropas do atacante e cai com as do defensor, então bastam os atacantes mais fortes
+        // contra os defensores mais fracos, além dos mais fracos entre os alvos da missão.
+        size_t atacantes[CANDIDATOS_SEM_VIZINHANCA], defensores[2 * CANDIDATOS_SEM_VIZINHANCA];
+        int chavesAtacantes[CANDIDATOS_SEM_VIZINHANCA], chavesDefensores[2 * CANDIDATOS_SEM_VIZINHANCA];
+        size_t numAtacantes = 0, numDefensores = 0, numAlvos = 0;
+
+        for (size_t m = 0; m < possuidos; m++)
+            if (mapa[membros[m]].tropas >= 2)
+                inserirSelecao(atacantes, chavesAtacantes, &numAtacantes, CANDIDATOS_SEM_VIZINHANCA, membros[m],
+                               -mapa[membros[m]].tropas);
+
+        // Alvos da missão: a cor a eliminar ou os membros inimigos da região almejada.
+        size_t *alvos = defensores + CANDIDATOS_SEM_VIZINHANCA;
+        int *chavesAlvos = chavesDefensores + CANDIDATOS_SEM_VIZINHANCA;
+        if (conselheiro.alvo >= 0 && conselheiro.alvo != jogador)
+        {
+            const size_t *membrosAlvo = indiceCores->membros[conselheiro.alvo];
+            for (size_t m = 0; m < indiceCores->quantidade[conselheiro.alvo]; m++)
+                inserirSelecao(alvos, chavesAlvos, &numAlvos, CANDIDATOS_SEM_VIZINHANCA, membrosAlvo[m],
+                               mapa[membrosAlvo[m]].tropas);
+        }
+        else if (missao->tipo == MISSAO_DOMINAR_REGIAO && regioes != NULL && missao->regiao < regioes->numRegioes)
+        {
+            for (size_t e = regioes->inicio[missao->regiao]; e < regioes->inicio[missao->regiao + 1]; e++)
+                for (uint64_t mascara = regioes->mascaras[e]; mascara != 0; mascara &= mascara - 1)
+                {
+                    size_t id = regioes->palavras[e] * 64 + (size_t)__builtin_ctzll(mascara);
+                    if (corDoTerritorio[id] != jogador)
+                        inserirSelecao(alvos, chavesAlvos, &numAlvos, CANDIDATOS_SEM_VIZINHANCA, id, mapa[id].tropas);
+                }
+        }
+
+        // Inimigos mais fracos: baldes do índice de tropas em ordem crescente, até o próximo balde não poder melhorar a seleção.
+        if (indiceTropas != NULL)
+        {
+            int completo = 0;
+            for (size_t w = 0; w < BALDES_TROPAS / 64 && !completo; w++)
+                for (uint64_t bits = indiceTropas->ocupados[w]; bits != 0 && !completo; bits &= bits - 1)
+                {
+                    size_t balde = w * 64 + (size_t)__builtin_ctzll(bits);
+                    if (numDefensores == CANDIDATOS_SEM_VIZINHANCA && balde < BALDES_TROPAS - 1 &&
+                        (int)balde > chavesDefensores[numDefensores - 1])
+                    {
+                        completo = 1;
+                        break;
+                    }
+                    for (size_t id = indiceTropas->cabeca[balde]; id != ID_INEXISTENTE; id = indiceTropas->proximo[id])
+                        if (corDoTerritorio[id] != jogador)
+                            inserirSelecao(defensores, chavesDefensores, &numDefensores, CANDIDATOS_SEM_VIZINHANCA, id,
+                                           mapa[id].tropas);
+                }
+        }
+
+        // Os alvos da missão que já estão entre os mais fracos não são pontuados duas vezes.
+        size_t totalDefensores = numDefensores;
+        for (size_t a = 0; a < numAlvos; a++)
+        {
+            int repetido = 0;
+            for (size_t d = 0; d < numDefensores && !repetido; d++)
+                repetido = defensores[d] == alvos[a];
+            if (!repetido)
+                defensores[totalDefensores++] = alvos[a];
+        }
+
+        for (size_t a = 0; a < numAtacantes && !conselheiro.interrompido; a++)
+            for (size_t d = 0; d < totalDefensores; d++)
+                adicionarParAtaque(&conselheiro, atacantes[a], defensores[d]);
+    }
+
+    recolherLoteAtaques(&conselheiro);
+
+    *encontradas = conselheiro.numMelhores;
+    *avaliados = conselheiro.avaliados;
+    LIBERAR(conselheiro.faltantesRegiao);
+    LIBERAR(conselheiro.lote);
+    return 1;
+}
+
+void faseDeConselheiro(const Territorio *mapa, size_t tamanho, const MissaoJogador *missao)
+{
+    RASTREAR_ESCOPO("faseDeConselheiro");
+
+    printf("\n==== 🧭  CONSELHEIRO DE ATAQUES ====\n");
+
+    int limite = 0;
+    printf("\n Quantidade de sugestões: ");
+    if (scanf("%d", &limite) != 1 || limite < 1)
+        limite = 5;
+    limparBufferEntrada();
+    if (limite > LINHAS_POR_PAGINA)
+        limite = LINHAS_POR_PAGINA;
+
+    SugestaoAtaque sugestoes[LINHAS_POR_PAGINA];
+    size_t encontradas = 0, avaliados = 0;
+    uint64_t inicioNs = relogioNs();
+
+    if (!aconselharAtaques(mapa, tamanho, missao, (size_t)limite, sugestoes, &encontradas, &avaliados))
+    {
+        printf("\n ⚠️  O conselheiro não está disponível (índices ou memória insuficientes).\n");
+        return;
+    }
+
+    printf("\n %zu ataques avaliados em %.3f ms%s.\n", avaliados, (double)(relogioNs() - inicioNs) / 1e6,
+           vizinhanca != NULL ? "" : " (sem vizinhança: mais fortes contra mais fracos)");
+
+    if (encontradas == 0)
+        printf("\n Nenhum ataque possível: é preciso um território com ao menos 2 tropas ao lado de um inimigo.\n");
+
+    for (size_t i = 0; i < encontradas; i++)
+    {
+        const SugestaoAtaque *sugestao = &sugestoes[i];
+        printf(" %2zu. [%zu] %s (%d) -> [%zu] %s (%s, %d) | Conquista: %5.1f%% | Perdas esperadas: %.1f x %.1f | Missão: %+.2f\n",
+               i + 1, sugestao->atacante + 1, mapa[sugestao->atacante].nome, mapa[sugestao->atacante].tropas,
+               sugestao->defensor + 1, mapa[sugestao->defensor].nome, mapa[sugestao->defensor].cor,
+               mapa[sugestao->defensor].tropas, sugestao->probabilidade * 100.0f, sugestao->perdasAtacante,
+               sugestao->perdasDefensor, sugestao->relevancia);
+    }
+}
+
+// **** Fase de fortificação: ****
+
+BuscaCaminhos *criarBuscaCaminhos(size_t tamanho)
+{
+    BuscaCaminhos *busca = (BuscaCaminhos *)ALOCAR(MEMORIA_INDICES, sizeof(BuscaCaminhos));
+    if (busca == NULL)
+        return NULL;
+
+    busca->tamanho = tamanho;
+    busca->geracao = 0;
+    busca->visitado = (uint32_t *)ALOCAR_ZERADO(MEMORIA_INDICES, tamanho, sizeof(uint32_t));
+    busca->anterior = (size_t *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(size_t));
+    busca->fila = (size_t *)ALOCAR(MEMORIA_INDICES, tamanho * sizeof(size_t));
+    if (busca->visitado == NULL || busca->anterior == NULL || busca->fila == NULL)
+    {
+        liberarBuscaCaminhos(busca);
+        return NULL;
+    }
+    return busca;
+}
+
+int buscarCaminhoAliado(BuscaCaminhos *busca, const Territorio *mapa, size_t origem, size_t destino)
+{
+    // Uma nova geração invalida todas as marcas anteriores; só na volta do contador o vetor é zerado.
+    if (++busca->geracao == 0)
+    {
+        memset(busca->visitado, 0, busca->tamanho * sizeof(uint32_t));
+        busca->geracao = 1;
+    }
+    uint32_t geracao = busca->geracao;
+
+    busca->visitado[origem] = geracao;
+    busca->anterior[origem] = ID_INEXISTENTE;
+
+    // Sem vizinhança, todos os territórios de uma cor estão ligados entre si.
+    if (vizinhanca == NULL || vizinhanca->numTerritorios != busca->tamanho)
+    {
+        if (strcmp(mapa[origem].cor, mapa[destino].cor) != 0)
+            return 0;
+        busca->visitado[destino] = geracao;
+        busca->anterior[destino] = origem;
+        return 1;
+    }
+
+    int usaIndice = indiceCoresDisponivel();
+    int corOrigem = usaIndice ? indiceCores->corDoTerritorio[origem] : -1;
+    size_t cabeca = 0, cauda = 0;
+    busca->fila[cauda++] = origem;
+
+    // Busca em largura só por territórios da mesma cor; cada território entra na fila no máximo uma vez.
+    while (cabeca < cauda)
+    {
+        size_t atual = busca->fila[cabeca++];
+        for (size_t e = vizinhanca->inicio[atual]; e < vizinhanca->inicio[atual + 1]; e++)
+        {
+            size_t vizinho = vizinhanca->vizinhos[e];
+            if (busca->visitado[vizinho] == geracao)
+                continue;
+            if (usaIndice ? indiceCores->corDoTerritorio[vizinho] != corOrigem : strcmp(mapa[vizinho].cor, mapa[origem].cor) != 0)
+                continue;
+
+            busca->visitado[vizinho] = geracao;
+            busca->anterior[vizinho] = atual;
+            if (vizinho == destino)
+                return 1;
+            busca->fila[cauda++] = vizinho;
+        }
+    }
+
+    return 0;
+}
+
+size_t reconstruirCaminho(BuscaCaminhos *busca, size_t destino, const size_t **caminho)
+{
+    // A fila da busca já terminou: ela guarda o caminho, do destino à origem, e depois é invertida.
+    size_t comprimento = 0;
+    for (size_t id = destino; id != ID_INEXISTENTE; id = busca->anterior[id])
+        busca->fila[comprimento++] = id;
+
+    for (size_t i = 0, j = comprimento - 1; i < j; i++, j--)
+    {
+        size_t troca = busca->fila[i];
+        busca->fila[i] = busca->fila[j];
+        busca->fila[j] = troca;
+    }
+
+    *caminho = busca->fila;
+    return comprimento;
+}
+
+ResultadoMovimento moverTropas(Territorio *mapa, size_t tamanho, size_t origem, size_t destino, int quantidade)
+{
+    if (origem >= tamanho || destino >= tamanho || origem == destino || quantidade < 1)
+        return MOVIMENTO_INVALIDO;
+
+    if (strcmp(mapa[origem].cor, mapa[destino].cor) != 0)
+        return MOVIMENTO_CORES_DIFERENTES;
+
+    // Assim como no ataque, ao menos uma tropa fica guardando o território de origem.
+    if (mapa[origem].tropas - quantidade < 1)
+        return MOVIMENTO_TROPAS_INSUFICIENTES;
+
+    // A soma no destino não pode estourar o int.
+    if (mapa[destino].tropas > INT_MAX - quantidade)
+        return MOVIMENTO_DESTINO_CHEIO;
+
+    if (buscaCaminhos == NULL || buscaCaminhos->tamanho != tamanho)
+    {
+        liberarBuscaCaminhos(buscaCaminhos);
+        buscaCaminhos = criarBuscaCaminhos(tamanho);
+        if (buscaCaminhos == NULL)
+            return MOVIMENTO_INVALIDO;
+    }
+
+    if (!buscarCaminhoAliado(buscaCaminhos, mapa, origem, destino))
+        return MOVIMENTO_SEM_CAMINHO;
+
+    registrarPontoDesfazer(historicoMapa);
+    marcarTerritorioAlterado(&mapa[origem]);
+    marcarTerritorioAlterado(&mapa[destino]);
+
+    mapa[origem].tropas -= quantidade;
+    mapa[destino].tropas += quantidade;
+
+    atualizarIndicesTerritorio(&mapa[origem]);
+    atualizarIndicesTerritorio(&mapa[destino]);
+    return MOVIMENTO_OK;
+}
+
+void faseDeFortificacao(Territorio *mapa, size_t tamanho)
+{
+    RASTREAR_ESCOPO("faseDeFortificacao");
+
+    long long origem = 0, destino = 0;
+    int quantidade = 0;
+
+    printf("\n==== 🏰  FORTIFICAR ====\n");
+
+    printf("\n 🚩  Território de origem [ID ou nome] de %d a %zu, ou 0 para sair: ", 1, tamanho);
+    int origemEncontrada = lerIdOuNome(&origem);
+
+    printf("\n 🎯  Território de destino [ID ou nome] de %d a %zu, ou 0 para sair: ", 1, tamanho);
+    int destinoEncontrado = lerIdOuNome(&destino);
+
+    if (!origemEncontrada || !destinoEncontrado)
+    {
+        printf("\n ⚠️  Território não encontrado. Tente novamente.\n");
+        return;
+    }
+    if (origem < 1 || destino < 1)
+    {
+        printf("\n ❌  A ação foi cancelada.\n");
+        return;
+    }
+    if ((unsigned long long)origem > tamanho || (unsigned long long)destino > tamanho)
+    {
+        printf("\n ⚠️  IDs inválidos. Tente novamente.\n");
+        return;
+    }
+
+    printf("\n 🪖  Tropas a mover: ");
+    if (scanf("%d", &quantidade) != 1)
+        quantidade = 0;
+    limparBufferEntrada();
+
+    size_t idOrigem = (size_t)origem - 1, idDestino = (size_t)destino - 1;
+    ResultadoMovimento resultado = moverTropas(mapa, tamanho, idOrigem, idDestino, quantidade);
+
+    switch (resultado)
+    {
+    case MOVIMENTO_OK:
+        break;
+    case MOVIMENTO_CORES_DIFERENTES:
+        printf("\n ⚠️  Tropas só se movem entre territórios da mesma cor.\n");
+        return;
+    case MOVIMENTO_TROPAS_INSUFICIENTES:
+        printf("\n ⚠️  O território de origem precisa manter ao menos 1 tropa.\n");
+        return;
+    case MOVIMENTO_SEM_CAMINHO:
+        printf("\n ⚠️  Não há caminho entre os territórios passando apenas por territórios aliados.\n");
+        return;
+    case MOVIMENTO_DESTINO_CHEIO:
+        printf("\n ⚠️  O território de destino não comporta tantas tropas.\n");
+        return;
+    case MOVIMENTO_INVALIDO:
+        printf("\n ⚠️  Movimento inválido.\n");
+        return;
+    }
+
+    const size_t *caminho;
+    size_t comprimento = reconstruirCaminho(buscaCaminhos, idDestino, &caminho);
+
+    printf("\n ✅  %d tropa(s) movida(s) de %s para %s.\n", quantidade, mapa[idOrigem].nome, mapa[idDestino].nome);
+    printf(" Caminho (%zu territórios):", comprimento);
+    for (size_t i = 0; i < comprimento && i < LINHAS_POR_PAGINA; i++)
+        printf("%s %s", i == 0 ? "" : " ->", mapa[caminho[i]].nome);
+    printf("%s\n", comprimento > LINHAS_POR_PAGINA ? " -> ..." : "");
+}
+
+void liberarBuscaCaminhos(BuscaCaminhos *busca)
+{
+    if (busca == NULL)
+        return;
+    LIBERAR(busca->visitado);
+    LIBERAR(busca->anterior);
+    LIBERAR(busca->fila);
+    LIBERAR(busca);
+}
+
+// **** Jogadores controlados pelo computador (escalonador cooperativo): ****
+
+int cederTarefaIA(void)
+{
+    TarefaIA *tarefa = tarefaIAAtual;
+    if (tarefa == NULL)
+        return 0;
+
+    // Fatia esgotada: a busca para aqui, com toda a sua pilha, e o escalonador retoma a próxima tarefa.
+    if (!tarefa->cancelada && relogioNs() >= tarefa->fimFatiaNs)
+        swapcontext(&tarefa->contexto, &contextoEscalonador);
+    return tarefa->cancelada;
+}
+
+void registrarJogadaIA(TarefaIA *tarefa, size_t atacante, size_t defensor, ModoOrdem modo, const char *origem, int profundidade)
+{
+    tarefa->temJogada = 1;
+    tarefa->atacante = atacante;
+    tarefa->defensor = defensor;
+    tarefa->modo = modo;
+    tarefa->origem = origem;
+    tarefa->profundidade = profundidade;
+}
+
+void executarTarefaIA(void)
+{
+    TarefaIA *tarefa = tarefaIAAtual;
+
+    // Primeiro uma jogada rápida, em qualquer tamanho de mapa: o melhor ataque do conselheiro, jogado até o fim.
+    SugestaoAtaque sugestao;
+    size_t encontradas = 0, avaliados = 0;
+    if (aconselharAtaques(tarefa->mapa, tarefa->tamanho, tarefa->missao, 1, &sugestao, &encontradas, &avaliados) && encontradas == 1)
+        registrarJogadaIA(tarefa, sugestao.atacante, sugestao.defensor, ORDEM_BLITZ_SIMULADO, "conselheiro", 0);
+
+    // Em mapas pequenos, o solucionador refina a jogada: cada profundidade concluída substitui a anterior.
+    Solucionador s;
+    int tropasTotais = 0;
+    if (!tarefa->cancelada && tarefa->tamanho <= MAX_TERRITORIOS_SOLUCIONADOR && tarefa->missao->tipo != 0 &&
+        prepararSolucionador(&s, tarefa->mapa, tarefa->tamanho, tarefa->missao, BALDES_TRANSPOSICAO_IA, &tropasTotais) == 1)
+    {
+        s.prazoNs = UINT64_MAX; // O prazo é o orçamento da tarefa, controlado pelo escalonador.
+        for (int profundidade = 1; profundidade <= tropasTotais + 1 && profundidade <= PROFUNDIDADE_MAXIMA_SOLUCIONADOR; profundidade++)
+        {
+            s.geracao++;
+            int exato;
+            double valor = buscarExpectimax(&s, profundidade, &exato);
+            if (s.esgotado)
+                break;
+            if (valor <= 0.0)
+                continue; // Nenhuma sequência tão curta cumpre a missão: a jogada do conselheiro continua valendo.
+
+            size_t atacante = 0, defensor = 0;
+            if (melhorAtaqueSolucionador(&s, profundidade, &atacante, &defensor) <= 0.0 || s.esgotado)
+                break;
+            registrarJogadaIA(tarefa, atacante, defensor, ORDEM_RODADA_UNICA, "solucionador", profundidade);
+            if (exato)
+                break;
+        }
+        LIBERAR(s.tabela);
+    }
+
+    // Ao retornar, uc_link devolve o controle ao escalonador.
+    tarefa->terminada = 1;
+}
+
+int entradaPendente(void)
+{
+    // Só um terminal interativo apressa as tarefas; entradas redirecionadas estão sempre prontas para leitura.
+    if (!isatty(STDIN_FILENO))
+        return 0;
+
+    struct pollfd entrada = {.fd = STDIN_FILENO, .events = POLLIN};
+    return poll(&entrada, 1, 0) > 0;
+}
+
+int prepararTarefaIA(TarefaIA *tarefa, void *pilha)
+{
+    if (getcontext(&tarefa->contexto) != 0)
+        return 0;
+
+    tarefa->pilha = pilha;
+    tarefa->contexto.uc_stack.ss_sp = pilha;
+    tarefa->contexto.uc_stack.ss_size = PILHA_TAREFA_IA;
+    tarefa->contexto.uc_link = &contextoEscalonador;
+    makecontext(&tarefa->contexto, executarTarefaIA, 0);
+    return 1;
+}
+
+void turnoDasIAs(Territorio *mapa, size_t tamanho, const char *corTerminal)
+{
+    RASTREAR_ESCOPO("turnoDasIAs");
+
+    if (missoesJogadores == NULL || numJogadores < 2 || !indiceCoresDisponivel())
+        return;
+
+    TarefaIA *tarefas = (TarefaIA *)ALOCAR_ZERADO(MEMORIA_TEMPORARIA, numJogadores, sizeof(TarefaIA));
+    if (tarefas == NULL)
+    {
+        printf("\n ❌  Erro ao alocar memória para o turno do computador. Os jogadores do computador passam a vez.\n");
+        return;
+    }
+
+    // Uma tarefa por cor do computador que ainda tem territórios.
+    size_t numTarefas = 0;
+    for (size_t j = 0; j < numJogadores; j++)
+    {
+        const MissaoJogador *missao = &missoesJogadores[j];
+        int cor = buscarCor(indiceCores, missao->cor);
+        if (strcmp(missao->cor, corTerminal) == 0 || cor < 0 || indiceCores->quantidade[cor] == 0)
+            continue;
+
+        TarefaIA *tarefa = &tarefas[numTarefas++];
+        tarefa->missao = missao;
+        tarefa->mapa = mapa;
+        tarefa->tamanho = tamanho;
+    }
+
+    // Poucas pilhas, reaproveitadas de onda em onda: o custo de memória não cresce com o número de cores.
+    void *pilhas[TAREFAS_IA_SIMULTANEAS];
+    size_t numPilhas = 0;
+    while (numPilhas < TAREFAS_IA_SIMULTANEAS && numPilhas < numTarefas)
+    {
+        pilhas[numPilhas] = ALOCAR(MEMORIA_TEMPORARIA, PILHA_TAREFA_IA);
+        if (pilhas[numPilhas] == NULL)
+            break;
+        numPilhas++;
+    }
+
+    // O turno inteiro tem um teto: com muitas cores, o orçamento de cada uma encolhe até uma fatia.
+    uint64_t orcamentoNs = (uint64_t)orcamentoIAMs * 1000000ULL;
+    uint64_t limiteTurnoNs = (uint64_t)LIMITE_TURNO_IA_MS * 1000000ULL;
+    if (numTarefas > 0 && orcamentoNs > limiteTurnoNs / numTarefas)
+        orcamentoNs = limiteTurnoNs / numTarefas > FATIA_IA_NS ? limiteTurnoNs / numTarefas : FATIA_IA_NS;
+    uint64_t prazoTurnoNs = relogioNs() + limiteTurnoNs;
+
+    // Rodízio de fatias em uma única thread, uma onda por vez. Entre uma rodada e outra, o terminal é consultado sem
+    // bloquear: se o jogador digitar algo, ou o teto do turno passar, todas as tarefas encerram e jogam o melhor que
+    // encontraram.
+    int apressado = 0;
+    for (size_t onda = 0; onda < numTarefas; onda += numPilhas > 0 ? numPilhas : numTarefas)
+    {
+        size_t fimOnda = numPilhas > 0 && onda + numPilhas < numTarefas ? onda + numPilhas : numTarefas;
+        size_t ativas = 0;
+        for (size_t t = onda; t < fimOnda; t++)
+        {
+            TarefaIA *tarefa = &tarefas[t];
+            if (numPilhas == 0 || !prepararTarefaIA(tarefa, pilhas[t - onda]))
+            {
+                tarefa->semPilha = 1;
+                tarefa->terminada = 1;
+                continue;
+            }
+            ativas++;
+        }
+
+        while (ativas > 0)
+        {
+            apressado = apressado || entradaPendente() || relogioNs() > prazoTurnoNs;
+            for (size_t t = onda; t < fimOnda; t++)
+            {
+                TarefaIA *tarefa = &tarefas[t];
+                if (tarefa->terminada)
+                    continue;
+
+                // Uma tarefa cancelada ainda é retomada uma vez, para encerrar a busca e liberar o que alocou.
+                if (apressado || tarefa->consumidoNs >= orcamentoNs)
+                    tarefa->cancelada = 1;
+
+                uint64_t inicioNs = relogioNs();
+                tarefa->fimFatiaNs = inicioNs + FATIA_IA_NS;
+                tarefaIAAtual = tarefa;
+                swapcontext(&contextoEscalonador, &tarefa->contexto);
+                tarefaIAAtual = NULL;
+                tarefa->consumidoNs += relogioNs() - inicioNs;
+
+                if (tarefa->terminada)
+                    ativas--;
+            }
+        }
+    }
+    for (size_t p = 0; p < numPilhas; p++)
+        LIBERAR(pilhas[p]);
+
+    // As jogadas são aplicadas em ordem, depois que todas pensaram sobre o mesmo mapa.
+    // Uma jogada que deixou de valer por causa de uma anterior é recusada pela validação do lote.
+    printf("\n==== 🤖  JOGADAS DO COMPUTADOR ====\n");
+    for (size_t t = 0; t < numTarefas; t++)
+    {
+        TarefaIA *tarefa = &tarefas[t];
+        if (tarefa->semPilha)
+        {
+            printf(" ⚠️  %s: sem memória para pensar, passa a vez.\n", tarefa->missao->cor);
+            continue;
+        }
+        if (!tarefa->temJogada)
+        {
+            printf(" %s: sem ataques possíveis (%.1f ms).\n", tarefa->missao->cor, (double)tarefa->consumidoNs / 1e6);
+            continue;
+        }
+
+        OrdemAtaque ordem = {tarefa->atacante, tarefa->defensor, tarefa->modo, 0};
+        ResultadoOrdem resultado;
+        char nomeDefensor[TAM_NOME], corDefensor[TAM_COR];
+        memcpy(nomeDefensor, mapa[tarefa->defensor].nome, TAM_NOME);
+        memcpy(corDefensor, mapa[tarefa->defensor].cor, TAM_COR);
+        resolverOrdensEmLote(mapa, tamanho, &ordem, 1, &resultado, 0);
+
+        printf(" %s: %s ataca %s (%s) | %s", tarefa->missao->cor, mapa[tarefa->atacante].nome, nomeDefensor, corDefensor,
+               tarefa->origem);
+        if (tarefa->profundidade > 0)
+            printf(", profundidade %d", tarefa->profundidade);
+        printf(", %.1f ms%s | ", (double)tarefa->consumidoNs / 1e6, tarefa->cancelada ? ", orçamento esgotado" : "");
+
+        if (resultado.codigo != 0)
+            printf("jogada recusada.\n");
+        else if (resultado.conquistado)
+            printf("🏆 conquistado (perdas %d x %d).\n", resultado.perdasAtacante, resultado.perdasDefensor);
+        else
+            printf("perdas %d x %d.\n", resultado.perdasAtacante, resultado.perdasDefensor);
+    }
+
+    // As jogadas do computador não entram no histórico de desfazer. Um desfazer do jogador voltaria ao ponto anterior
+    // à sua própria jogada, apagando também as do computador; por isso as pilhas recomeçam daqui.
+    descartarPontosDesfazer(historicoMapa);
+
+    LIBERAR(tarefas);
+}
+
+// **** Cenários embutidos: ****
+
+const CenarioEmbutido *buscarCenario(const char *nome)
+{
+    for (size_t c = 0; c < NUM_CENARIOS_EMBUTIDOS; c++)
+        if (strcmp(cenariosEmbutidos[c].nome, nome) == 0)
+            return &cenariosEmbutidos[c];
+    return NULL;
+}
+
+const CenarioEmbutido *escolherCenario(void)
+{
+    printf("\n==== 📦  CENÁRIOS PRONTOS ====\n\n");
+    for (size_t c = 0; c < NUM_CENARIOS_EMBUTIDOS; c++)
+        printf("%zu - %s: %s\n", c + 1, cenariosEmbutidos[c].nome, cenariosEmbutidos[c].descricao);
+
+    int escolha = 0;
+    printf("Escolha um cenário (0 para sair): ");
+    if (scanf("%d", &escolha) != 1)
+        escolha = 0;
+    limparBufferEntrada();
+
+    if (escolha < 1 || (size_t)escolha > NUM_CENARIOS_EMBUTIDOS)
+        return NULL;
+    return &cenariosEmbutidos[escolha - 1];
+}
+
+void aplicarCenario(const CenarioEmbutido *cenario, ConfiguracaoGerador *config)
+{
+    // Um cenário substitui qualquer mapa pedido por --gerar ou --carregar.
+    config->quantidade = cenario->quantidade;
+    config->numCores = cenario->numCores;
+    config->distribuicao = cenario->distribuicao;
+    config->tropasMaximas = cenario->tropasMaximas;
+    config->semente = cenario->semente;
+    config->comVizinhanca = cenario->comVizinhanca;
+    config->territoriosPorRegiao = cenario->territoriosPorRegiao;
+    config->arquivoEntrada = NULL;
+}
+
+void carregarMapaClassico(Territorio *mapa)
+{
+    // Cópia direta das tabelas const: nomes e cores já cabem nos campos do território.
+    for (size_t i = 0; i < NUM_TERRITORIOS_CLASSICOS; i++)
+    {
+        snprintf(mapa[i].nome, TAM_NOME, "%s", territoriosClassicos[i].nome);
+        snprintf(mapa[i].cor, TAM_COR, "%s", territoriosClassicos[i].cor);
+        mapa[i].tropas = territoriosClassicos[i].tropas;
+    }
+
+    vizinhanca = construirVizinhancaClassica();
+    if (vizinhanca == NULL)
+        printf("\n ⚠️  Sem memória para a vizinhança. O mapa seguirá sem fronteiras.\n");
+
+    printf("\n 🗺️  Mapa clássico carregado: %d territórios, %d continentes e %zu fronteiras.\n", NUM_TERRITORIOS_CLASSICOS,
+           NUM_CONTINENTES_CLASSICOS, NUM_FRONTEIRAS_CLASSICAS);
+}
+
+GrafoVizinhanca *construirVizinhancaClassica(void)
+{
+    GrafoVizinhanca *grafo = (GrafoVizinhanca *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(GrafoVizinhanca));
+    if (grafo == NULL)
+        return NULL;
+
+    grafo->numTerritorios = NUM_TERRITORIOS_CLASSICOS;
+    grafo->numEntradas = 2 * NUM_FRONTEIRAS_CLASSICAS;
+    grafo->inicio = (size_t *)ALOCAR_ZERADO(MEMORIA_INDICES, NUM_TERRITORIOS_CLASSICOS + 1, sizeof(size_t));
+    grafo->vizinhos = (size_t *)ALOCAR(MEMORIA_INDICES, grafo->numEntradas * sizeof(size_t));
+    if (grafo->inicio == NULL || grafo->vizinhos == NULL)
+    {
+        liberarVizinhanca(grafo);
+        return NULL;
+    }
+
+    // Cada fronteira aparece uma vez na tabela e vale nos dois sentidos: grau, soma de prefixos e preenchimento.
+    for (size_t f = 0; f < NUM_FRONTEIRAS_CLASSICAS; f++)
+    {
+        grafo->inicio[fronteirasClassicas[f].a + 1]++;
+        grafo->inicio[fronteirasClassicas[f].b + 1]++;
+    }
+    for (size_t i = 0; i < NUM_TERRITORIOS_CLASSICOS; i++)
+        grafo->inicio[i + 1] += grafo->inicio[i];
+
+    size_t preenchidos[NUM_TERRITORIOS_CLASSICOS] = {0};
+    for (size_t f = 0; f < NUM_FRONTEIRAS_CLASSICAS; f++)
+    {
+        size_t a = fronteirasClassicas[f].a, b = fronteirasClassicas[f].b;
+        grafo->vizinhos[grafo->inicio[a] + preenchidos[a]++] = b;
+        grafo->vizinhos[grafo->inicio[b] + preenchidos[b]++] = a;
+    }
+
+    return grafo;
+}
+
+int gravarMapaClassico(const char *caminho)
+{
+    Territorio mapa[NUM_TERRITORIOS_CLASSICOS];
+    memset(mapa, 0, sizeof(mapa));
+    for (size_t i = 0; i < NUM_TERRITORIOS_CLASSICOS; i++)
+    {
+        snprintf(mapa[i].nome, TAM_NOME, "%s", territoriosClassicos[i].nome);
+        snprintf(mapa[i].cor, TAM_COR, "%s", territoriosClassicos[i].cor);
+        mapa[i].tropas = territoriosClassicos[i].tropas;
+    }
+
+    GrafoVizinhanca *grafo = construirVizinhancaClassica();
+    FILE *arquivo = grafo != NULL ? fopen(caminho, "wb") : NULL;
+    CabecalhoArquivoMapa cabecalho = {.magica = "WARMAPA", .versao = VERSAO_ARQUIVO_MAPA, .tamanhoTerritorio = sizeof(Territorio),
+                                      .numTerritorios = NUM_TERRITORIOS_CLASSICOS, .numEntradasVizinhanca = 2 * NUM_FRONTEIRAS_CLASSICAS};
+    int sucesso = arquivo != NULL && fwrite(&cabecalho, sizeof(cabecalho), 1, arquivo) == 1 &&
+                  fwrite(mapa, sizeof(Territorio), NUM_TERRITORIOS_CLASSICOS, arquivo) == NUM_TERRITORIOS_CLASSICOS;
+
+    // Vizinhança em 64 bits, como nos mapas gerados: primeiro os inícios, depois os vizinhos.
+    for (size_t i = 0; sucesso && i <= NUM_TERRITORIOS_CLASSICOS; i++)
+    {
+        uint64_t valor = grafo->inicio[i];
+        sucesso = fwrite(&valor, sizeof(valor), 1, arquivo) == 1;
+    }
+    for (size_t k = 0; sucesso && k < grafo->numEntradas; k++)
+    {
+        uint64_t valor = grafo->vizinhos[k];
+        sucesso = fwrite(&valor, sizeof(valor), 1, arquivo) == 1;
+    }
+
+    if (arquivo != NULL && fclose(arquivo) != 0)
+        sucesso = 0;
+    liberarVizinhanca(grafo);
+
+    if (!sucesso)
+    {
+        printf("\n ❌  Erro ao gravar o mapa em %s.\n", caminho);
+        return 0;
+    }
+
+    printf("\n 🗺️  Mapa clássico de %d territórios gravado em %s.\n", NUM_TERRITORIOS_CLASSICOS, caminho);
+    return 1;
+}
+
+MapaRegioes *criarContinentesClassicos(const Territorio *mapa, size_t tamanho)
+{
+    MapaRegioes *continentes = criarRegioes(mapa, tamanho);
+    if (continentes == NULL)
+        return NULL;
+
+    // A tabela de territórios agrupa cada continente em posições consecutivas.
+    size_t ids[NUM_TERRITORIOS_CLASSICOS];
+    for (size_t c = 0, primeiro = 0; c < NUM_CONTINENTES_CLASSICOS; c++)
+    {
+        size_t quantidade = 0;
+        while (primeiro + quantidade < NUM_TERRITORIOS_CLASSICOS && territoriosClassicos[primeiro + quantidade].continente == c)
+        {
+            ids[quantidade] = primeiro + quantidade;
+            quantidade++;
+        }
+
+        if (adicionarRegiao(continentes, continentesClassicos[c].nome, ids, quantidade, continentesClassicos[c].bonus) < 0)
+        {
+            liberarRegioes(continentes);
+            return NULL;
+        }
+        primeiro += quantidade;
+    }
+
+    return continentes;
+}
+
+// **** Armazém colunar de estatísticas de batalhas: ****
+
+ArmazemEstatisticas *criarArmazemEstatisticas(const char *diretorio)
+{
+    // Um diretório existente é reaproveitado: as colunas seguem acumulando partidas anteriores.
+    if (mkdir(diretorio, 0755) != 0 && errno != EEXIST)
+        return NULL;
+
+    ArmazemEstatisticas *armazem = (ArmazemEstatisticas *)ALOCAR_ZERADO(MEMORIA_HISTORICO, 1, sizeof(ArmazemEstatisticas));
+    if (armazem == NULL)
+        return NULL;
+    armazem->diretorio = diretorio;
+
+    int sucesso = alinharColunas(armazem) && carregarDicionarioCores(armazem);
+#define ALOCAR_COLUNA(bloco, campo, tipo) \
+    sucesso = sucesso && (armazem->bloco.campo = (tipo *)ALOCAR(MEMORIA_HISTORICO, LINHAS_BLOCO_ESTATISTICAS * sizeof(tipo))) != NULL;
+#define ALOCAR_COLUNA_BATALHA(campo, tipo) ALOCAR_COLUNA(batalhas, campo, tipo)
+#define ALOCAR_COLUNA_MISSAO(campo, tipo) ALOCAR_COLUNA(missoes, campo, tipo)
+    COLUNAS_BATALHAS(ALOCAR_COLUNA_BATALHA)
+    COLUNAS_MISSOES(ALOCAR_COLUNA_MISSAO)
+#undef ALOCAR_COLUNA_MISSAO
+#undef ALOCAR_COLUNA_BATALHA
+#undef ALOCAR_COLUNA
+
+    if (!sucesso)
+    {
+        liberarArmazemEstatisticas(armazem);
+        return NULL;
+    }
+    return armazem;
+}
+
+uint16_t idCorEstatisticas(const char *cor)
+{
+    ArmazemEstatisticas *armazem = armazemEstatisticas;
+    int indice = indiceCoresDisponivel() ? buscarCor(indiceCores, cor) : -1;
+
+    // Caminho comum: a cor da partida já foi buscada no dicionário.
+    if (indice >= 0 && (size_t)indice < armazem->numIdsCores && armazem->idsCores[indice] != COR_ESTATISTICAS_VAZIA)
+        return armazem->idsCores[indice];
+
+    size_t id = 0;
+    while (id < armazem->numNomesCores && strcmp(armazem->nomesCores[id], cor) != 0)
+        id++;
+
+    if (id == armazem->numNomesCores)
+    {
+        // Cor nova: entra no fim do dicionário. Um nome gravado sem batalha que o use é inofensivo.
+        if (id >= COR_ESTATISTICAS_VAZIA)
+            return COR_ESTATISTICAS_VAZIA;
+        char caminho[TAM_CAMINHO_ESTATISTICAS];
+        if (snprintf(caminho, sizeof(caminho), "%s/cores", armazem->diretorio) >= (int)sizeof(caminho))
+            return COR_ESTATISTICAS_VAZIA;
+        FILE *arquivo = fopen(caminho, "a");
+        if (arquivo == NULL)
+            return COR_ESTATISTICAS_VAZIA;
+        int gravado = fprintf(arquivo, "%s\n", cor) > 0;
+        if (fclose(arquivo) != 0 || !gravado || !acrescentarNomeCor(armazem, cor))
+            return COR_ESTATISTICAS_VAZIA;
+    }
+
+    // Guarda o id pela posição da cor no índice da partida, que cresce junto com o número de cores.
+    if (indice >= 0 && (size_t)indice >= armazem->numIdsCores)
+    {
+        size_t quantidade = indiceCores->numCores;
+        uint16_t *ampliado = (uint16_t *)REALOCAR(MEMORIA_HISTORICO, armazem->idsCores, quantidade * sizeof(uint16_t));
+        if (ampliado != NULL)
+        {
+            for (size_t c = armazem->numIdsCores; c < quantidade; c++)
+                ampliado[c] = COR_ESTATISTICAS_VAZIA;
+            armazem->idsCores = ampliado;
+            armazem->numIdsCores = quantidade;
+        }
+    }
+    if (indice >= 0 && (size_t)indice < armazem->numIdsCores)
+        armazem->idsCores[indice] = (uint16_t)id;
+    return (uint16_t)id;
+}
+
+int carregarDicionarioCores(ArmazemEstatisticas *armazem)
+{
+    char caminho[TAM_CAMINHO_ESTATISTICAS];
+    if (snprintf(caminho, sizeof(caminho), "%s/cores", armazem->diretorio) >= (int)sizeof(caminho))
+        return 0;
+
+    FILE *arquivo = fopen(caminho, "r");
+    if (arquivo == NULL)
+        return errno == ENOENT;
+
+    char linha[TAM_COR + 1];
+    long completo = 0; // Fim da última linha terminada por '\n'.
+    int sucesso = 1;
+    while (sucesso && fgets(linha, sizeof(linha), arquivo) != NULL)
+    {
+        size_t tamanho = strlen(linha);
+        if (linha[tamanho - 1] != '\n')
+            break;
+        linha[tamanho - 1] = '\0';
+        sucesso = acrescentarNomeCor(armazem, linha);
+        completo = ftell(arquivo);
+    }
+    fseek(arquivo, 0, SEEK_END);
+    long fim = ftell(arquivo);
+    fclose(arquivo);
+
+    // Um nome cortado no meio (ou longo demais) não tem id: o dicionário volta à última linha completa.
+    if (sucesso && fim != completo && truncate(caminho, (off_t)completo) != 0)
+        sucesso = 0;
+    return sucesso;
+}
+
+int acrescentarNomeCor(ArmazemEstatisticas *armazem, const char *cor)
+{
+    if (armazem->numNomesCores == armazem->capacidadeNomesCores)
+    {
+        size_t capacidade = armazem->capacidadeNomesCores > 0 ? armazem->capacidadeNomesCores * 2 : 16;
+        char(*ampliado)[TAM_COR] = (char(*)[TAM_COR])REALOCAR(MEMORIA_HISTORICO, armazem->nomesCores, capacidade * TAM_COR);
+        if (ampliado == NULL)
+            return 0;
+        armazem->nomesCores = ampliado;
+        armazem->capacidadeNomesCores = capacidade;
+    }
+    snprintf(armazem->nomesCores[armazem->numNomesCores++], TAM_COR, "%s", cor);
+    return 1;
+}
+
+void registrarEstatisticaBatalha(const char *corAtacante, const char *corDefensor, const AmostraBatalha *amostra)
+{
+    ArmazemEstatisticas *armazem = armazemEstatisticas;
+    if (armazem == NULL || armazem->falhou)
+        return;
+
+    // Os campos que dependem da partida são preenchidos aqui, e não em cada ponto de batalha.
+    AmostraBatalha linha = *amostra;
+    const MissaoJogador *missao = missaoDaCor(corAtacante);
+    linha.turno = (uint32_t)turnoAtual;
+    linha.corAtacante = idCorEstatisticas(corAtacante);
+    linha.corDefensor = idCorEstatisticas(corDefensor);
+    linha.missaoAtacante = missao != NULL ? (uint8_t)missao->tipo : 0;
+
+    BlocoBatalhas *bloco = &armazem->batalhas;
+#define ANEXAR_CAMPO(campo, tipo) bloco->campo[bloco->quantidade] = linha.campo;
+    COLUNAS_BATALHAS(ANEXAR_CAMPO)
+#undef ANEXAR_CAMPO
+
+    if (++bloco->quantidade == LINHAS_BLOCO_ESTATISTICAS)
+        gravarEstatisticas(armazem);
+}
+
+void registrarEstatisticaMissao(TipoMissao tipo, const char *cor, size_t territorios)
+{
+    ArmazemEstatisticas *armazem = armazemEstatisticas;
+    if (armazem == NULL || armazem->falhou)
+        return;
+
+    AmostraMissao linha = {.turno = (uint32_t)turnoAtual, .tipo = (uint8_t)tipo, .cor = idCorEstatisticas(cor),
+                           .territorios = territorios > UINT32_MAX ? UINT32_MAX : (uint32_t)territorios};
+
+    BlocoMissoes *bloco = &armazem->missoes;
+#define ANEXAR_CAMPO(campo, tipo) bloco->campo[bloco->quantidade] = linha.campo;
+    COLUNAS_MISSOES(ANEXAR_CAMPO)
+#undef ANEXAR_CAMPO
+
+    if (++bloco->quantidade == LINHAS_BLOCO_ESTATISTICAS)
+        gravarEstatisticas(armazem);
+}
+
+int caminhoColuna(char *destino, const char *diretorio, const char *tabela, const char *campo)
+{
+    return snprintf(destino, TAM_CAMINHO_ESTATISTICAS, "%s/%s.%s.col", diretorio, tabela, campo) < TAM_CAMINHO_ESTATISTICAS;
+}
+
+FILE *abrirColuna(const char *diretorio, const char *tabela, const char *campo, const char *modo)
+{
+    char caminho[TAM_CAMINHO_ESTATISTICAS];
+    if (!caminhoColuna(caminho, diretorio, tabela, campo))
+        return NULL;
+    return fopen(caminho, modo);
+}
+
+int lerManifestoEstatisticas(const char *diretorio, uint64_t *batalhas, uint64_t *missoes)
+{
+    char caminho[TAM_CAMINHO_ESTATISTICAS];
+    if (snprintf(caminho, sizeof(caminho), "%s/manifesto", diretorio) >= (int)sizeof(caminho))
+        return 0;
+
+    FILE *arquivo = fopen(caminho, "r");
+    if (arquivo == NULL)
+        return 0;
+
+    unsigned long long lidasBatalhas, lidasMissoes;
+    int versao = 0;
+    int valido = fscanf(arquivo, "WARESTAT %d batalhas %llu missoes %llu", &versao, &lidasBatalhas, &lidasMissoes) == 3 &&
+                 versao == VERSAO_MANIFESTO_ESTATISTICAS;
+    fclose(arquivo);
+    if (versao != 0 && versao != VERSAO_MANIFESTO_ESTATISTICAS)
+        return -1;
+
+    if (valido)
+    {
+        *batalhas = lidasBatalhas;
+        *missoes = lidasMissoes;
+    }
+    return valido;
+}
+
+int gravarManifestoEstatisticas(const char *diretorio, uint64_t batalhas, uint64_t missoes)
+{
+    char caminho[TAM_CAMINHO_ESTATISTICAS], temporario[TAM_CAMINHO_ESTATISTICAS];
+    if (snprintf(caminho, sizeof(caminho), "%s/manifesto", diretorio) >= (int)sizeof(caminho) ||
+        snprintf(temporario, sizeof(temporario), "%s/manifesto.tmp", diretorio) >= (int)sizeof(temporario))
+        return 0;
+
+    FILE *arquivo = fopen(temporario, "w");
+    if (arquivo == NULL)
+        return 0;
+
+    int sucesso = fprintf(arquivo, "WARESTAT %d\nbatalhas %llu\nmissoes %llu\n", VERSAO_MANIFESTO_ESTATISTICAS,
+                          (unsigned long long)batalhas, (unsigned long long)missoes) > 0;
+    if (fclose(arquivo) != 0)
+        sucesso = 0;
+
+    // A troca por rename() é atômica: quem abrir o diretório vê o manifesto antigo ou o novo, nunca um pela metade.
+    return sucesso && rename(temporario, caminho) == 0;
+}
+
+int ajustarColuna(const char *diretorio, const char *tabela, const char *campo, size_t largura, uint64_t *linhas, int cortar)
+{
+    char caminho[TAM_CAMINHO_ESTATISTICAS];
+    if (!caminhoColuna(caminho, diretorio, tabela, campo))
+        return 0;
+
+    struct stat info;
+    if (stat(caminho, &info) != 0)
+    {
+        // Coluna ainda não criada: a tabela não tem linhas.
+        *linhas = 0;
+        return errno == ENOENT;
+    }
+
+    uint64_t completas = (uint64_t)info.st_size / largura;
+    if (completas < *linhas)
+        *linhas = completas;
+
+    if (cortar && (uint64_t)info.st_size != *linhas * largura)
+        return truncate(caminho, (off_t)(*linhas * largura)) == 0;
+    return 1;
+}
+
+int alinharColunas(ArmazemEstatisticas *armazem)
+{
+    uint64_t batalhas = UINT64_MAX, missoes = UINT64_MAX;
+    int comManifesto = lerManifestoEstatisticas(armazem->diretorio, &batalhas, &missoes);
+    uint64_t manifestoBatalhas = batalhas, manifestoMissoes = missoes;
+
+    // Colunas de outra versão têm outras larguras: alinhá-las corromperia as linhas antigas.
+    if (comManifesto < 0)
+    {
+        printf("\n ⚠️  O diretório %s foi gravado por outra versão do formato de estatísticas.\n", armazem->diretorio);
+        return 0;
+    }
+
+    // Primeiro mede: nenhuma coluna passa das linhas confirmadas, nem da coluna mais curta.
+    // Depois corta todas no mesmo ponto.
+    int sucesso = 1;
+    for (int cortar = 0; cortar <= 1; cortar++)
+    {
+#define AJUSTAR_COLUNA_BATALHA(campo, tipo) \
+    sucesso = sucesso && ajustarColuna(armazem->diretorio, "batalhas", #campo, sizeof(tipo), &batalhas, cortar);
+#define AJUSTAR_COLUNA_MISSAO(campo, tipo) \
+    sucesso = sucesso && ajustarColuna(armazem->diretorio, "missoes", #campo, sizeof(tipo), &missoes, cortar);
+        COLUNAS_BATALHAS(AJUSTAR_COLUNA_BATALHA)
+        COLUNAS_MISSOES(AJUSTAR_COLUNA_MISSAO)
+#undef AJUSTAR_COLUNA_MISSAO
+#undef AJUSTAR_COLUNA_BATALHA
+    }
+
+    if (sucesso && (!comManifesto || batalhas != manifestoBatalhas || missoes != manifestoMissoes))
+        sucesso = gravarManifestoEstatisticas(armazem->diretorio, batalhas, missoes);
+
+    armazem->batalhasConfirmadas = batalhas;
+    armazem->missoesConfirmadas = missoes;
+    return sucesso;
+}
+
+int anexarColuna(const char *diretorio, const char *tabela, const char *campo, const void *valores, size_t largura, size_t linhas)
+{
+    FILE *arquivo = abrirColuna(diretorio, tabela, campo, "ab");
+    if (arquivo == NULL)
+        return 0;
+
+    int sucesso = fwrite(valores, largura, linhas, arquivo) == linhas;
+    if (fclose(arquivo) != 0)
+        sucesso = 0;
+    return sucesso;
+}
+
+int gravarEstatisticas(ArmazemEstatisticas *armazem)
+{
+    if (armazem == NULL || armazem->falhou)
+        return 0;
+
+    // Cada coluna recebe o bloco inteiro de uma vez, no fim do seu arquivo.
+    int sucesso = 1;
+#define GRAVAR_COLUNA(bloco, tabela, campo, tipo) \
+    sucesso = sucesso && anexarColuna(armazem->diretorio, tabela, #campo, armazem->bloco.campo, sizeof(tipo), armazem->bloco.quantidade);
+#define GRAVAR_COLUNA_BATALHA(campo, tipo) GRAVAR_COLUNA(batalhas, "batalhas", campo, tipo)
+#define GRAVAR_COLUNA_MISSAO(campo, tipo) GRAVAR_COLUNA(missoes, "missoes", campo, tipo)
+    if (armazem->batalhas.quantidade > 0)
+    {
+        COLUNAS_BATALHAS(GRAVAR_COLUNA_BATALHA)
+    }
+    if (armazem->missoes.quantidade > 0)
+    {
+        COLUNAS_MISSOES(GRAVAR_COLUNA_MISSAO)
+    }
+#undef GRAVAR_COLUNA_MISSAO
+#undef GRAVAR_COLUNA_BATALHA
+#undef GRAVAR_COLUNA
+
+    // O bloco só passa a valer quando o manifesto o confirma. Numa falha, as colunas que já o receberam
+    // voltam às linhas confirmadas: as que não o receberam continuam alinhadas com elas.
+    uint64_t batalhas = armazem->batalhasConfirmadas + armazem->batalhas.quantidade;
+    uint64_t missoes = armazem->missoesConfirmadas + armazem->missoes.quantidade;
+    sucesso = sucesso && gravarManifestoEstatisticas(armazem->diretorio, batalhas, missoes);
+    if (sucesso)
+    {
+        armazem->batalhasConfirmadas = batalhas;
+        armazem->missoesConfirmadas = missoes;
+    }
+
+    armazem->batalhas.quantidade = 0;
+    armazem->missoes.quantidade = 0;
+
+    if (!sucesso)
+    {
+        alinharColunas(armazem);
+        armazem->falhou = 1;
+        printf("\n ⚠️  Erro ao gravar as estatísticas em %s. As próximas batalhas não serão registradas.\n", armazem->diretorio);
+    }
+    return sucesso;
+}
+
+size_t lerColunas(FILE **arquivos, void **destinos, const size_t *larguras, size_t numColunas, uint64_t *restantes)
+{
+    // As colunas avançam juntas e nunca além das linhas confirmadas pelo manifesto.
+    size_t linhas = *restantes < LINHAS_BLOCO_ESTATISTICAS ? (size_t)*restantes : LINHAS_BLOCO_ESTATISTICAS;
+    for (size_t c = 0; c < numColunas && linhas > 0; c++)
+    {
+        size_t lidas = fread(destinos[c], larguras[c], linhas, arquivos[c]);
+        if (lidas < linhas)
+            linhas = lidas;
+    }
+    *restantes -= linhas;
+    return linhas;
+}
+
+void consultarConquistasPorProporcao(const ArmazemEstatisticas *armazem)
+{
+    const char *diretorio = armazem->diretorio;
+    uint64_t restantes = armazem->batalhasConfirmadas;
+    static const double limites[FAIXAS_PROPORCAO_TROPAS - 1] = {0.5, 1.0, 1.5, 2.0, 3.0, 5.0, 10.0};
+    static const char *rotulos[FAIXAS_PROPORCAO_TROPAS] = {"< 0.5", "0.5-1", "1-1.5", "1.5-2", "2-3", "3-5", "5-10", ">= 10"};
+
+    uint64_t inicioNs = relogioNs();
+
+    // Só as colunas da consulta são lidas: as demais nem são abertas.
+    const char *campos[] = {"modo", "tropasAtacante", "tropasDefensor", "perdasAtacante", "conquista"};
+    const size_t larguras[] = {sizeof(uint8_t), sizeof(int32_t), sizeof(int32_t), sizeof(int32_t), sizeof(uint8_t)};
+    const size_t numColunas = sizeof(campos) / sizeof(campos[0]);
+
+    FILE *arquivos[sizeof(campos) / sizeof(campos[0])] = {NULL};
+    void *valores[sizeof(campos) / sizeof(campos[0])] = {NULL};
+    int sucesso = 1;
+    for (size_t c = 0; c < numColunas; c++)
+    {
+        arquivos[c] = abrirColuna(diretorio, "batalhas", campos[c], "rb");
+        valores[c] = ALOCAR(MEMORIA_TEMPORARIA, LINHAS_BLOCO_ESTATISTICAS * larguras[c]);
+        sucesso = sucesso && arquivos[c] != NULL && valores[c] != NULL;
+    }
+
+    // Por faixa: [0] rodadas únicas, [1] batalhas completas (blitz).
+    uint64_t batalhas[FAIXAS_PROPORCAO_TROPAS][2] = {{0}}, conquistas[FAIXAS_PROPORCAO_TROPAS][2] = {{0}};
+    uint64_t perdas[FAIXAS_PROPORCAO_TROPAS] = {0}, total = 0;
+
+    size_t linhas;
+    while (sucesso && (linhas = lerColunas(arquivos, valores, larguras, numColunas, &restantes)) > 0)
+    {
+        const uint8_t *modo = (const uint8_t *)valores[0];
+        const int32_t *tropasAtacante = (const int32_t *)valores[1];
+        const int32_t *tropasDefensor = (const int32_t *)valores[2];
+        const int32_t *perdasAtacante = (const int32_t *)valores[3];
+        const uint8_t *conquista = (const uint8_t *)valores[4];
+
+        for (size_t i = 0; i < linhas; i++)
+        {
+            double proporcao = (double)tropasAtacante[i] / (tropasDefensor[i] > 0 ? tropasDefensor[i] : 1);
+            size_t faixa = 0;
+            while (faixa < FAIXAS_PROPORCAO_TROPAS - 1 && proporcao >= limites[faixa])
+                faixa++;
+
+            int completa = modo[i] != ORDEM_RODADA_UNICA;
+            batalhas[faixa][completa]++;
+            conquistas[faixa][completa] += conquista[i];
+            if (completa)
+                perdas[faixa] += (uint64_t)perdasAtacante[i];
+        }
+        total += linhas;
+    }
+
+    for (size_t c = 0; c < numColunas; c++)
+    {
+        if (arquivos[c] != NULL)
+            fclose(arquivos[c]);
+        LIBERAR(valores[c]);
+    }
+
+    if (!sucesso)
+    {
+        printf("\n ⚠️  Não há batalhas registradas em %s.\n", diretorio);
+        return;
+    }
+
+    printf("\n 📊  Conquistas por proporção de tropas (atacante / defensor) | %llu batalhas em %.1f ms\n",
+           (unsigned long long)total, (double)(relogioNs() - inicioNs) / 1e6);
+    printf("  %-7s | %12s %9s | %12s %9s %15s\n", "Faixa", "Rodada única", "Conquista", "Blitz", "Conquista", "Perdas médias");
+    for (size_t f = 0; f < FAIXAS_PROPORCAO_TROPAS; f++)
+    {
+        if (batalhas[f][0] == 0 && batalhas[f][1] == 0)
+            continue;
+        printf("  %-7s | %12llu %8.1f%% | %12llu %8.1f%% %14.2f\n", rotulos[f], (unsigned long long)batalhas[f][0],
+               batalhas[f][0] > 0 ? 100.0 * (double)conquistas[f][0] / (double)batalhas[f][0] : 0.0, (unsigned long long)batalhas[f][1],
+               batalhas[f][1] > 0 ? 100.0 * (double)conquistas[f][1] / (double)batalhas[f][1] : 0.0,
+               batalhas[f][1] > 0 ? (double)perdas[f] / (double)batalhas[f][1] : 0.0);
+    }
+}
+
+void consultarTempoDeMissoes(const ArmazemEstatisticas *armazem)
+{
+    const char *diretorio = armazem->diretorio;
+    uint64_t restantes = armazem->missoesConfirmadas;
+    static const char *nomes[MISSAO_DOMINAR_REGIOES + 1] = {"Desconhecida", "Eliminar cor", "Conquistar", "Tropas mínimas",
+                                                            "Tropas máximas", "Tropas exatas", "Dominar região", "Dominar regiões"};
+
+    uint64_t inicioNs = relogioNs();
+
+    const char *campos[] = {"tipo", "turno"};
+    const size_t larguras[] = {sizeof(uint8_t), sizeof(uint32_t)};
+    const size_t numColunas = sizeof(campos) / sizeof(campos[0]);
+
+    FILE *arquivos[sizeof(campos) / sizeof(campos[0])] = {NULL};
+    void *valores[sizeof(campos) / sizeof(campos[0])] = {NULL};
+    int sucesso = 1;
+    for (size_t c = 0; c < numColunas; c++)
+    {
+        arquivos[c] = abrirColuna(diretorio, "missoes", campos[c], "rb");
+        valores[c] = ALOCAR(MEMORIA_TEMPORARIA, LINHAS_BLOCO_ESTATISTICAS * larguras[c]);
+        sucesso = sucesso && arquivos[c] != NULL && valores[c] != NULL;
+    }
+
+    uint64_t partidas[MISSAO_DOMINAR_REGIOES + 1] = {0}, somaTurnos[MISSAO_DOMINAR_REGIOES + 1] = {0}, total = 0;
+    uint32_t menor[MISSAO_DOMINAR_REGIOES + 1], maior[MISSAO_DOMINAR_REGIOES + 1] = {0};
+    for (size_t t = 0; t <= MISSAO_DOMINAR_REGIOES; t++)
+        menor[t] = UINT32_MAX;
+
+    size_t linhas;
+    while (sucesso && (linhas = lerColunas(arquivos, valores, larguras, numColunas, &restantes)) > 0)
+    {
+        const uint8_t *tipo = (const uint8_t *)valores[0];
+        const uint32_t *turno = (const uint32_t *)valores[1];
+
+        for (size_t i = 0; i < linhas; i++)
+        {
+            size_t t = tipo[i] <= MISSAO_DOMINAR_REGIOES ? tipo[i] : 0;
+            partidas[t]++;
+            somaTurnos[t] += turno[i];
+            menor[t] = turno[i] < menor[t] ? turno[i] : menor[t];
+            maior[t] = turno[i] > maior[t] ? turno[i] : maior[t];
+        }
+        total += linhas;
+    }
+
+    for (size_t c = 0; c < numColunas; c++)
+    {
+        if (arquivos[c] != NULL)
+            fclose(arquivos[c]);
+        LIBERAR(valores[c]);
+    }
+
+    if (!sucesso)
+    {
+        printf("\n ⚠️  Não há missões cumpridas registradas em %s.\n", diretorio);
+        return;
+    }
+
+    printf("\n 🎯  Turno de conclusão por tipo de missão | %llu partidas em %.1f ms\n", (unsigned long long)total,
+           (double)(relogioNs() - inicioNs) / 1e6);
+    // Letras acentuadas ocupam 2 bytes e 1 coluna: os títulos acentuados levam 1 de largura a mais, e o nome vai por último.
+    printf("  %10s %11s %9s %9s | %s\n", "Partidas", "Média", "Mínimo", "Máximo", "Missão");
+    for (size_t t = 0; t <= MISSAO_DOMINAR_REGIOES; t++)
+    {
+        if (partidas[t] == 0)
+            continue;
+        printf("  %10llu %10.1f %8u %8u | %s\n", (unsigned long long)partidas[t], (double)somaTurnos[t] / (double)partidas[t],
+               menor[t], maior[t], nomes[t]);
+    }
+}
+
+void faseDeEstatisticas(void)
+{
+    printf("\n==== 📊  ESTATÍSTICAS DE BATALHAS ====\n");
+
+    if (armazemEstatisticas == NULL)
+    {
+        printf("\n ⚠️  O armazém de estatísticas está desligado. Inicie o jogo com --estatisticas diretório.\n");
+        return;
+    }
+
+    // As linhas ainda em memória vão para o disco antes da varredura, para que a consulta inclua a partida atual.
+    gravarEstatisticas(armazemEstatisticas);
+    consultarConquistasPorProporcao(armazemEstatisticas);
+    consultarTempoDeMissoes(armazemEstatisticas);
+}
+
+void liberarArmazemEstatisticas(ArmazemEstatisticas *armazem)
+{
+    if (armazem == NULL)
+        return;
+#define LIBERAR_COLUNA_BATALHA(campo, tipo) LIBERAR(armazem->batalhas.campo);
+#define LIBERAR_COLUNA_MISSAO(campo, tipo) LIBERAR(armazem->missoes.campo);
+    COLUNAS_BATALHAS(LIBERAR_COLUNA_BATALHA)
+    COLUNAS_MISSOES(LIBERAR_COLUNA_MISSAO)
+#undef LIBERAR_COLUNA_MISSAO
+#undef LIBERAR_COLUNA_BATALHA
+    LIBERAR(armazem->nomesCores);
+    LIBERAR(armazem->idsCores);
+    LIBERAR(armazem);
+}
+
+// **** Fase de reforço: ****
+
+size_t calcularReforcos(ColocacaoTropas *lote, size_t capacidade)
+{
+    if (!indiceCoresDisponivel())
+        return 0;
+
+    // Os cursores de rodízio crescem junto com o número de cores.
+    if (capacidadeCursorReforco < indiceCores->numCores)
+    {
+        size_t *ampliado = (size_t *)REALOCAR(MEMORIA_INDICES, cursorReforco, indiceCores->numCores * sizeof(size_t));
+        if (ampliado == NULL)
+            return 0;
+        for (size_t c = capacidadeCursorReforco; c < indiceCores->numCores; c++)
+            ampliado[c] = 0;
+        cursorReforco = ampliado;
+        capacidadeCursorReforco = indiceCores->numCores;
+    }
+
+    int usaRegioes = regioes != NULL && regioes->posseValida;
+    size_t preenchidas = 0;
+
+    for (size_t c = 0; c < indiceCores->numCores && preenchidas < capacidade; c++)
+    {
+        size_t territorios = indiceCores->quantidade[c];
+        if (territorios == 0)
+            continue; // Cor eliminada: não recebe reforços.
+
+        size_t metade = territorios / 2;
+        int tropas = metade > REFORCO_MINIMO ? (metade > INT32_MAX / 2 ? INT32_MAX / 2 : (int)metade) : REFORCO_MINIMO;
+        if (usaRegioes && c < regioes->numCoresPosse)
+            tropas += regioes->bonusPorCor[c];
+
+        size_t posicao = cursorReforco[c] % territorios;
+        cursorReforco[c] = posicao + 1;
+
+        lote[preenchidas].territorio = indiceCores->membros[c][posicao];
+        lote[preenchidas].tropas = tropas;
+        lote[preenchidas].cor = (int)c;
+        preenchidas++;
+    }
+
+    return preenchidas;
+}
+
+void posicionarTropas(Territorio *mapa, const ColocacaoTropas *lote, size_t quantidade)
+{
+    for (size_t i = 0; i < quantidade; i++)
+    {
+        Territorio *territorio = &mapa[lote[i].territorio];
+        marcarTerritorioAlterado(territorio);
+        territorio->tropas += lote[i].tropas;
+        atualizarIndicesTerritorio(territorio);
+    }
+}
+
+void faseDeReforco(Territorio *mapa)
+{
+    RASTREAR_ESCOPO("faseDeReforco");
+
+    turnoAtual++;
+
+    if (!indiceCoresDisponivel())
+        return;
+
+    ColocacaoTropas *lote = (ColocacaoTropas *)ALOCAR(MEMORIA_TEMPORARIA, indiceCores->numCores * sizeof(ColocacaoTropas));
+    if (lote == NULL)
+    {
+        printf("\n ❌  Erro ao alocar memória para os reforços.\n");
+        return;
+    }
+
+    size_t quantidade = calcularReforcos(lote, indiceCores->numCores);
+    posicionarTropas(mapa, lote, quantidade);
+
+    printf("\n==== 🪖  REFORÇOS DO TURNO %d ====\n", turnoAtual);
+
+    size_t exibidas = quantidade < LINHAS_POR_PAGINA ? quantidade : LINHAS_POR_PAGINA;
+    for (size_t i = 0; i < exibidas; i++)
+    {
+        int c = lote[i].cor;
+        size_t regioesDominadas = regioes != NULL && regioes->posseValida ? regioes->regioesPorCor[c] : 0;
+        printf(" %s: +%d tropa(s) em %s (%zu território(s), %zu região(ões))\n", indiceCores->nomes[c], lote[i].tropas,
+               mapa[lote[i].territorio].nome, indiceCores->quantidade[c], regioesDominadas);
+    }
+    if (exibidas < quantidade)
+        printf(" ... (%zu exércitos reforçados)\n", quantidade);
+
+    LIBERAR(lote);
+}
+
+// **** Mapas fixos para partidas pequenas: ****
+
+Territorio *prepararMapaFixo(ArmazenamentoMapaFixo *armazenamento, size_t numTerritorios)
+{
+    // Cada capacidade gerada é testada em ordem crescente; a primeira que comporta o mapa é a escolhida.
+#define ESCOLHER_MAPA_FIXO(N)                                                                       \
+    if (mapaFixo.capacidade == 0 && numTerritorios <= (N))                                          \
+    {                                                                                               \
+        memset(&armazenamento->mapa##N, 0, sizeof(MapaFixo##N));                                    \
+        memset(armazenamento->mapa##N.corIds, COR_FIXA_VAZIA, sizeof(armazenamento->mapa##N.corIds)); \
+        mapaFixo.capacidade = (N);                                                                  \
+        mapaFixo.corIds = armazenamento->mapa##N.corIds;                                            \
+        mapaFixo.contar = contarMapaFixo##N;                                                        \
+        return armazenamento->mapa##N.territorios;                                                  \
+    }
+    CAPACIDADES_MAPA_FIXO(ESCOLHER_MAPA_FIXO)
+#undef ESCOLHER_MAPA_FIXO
+
+    return NULL;
+}
+
+void sincronizarCoresMapaFixo()
+{
+    if (mapaFixo.capacidade == 0 || !indiceCoresDisponivel())
+        return;
+
+    for (size_t i = 0; i < indiceCores->tamanho; i++)
+        mapaFixo.corIds[i] = (uint8_t)indiceCores->corDoTerritorio[i];
+}
+
+int mapaFixoDisponivel()
+{
+    return mapaFixo.capacidade != 0 && indiceCoresDisponivel();
+}
+
+// **** Gerador de mapas: ****
+
+void iniciarConfiguracaoGerador(ConfiguracaoGerador *config)
+{
+    memset(config, 0, sizeof(ConfiguracaoGerador));
+    config->numCores = 4;
+    config->distribuicao = DISTRIBUICAO_UNIFORME;
+    config->tropasMaximas = 10;
+    config->semente = 1;
+    config->territoriosPorRegiao = TERRITORIOS_POR_REGIAO;
+}
+
+int interpretarOpcaoGerador(int argc, char *argv[], int *i, ConfiguracaoGerador *config)
+{
+    const char *opcao = argv[*i];
+    if (strcmp(opcao, "--vizinhanca") == 0)
+    {
+        config->comVizinhanca = 1;
+        return 1;
+    }
+
+    if (*i + 1 >= argc)
+        return 0;
+
+    const char *valor = argv[*i + 1];
+    char *fimNumero;
+    unsigned long long numero = strtoull(valor, &fimNumero, 10);
+    int numerico = valor[0] >= '0' && valor[0] <= '9' && *fimNumero == '\0';
+
+    if (strcmp(opcao, "--gerar") == 0 && numerico && numero >= 2 && numero <= SIZE_MAX / sizeof(Territorio))
+        config->quantidade = (size_t)numero;
+    else if (strcmp(opcao, "--cores") == 0 && numerico && numero >= 2 && numero <= 1000)
+        config->numCores = (size_t)numero;
+    else if (strcmp(opcao, "--tropas-max") == 0 && numerico && numero >= 1 && numero <= 1000000)
+        config->tropasMaximas = (int)numero;
+    else if (strcmp(opcao, "--semente") == 0 && numerico)
+        config->semente = numero;
+    else if (strcmp(opcao, "--regiao") == 0 && numerico)
+        config->territoriosPorRegiao = (size_t)numero;
+    else if (strcmp(opcao, "--tropas") == 0 && strcmp(valor, "uniforme") == 0)
+        config->distribuicao = DISTRIBUICAO_UNIFORME;
+    else if (strcmp(opcao, "--tropas") == 0 && strcmp(valor, "enviesada") == 0)
+        config->distribuicao = DISTRIBUICAO_ENVIESADA;
+    else if (strcmp(opcao, "--tropas") == 0 && strcmp(valor, "zipf") == 0)
+        config->distribuicao = DISTRIBUICAO_ZIPF;
+    else if (strcmp(opcao, "--salvar") == 0)
+        config->arquivoSaida = valor;
+    else if (strcmp(opcao, "--carregar") == 0)
+        config->arquivoEntrada = valor;
+    else
+        return 0;
+
+    (*i)++;
+    return 1;
+}
+
+uint64_t misturarSplitMix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/// @brief Sorteio sem estado: depende só da semente, do território e do fluxo (nome, cor ou tropas).
+/// Por isso o resultado não muda com a divisão do trabalho entre threads.
+uint64_t sorteioGerador(uint64_t semente, uint64_t indice, uint64_t fluxo)
+{
+    return misturarSplitMix(semente ^ misturarSplitMix(indice * 4 + fluxo));
+}
+
+/// @brief Preenche um território gerado.
+void gerarTerritorio(const ConfiguracaoGerador *config, size_t id, Territorio *territorio)
+{
+    static const char *const silabas[16] = {"ka", "ra", "mon", "tar", "vel", "zu", "dor", "li",
+                                            "bra", "sen", "go", "ther", "nia", "pa", "qui", "ros"};
+    static const char *const cores[10] = {"azul", "verde", "vermelho", "amarelo", "preto",
+                                          "branco", "roxo", "laranja", "rosa", "cinza"};
+
+    // Zerado para que os arquivos gerados com a mesma semente sejam idênticos byte a byte.
+    memset(territorio, 0, sizeof(Territorio));
+
+    // O sufixo numérico garante nomes únicos no índice de nomes. Montado à mão: snprintf dominaria o tempo de geração.
+    uint64_t sorteio = sorteioGerador(config->semente, id, 0);
+    const char *primeira = silabas[sorteio & 15], *segunda = silabas[(sorteio >> 4) & 15];
+    size_t tamanhoPrimeira = strlen(primeira), tamanhoSegunda = strlen(segunda);
+    char digitos[20];
+    size_t numDigitos = 0;
+    for (size_t numero = id + 1; numero > 0; numero /= 10)
+        digitos[numDigitos++] = (char)('0' + numero % 10);
+
+    // Sílabas de até 4 letras e até 20 dígitos cabem em TAM_NOME.
+    char *nome = territorio->nome;
+    memcpy(nome, primeira, tamanhoPrimeira);
+    memcpy(nome + tamanhoPrimeira, segunda, tamanhoSegunda);
+    nome += tamanhoPrimeira + tamanhoSegunda;
+    *nome++ = ' ';
+    while (numDigitos > 0)
+        *nome++ = digitos[--numDigitos];
+    territorio->nome[0] = (char)(territorio->nome[0] - 'a' + 'A');
+
+    size_t cor = (size_t)(sorteioGerador(config->semente, id, 1) % config->numCores);
+    if (cor < 10)
+        memcpy(territorio->cor, cores[cor], strlen(cores[cor]));
+    else
+        snprintf(territorio->cor, TAM_COR, "cor%hu", (unsigned short)(cor + 1)); // Até 1000 cores.
+
+    // 32 bits aleatórios, escalados sem divisão.
+    uint64_t u = sorteioGerador(config->semente, id, 2) >> 32;
+    uint64_t maximo = (uint64_t)config->tropasMaximas;
+    switch (config->distribuicao)
+    {
+    case DISTRIBUICAO_UNIFORME:
+        territorio->tropas = 1 + (int)((u * maximo) >> 32);
+        break;
+    case DISTRIBUICAO_ENVIESADA:
+        // u² concentra os sorteios perto de zero.
+        territorio->tropas = 1 + (int)((((u * u) >> 32) * maximo) >> 32);
+        break;
+    case DISTRIBUICAO_ZIPF:
+    {
+        // Busca binária na distribuição acumulada.
+        double x = (double)u / 4294967296.0;
+        size_t baixo = 0, alto = maximo - 1;
+        while (baixo < alto)
+        {
+            size_t meio = (baixo + alto) / 2;
+            if (config->acumuladaZipf[meio] > x)
+                alto = meio;
+            else
+                baixo = meio + 1;
+        }
+        territorio->tropas = (int)baixo + 1;
+        break;
+    }
+    }
+}
+
+/// @brief Vizinhos de um território na grade de largura `largura`, em ordem crescente.
+/// @return Número de vizinhos (até 4).
+size_t vizinhosNaGrade(size_t id, size_t tamanho, size_t largura, size_t vizinhos[4])
+{
+    size_t quantidade = 0;
+    size_t coluna = id % largura;
+
+    if (id >= largura)
+        vizinhos[quantidade++] = id - largura;
+    if (coluna > 0)
+        vizinhos[quantidade++] = id - 1;
+    if (coluna + 1 < largura && id + 1 < tamanho)
+        vizinhos[quantidade++] = id + 1;
+    if (id + largura < tamanho)
+        vizinhos[quantidade++] = id + largura;
+
+    return quantidade;
+}
+
+/// @brief Menor largura de grade quadrada que comporta o mapa (raiz inteira, sem libm).
+size_t larguraGrade(size_t tamanho)
+{
+    size_t largura = 1;
+    while (largura * largura < tamanho)
+        largura++;
+    return largura;
+}
+
+void *gerarIntervalo(void *argumento)
+{
+    TarefaGerador *tarefa = (TarefaGerador *)argumento;
+    for (size_t i = tarefa->inicio; i < tarefa->fim; i++)
+        gerarTerritorio(tarefa->config, i, &tarefa->destino[i - tarefa->base]);
+    return NULL;
+}
+
+void *preencherVizinhosIntervalo(void *argumento)
+{
+    TarefaGerador *tarefa = (TarefaGerador *)argumento;
+    for (size_t i = tarefa->inicio; i < tarefa->fim; i++)
+        vizinhosNaGrade(i, tarefa->tamanhoMapa, tarefa->largura, &tarefa->vizinhos[tarefa->inicioVizinhos[i]]);
+    return NULL;
+}
+
+/// @brief Divide [inicio, fim) entre as threads disponíveis; a thread atual processa a primeira fatia.
+/// @return Número de threads usadas.
+size_t executarEmParalelo(void *(*tarefa)(void *), const TarefaGerador *modelo, size_t inicio, size_t fim)
+{
+    long processadores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t numThreads = processadores < 1 ? 1 : (size_t)processadores;
+    if (numThreads > MAX_THREADS_GERADOR)
+        numThreads = MAX_THREADS_GERADOR;
+    // Intervalos pequenos não compensam a criação de threads.
+    if ((fim - inicio) / 4096 < numThreads)
+        numThreads = (fim - inicio) / 4096 > 0 ? (fim - inicio) / 4096 : 1;
+
+    pthread_t threads[MAX_THREADS_GERADOR];
+    int criada[MAX_THREADS_GERADOR] = {0};
+    TarefaGerador tarefas[MAX_THREADS_GERADOR];
+
+    for (size_t t = 0; t < numThreads; t++)
+    {
+        tarefas[t] = *modelo;
+        tarefas[t].inicio = inicio + (fim - inicio) * t / numThreads;
+        tarefas[t].fim = inicio + (fim - inicio) * (t + 1) / numThreads;
+    }
+
+    for (size_t t = 1; t < numThreads; t++)
+        criada[t] = pthread_create(&threads[t], NULL, tarefa, &tarefas[t]) == 0;
+
+    // Fatias cujas threads não puderam ser criadas são processadas aqui mesmo.
+    for (size_t t = 0; t < numThreads; t++)
+        if (!criada[t])
+            tarefa(&tarefas[t]);
+
+    for (size_t t = 1; t < numThreads; t++)
+        if (criada[t])
+            pthread_join(threads[t], NULL);
+
+    return numThreads;
+}
+
+/// @brief Monta a distribuição acumulada de Zipf (s = 1) para 1..tropasMaximas tropas.
+double *prepararZipf(int tropasMaximas)
+{
+    double *acumulada = (double *)ALOCAR(MEMORIA_TEMPORARIA, (size_t)tropasMaximas * sizeof(double));
+    if (acumulada == NULL)
+        return NULL;
+
+    double soma = 0;
+    for (int k = 0; k < tropasMaximas; k++)
+    {
+        soma += 1.0 / (k + 1);
+        acumulada[k] = soma;
+    }
+    for (int k = 0; k < tropasMaximas; k++)
+        acumulada[k] /= soma;
+
+    return acumulada;
+}
+
+/// @brief Monta a vizinhança em grade do mapa, com o preenchimento dividido entre threads.
+GrafoVizinhanca *construirVizinhancaGrade(size_t tamanho)
+{
+    GrafoVizinhanca *grafo = (GrafoVizinhanca *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(GrafoVizinhanca));
+    if (grafo == NULL)
+        return NULL;
+
+    size_t largura = larguraGrade(tamanho);
+    size_t descartados[4];
+
+    grafo->numTerritorios = tamanho;
+    grafo->inicio = (size_t *)ALOCAR(MEMORIA_INDICES, (tamanho + 1) * sizeof(size_t));
+    if (grafo->inicio == NULL)
+    {
+        liberarVizinhanca(grafo);
+        return NULL;
+    }
+
+    grafo->inicio[0] = 0;
+    for (size_t i = 0; i < tamanho; i++)
+        grafo->inicio[i + 1] = grafo->inicio[i] + vizinhosNaGrade(i, tamanho, largura, descartados);
+    grafo->numEntradas = grafo->inicio[tamanho];
+
+    grafo->vizinhos = (size_t *)ALOCAR(MEMORIA_INDICES, grafo->numEntradas * sizeof(size_t));
+    if (grafo->vizinhos == NULL)
+    {
+        liberarVizinhanca(grafo);
+        return NULL;
+    }
+
+    TarefaGerador modelo = {.tamanhoMapa = tamanho, .largura = largura, .inicioVizinhos = grafo->inicio, .vizinhos = grafo->vizinhos};
+    executarEmParalelo(preencherVizinhosIntervalo, &modelo, 0, tamanho);
+    return grafo;
+}
+
+int gerarMapa(ConfiguracaoGerador *config, Territorio *mapa, size_t tamanho)
+{
+    uint64_t inicioNs = relogioNs();
+
+    double *acumulada = NULL;
+    if (config->distribuicao == DISTRIBUICAO_ZIPF)
+    {
+        acumulada = prepararZipf(config->tropasMaximas);
+        if (acumulada == NULL)
+        {
+            printf("\n ❌  Erro ao alocar memória para o gerador.\n");
+            return 0;
+        }
+        config->acumuladaZipf = acumulada;
+    }
+
+    TarefaGerador modelo = {.config = config, .destino = mapa, .base = 0, .tamanhoMapa = tamanho};
+    size_t threads = executarEmParalelo(gerarIntervalo, &modelo, 0, tamanho);
+    LIBERAR(acumulada);
+    config->acumuladaZipf = NULL;
+
+    // Sem memória para a vizinhança, o mapa segue sem ela.
+    if (config->comVizinhanca)
+    {
+        vizinhanca = construirVizinhancaGrade(tamanho);
+        if (vizinhanca == NULL)
+            printf("\n ⚠️  Sem memória para a vizinhança. O mapa seguirá sem fronteiras.\n");
+    }
+
+    printf("\n 🗺️  Mapa de %zu territórios gerado em %.1f ms (%zu thread(s), semente %llu).\n", tamanho,
+           (double)(relogioNs() - inicioNs) / 1e6, threads, (unsigned long long)config->semente);
+    return 1;
+}
+
+int gerarArquivoMapa(ConfiguracaoGerador *config)
+{
+    if (config->quantidade == 0)
+    {
+        printf("\n ❌  Informe o tamanho do mapa com --gerar N.\n");
+        return 0;
+    }
+
+    uint64_t inicioNs = relogioNs();
+    size_t tamanho = config->quantidade;
+    size_t largura = larguraGrade(tamanho);
+    size_t vizinhos[4];
+
+    CabecalhoArquivoMapa cabecalho = {.magica = "WARMAPA", .versao = VERSAO_ARQUIVO_MAPA, .tamanhoTerritorio = sizeof(Territorio), .numTerritorios = tamanho};
+    if (config->comVizinhanca)
+        for (size_t i = 0; i < tamanho; i++)
+            cabecalho.numEntradasVizinhanca += vizinhosNaGrade(i, tamanho, largura, vizinhos);
+
+    FILE *arquivo = fopen(config->arquivoSaida, "wb");
+    Territorio *bloco = (Territorio *)ALOCAR(MEMORIA_TEMPORARIA, BLOCO_ARQUIVO_MAPA * sizeof(Territorio));
+    uint64_t *valores = (uint64_t *)ALOCAR(MEMORIA_TEMPORARIA, BLOCO_ARQUIVO_MAPA * sizeof(uint64_t));
+    double *acumulada = config->distribuicao == DISTRIBUICAO_ZIPF ? prepararZipf(config->tropasMaximas) : NULL;
+    int sucesso = arquivo != NULL && bloco != NULL && valores != NULL && (acumulada != NULL || config->distribuicao != DISTRIBUICAO_ZIPF);
+    config->acumuladaZipf = acumulada;
+
+    sucesso = sucesso && fwrite(&cabecalho, sizeof(cabecalho), 1, arquivo) == 1;
+
+    // Territórios: cada bloco é gerado em paralelo e gravado antes do próximo.
+    for (size_t base = 0; sucesso && base < tamanho; base += BLOCO_ARQUIVO_MAPA)
+    {
+        size_t fim = base + BLOCO_ARQUIVO_MAPA < tamanho ? base + BLOCO_ARQUIVO_MAPA : tamanho;
+        TarefaGerador modelo = {.config = config, .destino = bloco, .base = base, .tamanhoMapa = tamanho};
+        executarEmParalelo(gerarIntervalo, &modelo, base, fim);
+        sucesso = fwrite(bloco, sizeof(Territorio), fim - base, arquivo) == fim - base;
+    }
+
+    // Vizinhança: primeiro os inícios (tamanho + 1 valores), depois os vizinhos, em 64 bits.
+    if (config->comVizinhanca)
+    {
+        size_t preenchidos = 0;
+        uint64_t deslocamento = 0;
+        for (size_t i = 0; sucesso && i <= tamanho; i++)
+        {
+            valores[preenchidos++] = deslocamento;
+            if (i < tamanho)
+                deslocamento += vizinhosNaGrade(i, tamanho, largura, vizinhos);
+            if (preenchidos == BLOCO_ARQUIVO_MAPA || i == tamanho)
+            {
+                sucesso = fwrite(valores, sizeof(uint64_t), preenchidos, arquivo) == preenchidos;
+                preenchidos = 0;
+            }
+        }
+
+        for (size_t i = 0; sucesso && i < tamanho; i++)
+        {
+            size_t quantidade = vizinhosNaGrade(i, tamanho, largura, vizinhos);
+            for (size_t k = 0; k < quantidade; k++)
+                valores[preenchidos++] = vizinhos[k];
+            if (preenchidos + 4 > BLOCO_ARQUIVO_MAPA || i + 1 == tamanho)
+            {
+                sucesso = fwrite(valores, sizeof(uint64_t), preenchidos, arquivo) == preenchidos;
+                preenchidos = 0;
+            }
+        }
+    }
+
+    if (arquivo != NULL && fclose(arquivo) != 0)
+        sucesso = 0;
+    LIBERAR(bloco);
+    LIBERAR(valores);
+    LIBERAR(acumulada);
+    config->acumuladaZipf = NULL;
+
+    if (!sucesso)
+    {
+        printf("\n ❌  Erro ao gravar o mapa em %s.\n", config->arquivoSaida);
+        return 0;
+    }
+
+    printf("\n 🗺️  Mapa de %zu territórios gravado em %s em %.1f ms (semente %llu).\n", tamanho, config->arquivoSaida,
+           (double)(relogioNs() - inicioNs) / 1e6, (unsigned long long)config->semente);
+    return 1;
+}
+
+FILE *abrirArquivoMapa(const char *caminho, CabecalhoArquivoMapa *cabecalho)
+{
+    FILE *arquivo = fopen(caminho, "rb");
+    if (arquivo == NULL)
+    {
+        printf("\n ❌  Não foi possível abrir o mapa %s.\n", caminho);
+        return NULL;
+    }
+
+    if (fread(cabecalho, sizeof(CabecalhoArquivoMapa), 1, arquivo) != 1 || memcmp(cabecalho->magica, "WARMAPA", 8) != 0 ||
+        cabecalho->versao != VERSAO_ARQUIVO_MAPA || cabecalho->tamanhoTerritorio != sizeof(Territorio))
+    {
+        printf("\n ❌  %s não é um mapa gerado por esta versão do jogo.\n", caminho);
+        fclose(arquivo);
+        return NULL;
+    }
+
+    if (cabecalho->numTerritorios < 2 || cabecalho->numTerritorios > SIZE_MAX / sizeof(Territorio) ||
+        cabecalho->numEntradasVizinhanca > SIZE_MAX / sizeof(size_t))
+    {
+        printf("\n ❌  O mapa %s tem um tamanho inválido.\n", caminho);
+        fclose(arquivo);
+        return NULL;
+    }
+
+    return arquivo;
+}
+
+int carregarArquivoMapa(FILE *arquivo, const CabecalhoArquivoMapa *cabecalho, Territorio *mapa)
+{
+    size_t tamanho = (size_t)cabecalho->numTerritorios;
+
+    // Os territórios vão direto para o mapa, bloco a bloco.
+    for (size_t base = 0; base < tamanho; base += BLOCO_ARQUIVO_MAPA)
+    {
+        size_t quantidade = tamanho - base < BLOCO_ARQUIVO_MAPA ? tamanho - base : BLOCO_ARQUIVO_MAPA;
+        if (fread(&mapa[base], sizeof(Territorio), quantidade, arquivo) != quantidade)
+        {
+            printf("\n ❌  O arquivo do mapa está truncado.\n");
+            return 0;
+        }
+
+        // Um arquivo corrompido não pode deixar textos sem terminador.
+        for (size_t i = base; i < base + quantidade; i++)
+        {
+            mapa[i].nome[TAM_NOME - 1] = '\0';
+            mapa[i].cor[TAM_COR - 1] = '\0';
+            if (mapa[i].tropas < 0)
+                mapa[i].tropas = 0;
+        }
+    }
+
+    if (cabecalho->numEntradasVizinhanca == 0)
+        return 1;
+
+    GrafoVizinhanca *grafo = (GrafoVizinhanca *)ALOCAR_ZERADO(MEMORIA_INDICES, 1, sizeof(GrafoVizinhanca));
+    uint64_t *valores = (uint64_t *)ALOCAR(MEMORIA_TEMPORARIA, BLOCO_ARQUIVO_MAPA * sizeof(uint64_t));
+    if (grafo != NULL)
+    {
+        grafo->numTerritorios = tamanho;
+        grafo->numEntradas = (size_t)cabecalho->numEntradasVizinhanca;
+        grafo->inicio = (size_t *)ALOCAR(MEMORIA_INDICES, (tamanho + 1) * sizeof(size_t));
+        grafo->vizinhos = (size_t *)ALOCAR(MEMORIA_INDICES, grafo->numEntradas * sizeof(size_t));
+    }
+    if (grafo == NULL || valores == NULL || grafo->inicio == NULL || grafo->vizinhos == NULL)
+    {
+        liberarVizinhanca(grafo);
+        LIBERAR(valores);
+        printf("\n ⚠️  Sem memória para a vizinhança. O mapa seguirá sem fronteiras.\n");
+        return 1;
+    }
+
+    // Inícios crescentes até o total de entradas, e vizinhos dentro do mapa: o resto do jogo confia nisso.
+    int valido = 1;
+    for (size_t base = 0; valido && base < tamanho + 1; base += BLOCO_ARQUIVO_MAPA)
+    {
+        size_t quantidade = tamanho + 1 - base < BLOCO_ARQUIVO_MAPA ? tamanho + 1 - base : BLOCO_ARQUIVO_MAPA;
+        valido = fread(valores, sizeof(uint64_t), quantidade, arquivo) == quantidade;
+        for (size_t k = 0; valido && k < quantidade; k++)
+        {
+            grafo->inicio[base + k] = (size_t)valores[k];
+            valido = valores[k] <= grafo->numEntradas && (base + k == 0 ? valores[k] == 0 : grafo->inicio[base + k] >= grafo->inicio[base + k - 1]);
+        }
+    }
+    valido = valido && grafo->inicio[tamanho] == grafo->numEntradas;
+
+    for (size_t base = 0; valido && base < grafo->numEntradas; base += BLOCO_ARQUIVO_MAPA)
+    {
+        size_t quantidade = grafo->numEntradas - base < BLOCO_ARQUIVO_MAPA ? grafo->numEntradas - base : BLOCO_ARQUIVO_MAPA;
+        valido = fread(valores, sizeof(uint64_t), quantidade, arquivo) == quantidade;
+        for (size_t k = 0; valido && k < quantidade; k++)
+        {
+            grafo->vizinhos[base + k] = (size_t)valores[k];
+            valido = valores[k] < tamanho;
+        }
+    }
+    LIBERAR(valores);
+
+    if (!valido)
+    {
+        liberarVizinhanca(grafo);
+        printf("\n ⚠️  A vizinhança do arquivo é inválida. O mapa seguirá sem fronteiras.\n");
+        return 1;
+    }
+
+    vizinhanca = grafo;
+    return 1;
+}
+
+int fazFronteira(size_t a, size_t b, size_t tamanho)
+{
+    if (vizinhanca == NULL || vizinhanca->numTerritorios != tamanho)
+        return 1;
+
+    // Os graus são pequenos (4 na grade, até 6 no mapa clássico): a lista de vizinhos é varrida direto.
+    for (size_t e = vizinhanca->inicio[a]; e < vizinhanca->inicio[a + 1]; e++)
+        if (vizinhanca->vizinhos[e] == b)
+            return 1;
+    return 0;
+}
+
+void liberarVizinhanca(GrafoVizinhanca *grafo)
+{
+    if (grafo == NULL)
+        return;
+
+    LIBERAR(grafo->inicio);
+    LIBERAR(grafo->vizinhos);
+    LIBERAR(grafo);
+}
+
+// **** Eventos do núcleo do jogo: ****
+
+int registrarOuvinte(OuvinteEvento ouvinte, void *contexto)
+{
+    if (numOuvintes == MAX_OUVINTES)
+        return 0;
+
+    ouvintesEventos[numOuvintes] = ouvinte;
+    contextosOuvintes[numOuvintes] = contexto;
+    numOuvintes++;
+    return 1;
+}
+
+void removerOuvinte(OuvinteEvento ouvinte, void *contexto)
+{
+    for (int i = 0; i < numOuvintes; i++)
+    {
+        if (ouvintesEventos[i] == ouvinte && contextosOuvintes[i] == contexto)
+        {
+            // Mantém a ordem de registro dos demais ouvintes.
+            memmove(&ouvintesEventos[i], &ouvintesEventos[i + 1], (size_t)(numOuvintes - i - 1) * sizeof(OuvinteEvento));
+            memmove(&contextosOuvintes[i], &contextosOuvintes[i + 1], (size_t)(numOuvintes - i - 1) * sizeof(void *));
+            numOuvintes--;
+            return;
+        }
+    }
+}
+
+int haOuvintes()
+{
+    return numOuvintes;
+}
+
+void prepararEvento(EventoJogo *evento, TipoEvento tipo, const Territorio *atacante, const Territorio *defensor)
+{
+    memset(evento, 0, sizeof(EventoJogo));
+    evento->tipo = tipo;
+
+    if (atacante != NULL)
+    {
+        memcpy(evento->nomeAtacante, atacante->nome, TAM_NOME);
+        memcpy(evento->corAtacante, atacante->cor, TAM_COR);
+        evento->tropasAtacante = atacante->tropas;
+    }
+    if (defensor != NULL)
+    {
+        memcpy(evento->nomeDefensor, defensor->nome, TAM_NOME);
+        memcpy(evento->corDefensor, defensor->cor, TAM_COR);
+        evento->tropasDefensor = defensor->tropas;
+    }
+}
+
+void emitirEvento(const EventoJogo *evento)
+{
+    for (int i = 0; i < numOuvintes; i++)
+        ouvintesEventos[i](evento, contextosOuvintes[i]);
+}
+
+void imprimirEventoTerminal(const EventoJogo *evento, void *contexto)
+{
+    // O contexto é o arquivo de saída; sem ele, o terminal.
+    FILE *saida = contexto != NULL ? (FILE *)contexto : stdout;
+
+    switch (evento->tipo)
+    {
+    case EVENTO_ATAQUE_INVALIDO:
+        if (evento->motivo == ATAQUE_ALIADO)
+            fprintf(saida, "\n ⚠️  Aviso: Você não pode atacar um território aliado!.\n");
+        else if (evento->motivo == ATAQUE_SEM_FRONTEIRA)
+            fprintf(saida, "\n ⚠️  Aviso: %s não faz fronteira com %s.\n", evento->nomeAtacante, evento->nomeDefensor);
+        else
+            fprintf(saida, "\n ⚠️  Aviso: O território atacante precisa de pelo menos 2 tropas para atacar.\n");
+        break;
+    case EVENTO_DADOS_ROLADOS:
+        fprintf(saida, "\n==== RESULTADO DO ATAQUE ====\n");
+        fprintf(saida, "\n ⚔️  Ataque de %s (%d tropas) contra 🛡️  defesa de %s (%d tropas)\n", evento->nomeAtacante, evento->tropasAtacante, evento->nomeDefensor, evento->tropasDefensor);
+        fprintf(saida, "\n 🎲  Rolagem da dados: atacante => %d | defensor => %d\n", evento->dadoAtacante, evento->dadoDefensor);
+        break;
+    case EVENTO_TROPA_PERDIDA:
+        if (evento->motivo == LADO_DEFENSOR)
+            fprintf(saida, "\n ⚔️  Ataque bem-sucedido! O defensor perde 1 tropa.\n");
+        else
+            fprintf(saida, "\n 🛡️  Defesa bem-sucedida! O atacante perde 1 tropa.\n");
+        break;
+    case EVENTO_TERRITORIO_CONQUISTADO:
+        fprintf(saida, "\n Essa batalha foi vencida pelo atacante. Mas ainda falta vencer a guerra... \n");
+        fprintf(saida, "\nO território %s agora pertence a %s com %d tropa(s).\n", evento->nomeDefensor, evento->nomeAtacante, evento->tropasDefensor);
+        break;
+    case EVENTO_MISSAO_CUMPRIDA:
+        switch ((TipoMissao)evento->motivo)
+        {
+        case MISSAO_ELIMINAR_COR:
+            fprintf(saida, "\n🎉 O exército %s eliminou todas as tropas da cor %s!\n", evento->corAtacante, evento->corDefensor);
+            break;
+        case MISSAO_CONQUISTAR:
+            fprintf(saida, "\n🎉  O exército %s conquistou %zu territórios!\n", evento->corAtacante, evento->quantidade);
+            break;
+        case MISSAO_TROPAS_MINIMAS:
+            fprintf(saida, "\n 🎉  O exército %s controla %zu territórios com %d tropa(s) ou mais!\n", evento->corAtacante, evento->quantidade, evento->calcTropas);
+            break;
+        case MISSAO_TROPAS_MAXIMAS:
+            fprintf(saida, "\n 🎉  O exército %s controla %zu territórios com %d tropa(s) ou menos!\n", evento->corAtacante, evento->quantidade, evento->calcTropas);
+            break;
+        case MISSAO_TROPAS_EXATAS:
+            fprintf(saida, "\n 🎉  O exército %s controla %zu territórios com exatamente %d tropas!\n", evento->corAtacante, evento->quantidade, evento->calcTropas);
+            break;
+        case MISSAO_DOMINAR_REGIAO:
+            fprintf(saida, "\n 🎉  O exército %s domina a região %s!\n", evento->corAtacante, evento->nomeDefensor);
+            break;
+        case MISSAO_DOMINAR_REGIOES:
+            fprintf(saida, "\n 🎉  O exército %s domina %zu regiões!\n", evento->corAtacante, evento->quantidade);
+            break;
+        }
+        break;
+    case EVENTO_MISSAO_FRACASSADA:
+        fprintf(saida, "\n  ⚠️  A missão fracassou para %s, cor %s ! Embora tenha ocupado os territórios almejados, os requisitos de tropas não foram atendidos.\n",
+               evento->nomeDefensor, evento->corDefensor);
+        break;
+    }
+}
+
+uint64_t hashTexto(const char *texto)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *c = (const unsigned char *)texto; *c != '\0'; c++)
+    {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
 
 // **** Funções utilitárias: ****
 
-void limparBufferEntrada()
+void limparBufferEntrada()
+{
+    int c;
+    while ((c = getchar()) != '\n' && c != EOF)
+        ;
+}
+
+void limparEnter(char *str)
+{
+    str[strcspn(str, "\n")] = '\0';
+}
+
+size_t sortearIndice(size_t limite)
+{
+    // rand() fornece ao menos 15 bits por chamada. Combinamos chamadas até cobrir 64 bits.
+    unsigned long long valor = 0;
+    for (int bits = 0; bits < 64; bits += 15)
+        valor = (valor << 15) ^ (unsigned long long)(rand() & 0x7FFF);
+
+    return (size_t)(valor % limite);
+}
+
+// **** Rastro da linha do tempo (trace-event do Chrome/Perfetto): ****
+
+int ativarRastro(const char *caminho)
+{
+    if (strlen(caminho) >= sizeof(caminhoRastro))
+        return 0;
+
+    strcpy(caminhoRastro, caminho);
+    origemRastroNs = relogioNs();
+    rastroAtivo = 1;
+
+    // Também cobre as saídas antecipadas de main().
+    atexit(finalizarRastro);
+    return 1;
+}
+
+uint64_t relogioNs()
+{
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return (uint64_t)agora.tv_sec * 1000000000ULL + (uint64_t)agora.tv_nsec;
+}
+
+TrechoRastro iniciarTrecho(const char *nome)
+{
+    TrechoRastro trecho = {nome, 0};
+    if (rastroAtivo)
+        trecho.inicioNs = relogioNs();
+    return trecho;
+}
+
+void encerrarTrecho(TrechoRastro *trecho)
+{
+    if (trecho->inicioNs == 0 || !rastroAtivo)
+        return;
+
+    uint64_t fimNs = relogioNs();
+    BufferRastro *buffer = bufferRastroLocal;
+
+    // Primeiro trecho da thread: cria o buffer e o publica na lista global.
+    if (buffer == NULL)
+    {
+        buffer = (BufferRastro *)ALOCAR_ZERADO(MEMORIA_RASTRO, 1, sizeof(BufferRastro));
+        if (buffer == NULL)
+            return;
+
+        buffer->tid = atomic_fetch_add(&proximoTidRastro, 1);
+        buffer->proximo = atomic_load(&buffersRastro);
+        while (!atomic_compare_exchange_weak(&buffersRastro, &buffer->proximo, buffer))
+            ;
+        bufferRastroLocal = buffer;
+    }
+
+    if (buffer->atual == NULL || buffer->atual->quantidade == EVENTOS_POR_BLOCO_RASTRO)
+    {
+        BlocoRastro *bloco = (BlocoRastro *)ALOCAR(MEMORIA_RASTRO, sizeof(BlocoRastro));
+        if (bloco == NULL)
+            return; // Sem memória, o trecho é descartado.
+
+        bloco->quantidade = 0;
+        bloco->proximo = NULL;
+        if (buffer->atual == NULL)
+            buffer->primeiro = bloco;
+        else
+            buffer->atual->proximo = bloco;
+        buffer->atual = bloco;
+    }
+
+    EventoRastro *evento = &buffer->atual->eventos[buffer->atual->quantidade++];
+    evento->nome = trecho->nome;
+    evento->inicioNs = trecho->inicioNs;
+    evento->duracaoNs = fimNs - trecho->inicioNs;
+}
+
+void finalizarRastro()
+{
+    if (!rastroAtivo)
+        return;
+    rastroAtivo = 0;
+
+    FILE *arquivo = fopen(caminhoRastro, "w");
+    if (arquivo == NULL)
+        printf("\n ⚠️  Não foi possível gravar o rastro em %s.\n", caminhoRastro);
+
+    size_t totalEventos = 0;
+    if (arquivo != NULL)
+        fprintf(arquivo, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    BufferRastro *buffer = atomic_exchange(&buffersRastro, NULL);
+    while (buffer != NULL)
+    {
+        BlocoRastro *bloco = buffer->primeiro;
+        while (bloco != NULL)
+        {
+            // Tempos em microssegundos desde a ativação do rastro, como espera o formato.
+            for (size_t i = 0; arquivo != NULL && i < bloco->quantidade; i++)
+            {
+                const EventoRastro *evento = &bloco->eventos[i];
+                fprintf(arquivo, "%s{\"name\":\"%s\",\"cat\":\"war\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        totalEventos++ == 0 ? "" : ",\n", evento->nome, buffer->tid,
+                        (double)(evento->inicioNs - origemRastroNs) / 1000.0, (double)evento->duracaoNs / 1000.0);
+            }
+
+            BlocoRastro *proximo = bloco->proximo;
+            LIBERAR(bloco);
+            bloco = proximo;
+        }
+
+        BufferRastro *proximo = buffer->proximo;
+        LIBERAR(buffer);
+        buffer = proximo;
+    }
+    bufferRastroLocal = NULL;
+
+    if (arquivo != NULL)
+    {
+        fprintf(arquivo, "\n]}\n");
+        fclose(arquivo);
+        printf("\n 🧭  Rastro com %zu trecho(s) gravado em %s.\n", totalEventos, caminhoRastro);
+    }
+}
+
+// **** Espectadores (memória compartilhada com seqlock): ****
+
+size_t tamanhoRegiaoEspectador(size_t capacidadeTerritorios, size_t capacidadeJogadores)
+{
+    return sizeof(CabecalhoEspectador) + capacidadeJogadores * sizeof(MissaoEspectador) + capacidadeTerritorios * sizeof(Territorio);
+}
+
+int montarNomeEspectador(char *destino, const char *partida)
+{
+    if (partida[0] == '\0' || strchr(partida, '/') != NULL)
+        return 0;
+    return snprintf(destino, TAM_NOME_ESPECTADOR, "%s%s", PREFIXO_MEMORIA_ESPECTADOR, partida) < TAM_NOME_ESPECTADOR;
+}
+
+int criarEspectadores(size_t numTerritorios, size_t jogadores)
 {
-    int c;
-    while ((c = getchar()) != '\n' && c != EOF)
-        ;
+    if (numTerritorios > UINT32_MAX || jogadores > UINT32_MAX)
+        return 0;
+
+    char pid[24];
+    snprintf(pid, sizeof(pid), "%ld", (long)getpid());
+    if (!montarNomeEspectador(nomeEspectadores, nomePartida != NULL ? nomePartida : pid))
+    {
+        printf("\n ⚠️  Nome de partida inválido: %s. A partida seguirá sem espectadores.\n", nomePartida);
+        return 0;
+    }
+
+    // Uma região com o nosso PID só pode ser resto de um processo que já terminou mal: é descartada, e leitores
+    // antigos mantêm a sua cópia. Um nome escolhido com --partida nunca remove a região de outra partida.
+    if (nomePartida == NULL)
+        shm_unlink(nomeEspectadores);
+    int descritor = shm_open(nomeEspectadores, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (descritor < 0)
+    {
+        if (errno == EEXIST)
+            printf("\n ⚠️  Já existe uma partida chamada %s. A partida seguirá sem espectadores.\n", nomePartida);
+        else
+            printf("\n ⚠️  Não foi possível criar a memória dos espectadores. A partida seguirá sem espectadores.\n");
+        return 0;
+    }
+
+    size_t tamanho = tamanhoRegiaoEspectador(numTerritorios, jogadores);
+    void *regiao = MAP_FAILED;
+    if (ftruncate(descritor, (off_t)tamanho) == 0)
+        regiao = mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED, descritor, 0);
+    close(descritor);
+
+    if (regiao == MAP_FAILED)
+    {
+        shm_unlink(nomeEspectadores);
+        printf("\n ⚠️  Não foi possível mapear a memória dos espectadores. A partida seguirá sem espectadores.\n");
+        return 0;
+    }
+
+    // A região nasce zerada: sequência par, nada publicado ainda.
+    espectadores = (CabecalhoEspectador *)regiao;
+    tamanhoEspectadores = tamanho;
+    espectadores->capacidadeTerritorios = (uint32_t)numTerritorios;
+    espectadores->capacidadeJogadores = (uint32_t)jogadores;
+    espectadores->vencedor = -1;
+
+    // Um leitor pode abrir a região logo após o ftruncate(): só confia no cabeçalho depois de ver a marca.
+    atomic_store_explicit(&espectadores->pronto, MAGICA_ESPECTADOR, memory_order_release);
+
+    // Cobre também as saídas antecipadas de main().
+    atexit(encerrarEspectadores);
+    printf("\n 👀  Para acompanhar esta partida: --espectador %s\n", nomePartida != NULL ? nomePartida : pid);
+    return 1;
 }
 
-void limparEnter(char *str)
+void publicarEspectadores(const Territorio *mapa, size_t tamanho, int vencedor)
 {
-    str[strcspn(str, "\n")] = '\0';
+    if (espectadores == NULL)
+        return;
+
+    MissaoEspectador *missoesPublicadas = (MissaoEspectador *)(espectadores + 1);
+    Territorio *territoriosPublicados = (Territorio *)(missoesPublicadas + espectadores->capacidadeJogadores);
+    size_t jogadores = numJogadores < espectadores->capacidadeJogadores ? numJogadores : espectadores->capacidadeJogadores;
+    if (tamanho > espectadores->capacidadeTerritorios)
+        tamanho = espectadores->capacidadeTerritorios;
+
+    // Seqlock: sequência ímpar durante a escrita. Leitores que a virem ímpar, ou alterada ao fim da cópia, repetem a leitura.
+    uint64_t sequencia = atomic_load_explicit(&espectadores->sequencia, memory_order_relaxed);
+    atomic_store_explicit(&espectadores->sequencia, sequencia + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    espectadores->publicacao++;
+    espectadores->turno = turnoAtual;
+    espectadores->numTerritorios = (uint32_t)tamanho;
+    espectadores->numJogadores = (uint32_t)jogadores;
+    espectadores->vencedor = vencedor;
+    memcpy(territoriosPublicados, mapa, tamanho * sizeof(Territorio));
+
+    // O progresso vem dos agregados por cor, sem varrer o mapa nem emitir eventos.
+    for (size_t j = 0; j < jogadores; j++)
+    {
+        const MissaoJogador *missao = &missoesJogadores[j];
+        MissaoEspectador *publicada = &missoesPublicadas[j];
+        int avaliada;
+        int cumprida = avaliarMissaoPorAgregados(missao, &avaliada);
+        int cor = indiceCoresDisponivel() ? buscarCor(indiceCores, missao->cor) : -1;
+
+        snprintf(publicada->cor, TAM_COR, "%s", missao->cor);
+        snprintf(publicada->missao, TAM_MISSAO_ESPECTADOR, "%s", missao->texto);
+        publicada->estado = avaliada ? cumprida : -1;
+        publicada->territorios = cor < 0 ? 0 : (uint32_t)indiceCores->quantidade[cor];
+    }
+
+    atomic_store_explicit(&espectadores->sequencia, sequencia + 2, memory_order_release);
+}
+
+void encerrarEspectadores()
+{
+    if (espectadores == NULL)
+        return;
+
+    atomic_store_explicit(&espectadores->encerrado, 1, memory_order_release);
+    munmap(espectadores, tamanhoEspectadores);
+    shm_unlink(nomeEspectadores);
+    espectadores = NULL;
+    tamanhoEspectadores = 0;
+}
+
+int acompanharPartida(const char *partida)
+{
+    struct timespec intervalo = {0, 200000000L}; // 200 ms entre consultas.
+    int descritor = -1;
+    struct stat informacoes;
+    char nome[TAM_NOME_ESPECTADOR];
+
+    if (!montarNomeEspectador(nome, partida))
+    {
+        printf("\n ❌  Partida inválida: %s. Use o PID ou o nome exibido pelo jogo.\n", partida);
+        return EXIT_FAILURE;
+    }
+
+    // Aguarda até 30 segundos por uma partida em andamento.
+    printf("\n 👀  Procurando uma partida em andamento...\n");
+    for (int tentativa = 0; tentativa < 150; tentativa++)
+    {
+        descritor = shm_open(nome, O_RDONLY, 0);
+        if (descritor >= 0 && fstat(descritor, &informacoes) == 0 && (size_t)informacoes.st_size >= sizeof(CabecalhoEspectador))
+            break;
+        if (descritor >= 0)
+            close(descritor);
+        descritor = -1;
+        nanosleep(&intervalo, NULL);
+    }
+    if (descritor < 0)
+    {
+        printf("\n ❌  Nenhuma partida %s encontrada.\n", partida);
+        return EXIT_FAILURE;
+    }
+
+    size_t tamanhoRegiao = (size_t)informacoes.st_size;
+    const CabecalhoEspectador *cabecalho = (const CabecalhoEspectador *)mmap(NULL, tamanhoRegiao, PROT_READ, MAP_SHARED, descritor, 0);
+    close(descritor);
+    if ((void *)cabecalho == MAP_FAILED)
+    {
+        printf("\n ❌  Não foi possível mapear a partida.\n");
+        return EXIT_FAILURE;
+    }
+
+    // A região pode existir antes de o cabeçalho ser preenchido: aguarda a marca gravada por último.
+    int pronto = 0;
+    for (int espera = 0; espera < ESPERAS_PRONTO_ESPECTADOR && !pronto; espera++)
+    {
+        pronto = atomic_load_explicit(&cabecalho->pronto, memory_order_acquire) == MAGICA_ESPECTADOR;
+        if (!pronto)
+            nanosleep(&intervalo, NULL);
+    }
+    if (!pronto)
+    {
+        munmap((void *)cabecalho, tamanhoRegiao);
+        printf("\n ❌  A partida não terminou de preparar a memória dos espectadores.\n");
+        return EXIT_FAILURE;
+    }
+
+    // As capacidades são gravadas antes da marca e nunca mudam.
+    size_t capacidadeJogadores = cabecalho->capacidadeJogadores, capacidadeTerritorios = cabecalho->capacidadeTerritorios;
+    if (tamanhoRegiaoEspectador(capacidadeTerritorios, capacidadeJogadores) > tamanhoRegiao)
+    {
+        munmap((void *)cabecalho, tamanhoRegiao);
+        printf("\n ❌  A memória da partida está incompleta.\n");
+        return EXIT_FAILURE;
+    }
+
+    const MissaoEspectador *missoesPublicadas = (const MissaoEspectador *)(cabecalho + 1);
+    const Territorio *territoriosPublicados = (const Territorio *)(missoesPublicadas + capacidadeJogadores);
+
+    // Cópia local onde cada instantâneo consistente é montado.
+    CabecalhoEspectador copia;
+    MissaoEspectador *missoes = (MissaoEspectador *)ALOCAR(MEMORIA_TEMPORARIA, (capacidadeJogadores + 1) * sizeof(MissaoEspectador));
+    Territorio *mapa = (Territorio *)ALOCAR(MEMORIA_TEMPORARIA, (capacidadeTerritorios + 1) * sizeof(Territorio));
+    if (missoes == NULL || mapa == NULL)
+    {
+        LIBERAR(missoes);
+        LIBERAR(mapa);
+        munmap((void *)cabecalho, tamanhoRegiao);
+        printf("\n ❌  Erro ao alocar memória para o espectador.\n");
+        return EXIT_FAILURE;
+    }
+
+    struct timespec pausaLeitura = {0, 1000000L}; // 1 ms entre releituras lentas.
+    uint64_t ultimaPublicacao = 0;
+    int encerrado = 0, consistente = 1;
+    while (!encerrado && consistente)
+    {
+        encerrado = atomic_load_explicit(&cabecalho->encerrado, memory_order_acquire);
+
+        // Leitura do seqlock: repete até obter uma cópia que nenhuma escrita atravessou. Depois de algumas releituras
+        // rápidas, cada uma espera 1 ms; um escritor que morreu no meio da escrita encerra o espectador.
+        uint64_t antes, depois;
+        consistente = 0;
+        for (int tentativa = 0; tentativa < TENTATIVAS_LEITURA_ESPECTADOR && !consistente; tentativa++)
+        {
+            if (tentativa >= TENTATIVAS_RAPIDAS_ESPECTADOR)
+                nanosleep(&pausaLeitura, NULL);
+
+            antes = atomic_load_explicit(&cabecalho->sequencia, memory_order_acquire);
+            if (antes & 1)
+                continue;
+
+            copia.publicacao = cabecalho->publicacao;
+            copia.turno = cabecalho->turno;
+            copia.numTerritorios = cabecalho->numTerritorios;
+            copia.numJogadores = cabecalho->numJogadores;
+            copia.vencedor = cabecalho->vencedor;
+            if (copia.numTerritorios > capacidadeTerritorios || copia.numJogadores > capacidadeJogadores)
+                continue;
+            memcpy(missoes, missoesPublicadas, copia.numJogadores * sizeof(MissaoEspectador));
+            memcpy(mapa, territoriosPublicados, copia.numTerritorios * sizeof(Territorio));
+
+            atomic_thread_fence(memory_order_acquire);
+            depois = atomic_load_explicit(&cabecalho->sequencia, memory_order_relaxed);
+            consistente = antes == depois;
+        }
+        if (!consistente)
+            break;
+
+        if (copia.publicacao != ultimaPublicacao)
+        {
+            ultimaPublicacao = copia.publicacao;
+            printf("\n==== 👀  ESPECTADOR - PUBLICAÇÃO %llu, TURNO %u ====\n", (unsigned long long)copia.publicacao, copia.turno);
+            exibirMapa(mapa, copia.numTerritorios);
+
+            printf("\n%-10s Territórios  %s\n", "Cor", "Missão");
+            for (size_t j = 0; j < copia.numJogadores; j++)
+                printf("%-10s %-12u %s %s\n", missoes[j].cor, missoes[j].territorios, missoes[j].missao,
+                       missoes[j].estado > 0 ? "✅" : missoes[j].estado == 0 ? "⏳" : "❔");
+            if (copia.vencedor >= 0 && (size_t)copia.vencedor < copia.numJogadores)
+                printf("\n 🎉  O exército %s venceu o jogo!\n", missoes[copia.vencedor].cor);
+            fflush(stdout);
+        }
+
+        if (!encerrado)
+            nanosleep(&intervalo, NULL);
+    }
+
+    if (consistente)
+        printf("\n====  A partida foi encerrada. ====\n");
+    else
+        printf("\n ❌  A partida parou de responder no meio de uma publicação.\n");
+    LIBERAR(missoes);
+    LIBERAR(mapa);
+    munmap((void *)cabecalho, tamanhoRegiao);
+    return consistente ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// **** Modo com threads (filas SPSC entre motor, entrada e exibição): ****
+
+int enfileirarSPSC(FilaSPSC *fila, const void *elemento)
+{
+    size_t cabeca = atomic_load_explicit(&fila->cabeca, memory_order_relaxed);
+    if (cabeca - atomic_load_explicit(&fila->cauda, memory_order_acquire) == fila->capacidade)
+        return 0;
+
+    memcpy(fila->elementos + (cabeca & (fila->capacidade - 1)) * fila->tamanhoElemento, elemento, fila->tamanhoElemento);
+    atomic_store_explicit(&fila->cabeca, cabeca + 1, memory_order_release);
+    return 1;
+}
+
+int desenfileirarSPSC(FilaSPSC *fila, void *elemento)
+{
+    size_t cauda = atomic_load_explicit(&fila->cauda, memory_order_relaxed);
+    if (cauda == atomic_load_explicit(&fila->cabeca, memory_order_acquire))
+        return 0;
+
+    memcpy(elemento, fila->elementos + (cauda & (fila->capacidade - 1)) * fila->tamanhoElemento, fila->tamanhoElemento);
+    atomic_store_explicit(&fila->cauda, cauda + 1, memory_order_release);
+    return 1;
+}
+
+/// @brief Escrita do fluxo de saída do motor: fatia o texto em mensagens da fila de exibição.
+/// Com a fila cheia, espera por espaço; só descarta quando a saída é um despejo do mapa (saidaDescartavel).
+ssize_t escreverFilaRender(void *cookie, const char *dados, size_t tamanho)
+{
+    (void)cookie;
+    MensagemRender mensagem;
+    mensagem.tipo = MENSAGEM_TEXTO;
+    struct timespec espera = {0, 100000L};
+
+    for (size_t enviado = 0; enviado < tamanho; enviado += mensagem.tamanho)
+    {
+        mensagem.tamanho = (uint16_t)(tamanho - enviado < TAM_TEXTO_RENDER ? tamanho - enviado : TAM_TEXTO_RENDER);
+        memcpy(mensagem.texto, dados + enviado, mensagem.tamanho);
+        if (saidaDescartavel)
+        {
+            if (!enfileirarSPSC(&filaRender, &mensagem))
+                atomic_fetch_add_explicit(&mensagensDescartadas, 1, memory_order_relaxed);
+            continue;
+        }
+
+        // Prompts, resultados e mensagens de erro não podem se perder: o motor espera a exibição abrir espaço.
+        while (!enfileirarSPSC(&filaRender, &mensagem))
+            nanosleep(&espera, NULL);
+    }
+
+    // Para o motor, a escrita sempre tem sucesso.
+    return (ssize_t)tamanho;
+}
+
+/// @brief Leitura do fluxo de entrada do motor: consome os blocos da thread de entrada.
+ssize_t lerFilaEntrada(void *cookie, char *destino, size_t tamanho)
+{
+    (void)cookie;
+    static BlocoEntrada bloco;
+    static size_t consumido = 0;
+
+    struct timespec espera = {0, 1000000L};
+    while (consumido == bloco.tamanho)
+    {
+        if (desenfileirarSPSC(&filaEntrada, &bloco))
+        {
+            consumido = 0;
+            break;
+        }
+
+        // O fim só vale com a fila vazia: a thread de entrada o marca depois de enfileirar o último bloco.
+        if (atomic_load_explicit(&fimDaEntrada, memory_order_acquire))
+        {
+            if (!desenfileirarSPSC(&filaEntrada, &bloco))
+                return 0;
+            consumido = 0;
+            break;
+        }
+
+        // Antes de esperar pelo jogador, o prompt pendente precisa chegar à tela.
+        fflush(stdout);
+        nanosleep(&espera, NULL);
+    }
+
+    size_t quantidade = bloco.tamanho - consumido < tamanho ? bloco.tamanho - consumido : tamanho;
+    memcpy(destino, bloco.bytes + consumido, quantidade);
+    consumido += quantidade;
+    return (ssize_t)quantidade;
+}
+
+/// @brief Thread de entrada: lê a entrada padrão original e a repassa ao motor em blocos.
+void *executarThreadEntrada(void *argumento)
+{
+    (void)argumento;
+    BlocoEntrada bloco;
+    struct timespec espera = {0, 1000000L};
+
+    for (;;)
+    {
+        ssize_t lidos = read(STDIN_FILENO, bloco.bytes, TAM_BLOCO_ENTRADA);
+        if (lidos <= 0)
+            break;
+
+        // A entrada não pode ser descartada: se o motor estiver atrasado, esta thread espera por ele.
+        bloco.tamanho = (uint16_t)lidos;
+        while (!enfileirarSPSC(&filaEntrada, &bloco))
+            nanosleep(&espera, NULL);
+    }
+
+    atomic_store_explicit(&fimDaEntrada, 1, memory_order_release);
+    return NULL;
+}
+
+/// @brief Thread de exibição: escreve no terminal os textos e formata os eventos recebidos do motor.
+void *executarThreadRender(void *argumento)
+{
+    (void)argumento;
+    MensagemRender mensagem;
+    struct timespec espera = {0, 500000L};
+
+    for (;;)
+    {
+        if (!desenfileirarSPSC(&filaRender, &mensagem))
+        {
+            fflush(saidaTerminal);
+            nanosleep(&espera, NULL);
+            continue;
+        }
+
+        if (mensagem.tipo == MENSAGEM_FIM)
+            break;
+        if (mensagem.tipo == MENSAGEM_TEXTO)
+            fwrite(mensagem.texto, 1, mensagem.tamanho, saidaTerminal);
+        else
+            imprimirEventoTerminal(&mensagem.evento, saidaTerminal);
+    }
+
+    fflush(saidaTerminal);
+    return NULL;
+}
+
+int ativarModoThreads()
+{
+    if (modoThreads)
+        return 1;
+
+    cookie_io_functions_t funcoesSaida = {NULL, escreverFilaRender, NULL, NULL};
+    cookie_io_functions_t funcoesEntrada = {lerFilaEntrada, NULL, NULL, NULL};
+    FILE *saidaFila = fopencookie(NULL, "w", funcoesSaida);
+    FILE *entradaFila = fopencookie(NULL, "r", funcoesEntrada);
+    if (saidaFila == NULL || entradaFila == NULL)
+    {
+        if (saidaFila != NULL)
+            fclose(saidaFila);
+        if (entradaFila != NULL)
+            fclose(entradaFila);
+        return 0;
+    }
+
+    fflush(stdout);
+    saidaTerminal = stdout;
+    entradaTerminal = stdin;
+
+    if (pthread_create(&threadRender, NULL, executarThreadRender, NULL) != 0)
+    {
+        fclose(saidaFila);
+        fclose(entradaFila);
+        return 0;
+    }
+    if (pthread_create(&threadEntrada, NULL, executarThreadEntrada, NULL) != 0)
+    {
+        MensagemRender fim = {.tipo = MENSAGEM_FIM};
+        enfileirarSPSC(&filaRender, &fim);
+        pthread_join(threadRender, NULL);
+        fclose(saidaFila);
+        fclose(entradaFila);
+        return 0;
+    }
+
+    stdout = saidaFila;
+    stdin = entradaFila;
+    modoThreads = 1;
+
+    // Cobre também as saídas antecipadas de main().
+    atexit(encerrarModoThreads);
+    return 1;
+}
+
+void encerrarModoThreads()
+{
+    if (!modoThreads)
+        return;
+    modoThreads = 0;
+
+    // A mensagem de fim precisa chegar; aqui, sim, o motor espera pela exibição.
+    fflush(stdout);
+    MensagemRender fim = {.tipo = MENSAGEM_FIM};
+    struct timespec espera = {0, 1000000L};
+    while (!enfileirarSPSC(&filaRender, &fim))
+        nanosleep(&espera, NULL);
+    pthread_join(threadRender, NULL);
+
+    // A thread de entrada pode estar bloqueada em read(); read() e nanosleep() são pontos de cancelamento.
+    pthread_cancel(threadEntrada);
+    pthread_join(threadEntrada, NULL);
+
+    FILE *saidaFila = stdout, *entradaFila = stdin;
+    stdout = saidaTerminal;
+    stdin = entradaTerminal;
+    fclose(saidaFila);
+    fclose(entradaFila);
+
+    size_t descartadas = atomic_load(&mensagensDescartadas);
+    if (descartadas > 0)
+        printf("\n ⚠️  %zu mensagem(ns) de exibição descartada(s) com a fila cheia.\n", descartadas);
+}
+
+void enfileirarEventoRender(const EventoJogo *evento, void *contexto)
+{
+    (void)contexto;
+
+    // O texto ainda no buffer da saída vem antes do evento.
+    fflush(stdout);
+
+    MensagemRender mensagem;
+    mensagem.tipo = MENSAGEM_EVENTO;
+    mensagem.tamanho = 0;
+    mensagem.evento = *evento;
+
+    // Eventos contam o andamento da partida: como o texto interativo, esperam por espaço na fila.
+    struct timespec espera = {0, 100000L};
+    while (!enfileirarSPSC(&filaRender, &mensagem))
+        nanosleep(&espera, NULL);
+}
+
+// **** Rastreamento de memória: ****
+
+void contabilizarAlocacao(CategoriaMemoria categoria, size_t bytes)
+{
+    EstatisticasMemoria *estatisticas = &estatisticasMemoria[categoria];
+    estatisticas->bytesAtuais += bytes;
+    estatisticas->alocacoes++;
+    if (estatisticas->bytesAtuais > estatisticas->bytesPico)
+        estatisticas->bytesPico = estatisticas->bytesAtuais;
+
+    bytesTotais += bytes;
+    if (bytesTotais > bytesPicoTotal)
+        bytesPicoTotal = bytesTotais;
+}
+
+void contabilizarLiberacao(CategoriaMemoria categoria, size_t bytes)
+{
+    estatisticasMemoria[categoria].bytesAtuais -= bytes;
+    estatisticasMemoria[categoria].liberacoes++;
+    bytesTotais -= bytes;
+}
+
+void *alocarRastreado(CategoriaMemoria categoria, size_t bytes)
+{
+    if (bytes > SIZE_MAX - sizeof(CabecalhoAlocacao))
+        return NULL;
+
+    CabecalhoAlocacao *cabecalho = (CabecalhoAlocacao *)malloc(sizeof(CabecalhoAlocacao) + bytes);
+    if (cabecalho == NULL)
+        return NULL;
+
+    cabecalho->info.bytes = bytes;
+    cabecalho->info.categoria = categoria;
+    contabilizarAlocacao(categoria, bytes);
+    return cabecalho + 1;
+}
+
+void *alocarZeradoRastreado(CategoriaMemoria categoria, size_t quantidade, size_t tamanho)
+{
+    if (tamanho != 0 && quantidade > (SIZE_MAX - sizeof(CabecalhoAlocacao)) / tamanho)
+        return NULL;
+
+    void *bloco = alocarRastreado(categoria, quantidade * tamanho);
+    if (bloco != NULL)
+        memset(bloco, 0, quantidade * tamanho);
+    return bloco;
+}
+
+void *realocarRastreado(CategoriaMemoria categoria, void *ponteiro, size_t bytes)
+{
+    if (ponteiro == NULL)
+        return alocarRastreado(categoria, bytes);
+    if (bytes > SIZE_MAX - sizeof(CabecalhoAlocacao))
+        return NULL;
+
+    CabecalhoAlocacao *antigo = (CabecalhoAlocacao *)ponteiro - 1;
+    size_t bytesAntigos = antigo->info.bytes;
+    CategoriaMemoria categoriaAntiga = antigo->info.categoria;
+
+    CabecalhoAlocacao *novo = (CabecalhoAlocacao *)realloc(antigo, sizeof(CabecalhoAlocacao) + bytes);
+    if (novo == NULL)
+        return NULL; // O bloco antigo continua válido e contabilizado.
+
+    // A realocação conta como uma liberação na categoria anterior seguida de uma alocação na informada.
+    contabilizarLiberacao(categoriaAntiga, bytesAntigos);
+    contabilizarAlocacao(categoria, bytes);
+    novo->info.bytes = bytes;
+    novo->info.categoria = categoria;
+    return novo + 1;
+}
+
+void liberarRastreado(void *ponteiro)
+{
+    if (ponteiro == NULL)
+        return;
+
+    CabecalhoAlocacao *cabecalho = (CabecalhoAlocacao *)ponteiro - 1;
+    contabilizarLiberacao(cabecalho->info.categoria, cabecalho->info.bytes);
+    free(cabecalho);
+}
+
+size_t bytesEmUso()
+{
+    return bytesTotais;
+}
+
+void exibirRelatorioMemoria()
+{
+#if RASTREAR_MEMORIA
+    // Nomes já alinhados: o preenchimento do printf conta bytes, e os acentos ocupam dois.
+    const char *nomes[NUM_CATEGORIAS_MEMORIA] = {"Mapa      ", "Missões   ", "Textos    ", "Índices   ", "Históricos", "Temporária", "Rastro    "};
+
+    printf("\n==== 🧮  RELATÓRIO DE MEMÓRIA ====\n");
+    for (int c = 0; c < NUM_CATEGORIAS_MEMORIA; c++)
+    {
+        const EstatisticasMemoria *e = &estatisticasMemoria[c];
+        printf(" %s | atual: %12zu bytes | pico: %12zu bytes | alocações: %8zu | liberações: %8zu\n",
+               nomes[c], e->bytesAtuais, e->bytesPico, e->alocacoes, e->liberacoes);
+    }
+    printf(" Total em uso: %zu bytes | Pico total: %zu bytes\n", bytesEmUso(), bytesPicoTotal);
+#else
+    printf("\n ⚠️  Rastreamento de memória desligado (compile com -DRASTREAR_MEMORIA=1).\n");
+#endif
 }
 
 char *format(const char *fmt, ...)
@@ -613,7 +9403,7 @@ char *format(const char *fmt, ...)
     int len = vsnprintf(NULL, 0, fmt, args);
     va_end(args);
 
-    char *buffer = malloc(len + 1);
+    char *buffer = ALOCAR(MEMORIA_TEXTOS, len + 1);
     if (!buffer)
         return NULL;
 
@@ -663,4 +9453,70 @@ char *format(const char *fmt, ...)
 // limparBufferEntrada():
 // Implementado.
 
+// faseDeBlitz():
+// Implementado.
+
+// atacarBlitz():
+// Implementado.
+
+// capturarSnapshot() / restaurarSnapshot():
+// Implementado.
+
+// desfazerJogada() / refazerJogada() / descartarPontosDesfazer():
+// Implementado.
+
+// resolverOrdensEmLote():
+// Implementado.
+
+// DEFINIR_MAPA_FIXO():
+// Implementado.
+
+// regiaoDominadaPor() / contarRegioesDominadas():
+// Implementado.
+
+// faseDeReforco():
+// Implementado.
+
+// registrarBatalha() / ultimasConquistasDoTerritorio() / perdasDaCorNosTurnos() / moverHistoricoBatalhas():
+// Implementado.
+
+// exibirRelatorioMemoria():
+// Implementado.
+
+// RASTREAR_ESCOPO() / finalizarRastro():
+// Implementado.
+
+// publicarEspectadores() / acompanharPartida():
+// Implementado.
+
+// ativarModoThreads() / encerrarModoThreads():
+// Implementado.
+
+// gerarMapa() / gerarArquivoMapa() / carregarArquivoMapa():
+// Implementado.
+
+// faseDeConsultas():
+// Implementado.
+
+// faseDeSolucionador():
+// Implementado.
+
+// faseDeConselheiro():
+// Implementado.
+
+// faseDeFortificacao():
+// Implementado.
+
+// turnoDasIAs():
+// Implementado.
+
+// buscarCenario() / carregarMapaClassico() / criarContinentesClassicos():
+// Implementado.
+
+// registrarEstatisticaBatalha() / gravarEstatisticas() / faseDeEstatisticas():
+// Implementado.
+
+// idCorEstatisticas() / carregarDicionarioCores():
+// Implementado.
+
 #pragma endregion
\ No newline at end of file
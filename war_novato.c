@@ -39,6 +39,18 @@ struct Territorio
     int tropas;
 };
 
+// **** Cenário Pronto ****
+
+/// @brief Territórios do cenário pronto, gravados no próprio programa como constantes.
+/// Carregá-los é apenas uma cópia para o vetor de territórios, sem digitação.
+const struct Territorio CENARIO_PRONTO[MAX_TERRITORIOS] = {
+    {"America", "Verde", 5},
+    {"Europa", "Azul", 3},
+    {"Asia", "Vermelho", 2},
+    {"Africa", "Amarelo", 4},
+    {"Oceania", "Branco", 1},
+};
+
 // **** Protótipos das Funções ****
 
 //**** Declarações antecipadas de todas as funções que serão usadas no programa, organizadas por categoria. ****
@@ -112,6 +124,7 @@ int main()
         
         printf("\n1 - Cadastrar novos territorios. \n");
         printf("2 - Listar todos os territorios. \n");
+        printf("3 - Carregar cenario pronto. \n");
         printf("0 - Sair. \n");
         printf("Escolha uma opção: ");
 
@@ -172,6 +185,14 @@ int main()
 
             break;
 
+        case 3:
+            // Carregamento do cenário pronto, substituindo os territórios cadastrados.
+            memcpy(territorios, CENARIO_PRONTO, sizeof(CENARIO_PRONTO));
+            totalTerritorios = MAX_TERRITORIOS;
+
+            printf("\n=== Cenário pronto carregado com %d territórios. === \n", MAX_TERRITORIOS);
+            break;
+
         case 0:
             // Sair.
             printf("\n=== Saindo do sistema. Operação encerrada. === \n");